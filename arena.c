@@ -0,0 +1,71 @@
+/*
+ * arena.c - Bump allocator for short-lived-together strings
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "arena.h"
+
+void arena_init(Arena *a) {
+    a->head = NULL;
+    a->bytes_used = 0;
+    a->bytes_reserved = 0;
+}
+
+void *arena_alloc(Arena *a, size_t size, size_t align) {
+    if(align == 0) align = 1;
+
+    ArenaBlock *b = a->head;
+    if(b) {
+        uintptr_t base = (uintptr_t)(b->data + b->used);
+        size_t pad = (align - (base & (align - 1))) & (align - 1);
+        if(b->used + pad + size <= b->size) {
+            void *ptr = b->data + b->used + pad;
+            b->used += pad + size;
+            a->bytes_used += size;
+            return ptr;
+        }
+    }
+
+    // Oversized requests get a block of their own, kept behind the current
+    // block so its free space is not abandoned
+    int oversized = size + align > ARENA_BLOCK_SIZE / 4;
+    size_t block_size = oversized ? size + align : ARENA_BLOCK_SIZE;
+    b = malloc(sizeof(ArenaBlock) + block_size);
+    if(!b) return NULL;
+    b->size = block_size;
+    b->used = 0;
+    if(oversized && a->head) {
+        b->next = a->head->next;
+        a->head->next = b;
+    } else {
+        b->next = a->head;
+        a->head = b;
+    }
+    a->bytes_reserved += block_size;
+
+    uintptr_t base = (uintptr_t)b->data;
+    size_t pad = (align - (base & (align - 1))) & (align - 1);
+    b->used = pad + size;
+    a->bytes_used += size;
+    return b->data + pad;
+}
+
+char *arena_strndup(Arena *a, const char *s, size_t len) {
+    char *dst = arena_alloc(a, len + 1, 1);
+    if(!dst) return NULL;
+    memcpy(dst, s, len);
+    dst[len] = '\0';
+    return dst;
+}
+
+void arena_free(Arena *a) {
+    ArenaBlock *b = a->head;
+    while(b) {
+        ArenaBlock *next = b->next;
+        free(b);
+        b = next;
+    }
+    arena_init(a);
+}
@@ -0,0 +1,34 @@
+/*
+ * arena.h - Bump allocator for short-lived-together strings
+ * Everything allocated from an arena is released at once by arena_free().
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// ========== CONFIGURATION ==========
+#define ARENA_BLOCK_SIZE (256 * 1024)  // Default block size (bytes)
+
+// ========== STRUCTURES ==========
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used;
+    size_t size;
+    char data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+    size_t bytes_used;      // Bytes handed out
+    size_t bytes_reserved;  // Bytes obtained from malloc
+} Arena;
+
+// ========== FUNCTION PROTOTYPES ==========
+void arena_init(Arena *a);
+void *arena_alloc(Arena *a, size_t size, size_t align);
+char *arena_strndup(Arena *a, const char *s, size_t len);
+void arena_free(Arena *a);
+
+#endif
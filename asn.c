@@ -0,0 +1,602 @@
+/*
+ * asn.c - Offline IP-to-ASN lookup
+ *
+ * Compiled layout (host byte order, every section 8-byte aligned):
+ *   AsnHeader, v6 starts, v6 ends, v4 starts, v4 ends,
+ *   v4 network indexes, v6 network indexes, v4 buckets, networks, strings
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "asn.h"
+#include "hash.h"
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t v4_count;
+    uint64_t v6_count;
+    uint64_t network_count;
+    uint64_t strings_size;
+} AsnHeader;
+
+#define V4_BUCKETS (1u << ASN_V4_BUCKET_BITS)
+
+enum { SEC_V6_START, SEC_V6_END, SEC_V4_START, SEC_V4_END,
+       SEC_V4_NETWORK, SEC_V6_NETWORK, SEC_V4_BUCKET, SEC_NETWORKS, SEC_STRINGS, SEC_END };
+
+// ========== LAYOUT ==========
+// Fills off[] with each section's offset; off[SEC_END] is the total size
+static void layout(const AsnHeader *h, uint64_t off[SEC_END + 1]) {
+    uint64_t sizes[SEC_END] = {
+        h->v6_count * sizeof(AsnAddr6), h->v6_count * sizeof(AsnAddr6),
+        h->v4_count * sizeof(uint32_t), h->v4_count * sizeof(uint32_t),
+        h->v4_count * sizeof(uint32_t), h->v6_count * sizeof(uint32_t),
+        (V4_BUCKETS + 1) * sizeof(uint32_t), h->network_count * sizeof(AsnNetwork), h->strings_size,
+    };
+    uint64_t pos = sizeof(AsnHeader);
+    for(int i = 0; i < SEC_END; i++) {
+        off[i] = pos;
+        pos = (pos + sizes[i] + 7) & ~(uint64_t)7;
+    }
+    off[SEC_END] = pos;
+}
+
+// Points the tables into base, which holds a complete compiled image
+static int attach(AsnDb *db) {
+    AsnHeader h;
+    uint64_t off[SEC_END + 1];
+
+    if(db->size < sizeof(h)) {
+        db->error = "truncated ASN database";
+        return 0;
+    }
+    memcpy(&h, db->base, sizeof(h));
+    if(h.version != ASN_VERSION) {
+        db->error = "unsupported ASN database version";
+        return 0;
+    }
+    if(h.v4_count > UINT32_MAX || h.v6_count > UINT32_MAX ||
+       h.network_count > UINT32_MAX || h.strings_size > UINT32_MAX) {
+        db->error = "corrupt ASN database";
+        return 0;
+    }
+    layout(&h, off);
+    if(off[SEC_END] > db->size) {
+        db->error = "corrupt ASN database";
+        return 0;
+    }
+
+    db->v6_start = (const AsnAddr6 *)(db->base + off[SEC_V6_START]);
+    db->v6_end = (const AsnAddr6 *)(db->base + off[SEC_V6_END]);
+    db->v4_start = (const uint32_t *)(db->base + off[SEC_V4_START]);
+    db->v4_end = (const uint32_t *)(db->base + off[SEC_V4_END]);
+    db->v4_network = (const uint32_t *)(db->base + off[SEC_V4_NETWORK]);
+    db->v6_network = (const uint32_t *)(db->base + off[SEC_V6_NETWORK]);
+    db->v4_bucket = (const uint32_t *)(db->base + off[SEC_V4_BUCKET]);
+    db->networks = (const AsnNetwork *)(db->base + off[SEC_NETWORKS]);
+    db->strings = db->base + off[SEC_STRINGS];
+    db->v4_count = h.v4_count;
+    db->v6_count = h.v6_count;
+    db->network_count = h.network_count;
+
+    // A bad network index would read outside the mapping on lookup
+    for(size_t i = 0; i < db->network_count; i++) {
+        if((uint64_t)db->networks[i].org_offset + db->networks[i].org_len >= h.strings_size) {
+            db->error = "corrupt ASN database";
+            return 0;
+        }
+    }
+    for(size_t i = 0; i < db->v4_count; i++) {
+        if(db->v4_network[i] >= db->network_count) {
+            db->error = "corrupt ASN database";
+            return 0;
+        }
+    }
+    for(size_t i = 0; i < db->v6_count; i++) {
+        if(db->v6_network[i] >= db->network_count) {
+            db->error = "corrupt ASN database";
+            return 0;
+        }
+    }
+    for(size_t p = 0; p < V4_BUCKETS; p++) {
+        if(db->v4_bucket[p] > db->v4_bucket[p + 1]) {
+            db->error = "corrupt ASN database";
+            return 0;
+        }
+    }
+    if(db->v4_bucket[V4_BUCKETS] != db->v4_count) {
+        db->error = "corrupt ASN database";
+        return 0;
+    }
+    return 1;
+}
+
+// ========== TEXT DATASET ==========
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+    uint32_t network;
+} Range4;
+
+typedef struct {
+    AsnAddr6 start;
+    AsnAddr6 end;
+    uint32_t network;
+} Range6;
+
+typedef struct {
+    Range4 *v4;
+    size_t v4_count, v4_cap;
+    Range6 *v6;
+    size_t v6_count, v6_cap;
+    AsnNetwork *networks;
+    size_t network_count, network_cap;
+    char *strings;
+    size_t strings_size, strings_cap;
+    uint32_t *slots;        // Network index + 1, 0 = empty
+    size_t slot_mask;
+} AsnBuilder;
+
+static int grow(void **items, size_t *cap, size_t need, size_t item_size) {
+    if(need <= *cap) return 1;
+    size_t n = *cap ? *cap * 2 : 4096;
+    while(n < need) n *= 2;
+    void *p = realloc(*items, n * item_size);
+    if(!p) return 0;
+    *items = p;
+    *cap = n;
+    return 1;
+}
+
+static uint64_t network_hash(uint32_t asn, const char country[2], const char *org, size_t len) {
+    return hash_bytes(org, len) ^ ((uint64_t)asn * 0x9e3779b97f4a7c15ULL) ^
+           ((unsigned char)country[0] << 8 | (unsigned char)country[1]);
+}
+
+static int grow_slots(AsnBuilder *b) {
+    size_t size = b->slots ? (b->slot_mask + 1) * 2 : 4096;
+    uint32_t *slots = calloc(size, sizeof(uint32_t));
+    if(!slots) return 0;
+
+    for(size_t i = 0; i < b->network_count; i++) {
+        const AsnNetwork *n = &b->networks[i];
+        size_t pos = network_hash(n->asn, n->country, b->strings + n->org_offset, n->org_len) & (size - 1);
+        while(slots[pos]) pos = (pos + 1) & (size - 1);
+        slots[pos] = (uint32_t)(i + 1);
+    }
+    free(b->slots);
+    b->slots = slots;
+    b->slot_mask = size - 1;
+    return 1;
+}
+
+// Index of the network, added if it is new; -1 when out of memory
+static long intern_network(AsnBuilder *b, uint32_t asn, const char country[2], const char *org, size_t len) {
+    if(!b->slots || (b->network_count + 1) * 2 > b->slot_mask + 1) {
+        if(!grow_slots(b)) return -1;
+    }
+
+    size_t pos = network_hash(asn, country, org, len) & b->slot_mask;
+    while(b->slots[pos]) {
+        const AsnNetwork *n = &b->networks[b->slots[pos] - 1];
+        if(n->asn == asn && n->org_len == len && memcmp(n->country, country, 2) == 0 &&
+           memcmp(b->strings + n->org_offset, org, len) == 0) {
+            return b->slots[pos] - 1;
+        }
+        pos = (pos + 1) & b->slot_mask;
+    }
+
+    if(!grow((void **)&b->networks, &b->network_cap, b->network_count + 1, sizeof(AsnNetwork)) ||
+       !grow((void **)&b->strings, &b->strings_cap, b->strings_size + len + 1, 1)) {
+        return -1;
+    }
+    AsnNetwork *n = &b->networks[b->network_count];
+    n->asn = asn;
+    n->org_offset = (uint32_t)b->strings_size;
+    n->org_len = (uint16_t)len;
+    memcpy(n->country, country, 2);
+    memcpy(b->strings + b->strings_size, org, len);
+    b->strings[b->strings_size + len] = '\0';
+    b->strings_size += len + 1;
+    b->slots[pos] = (uint32_t)(b->network_count + 1);
+    return (long)b->network_count++;
+}
+
+static AsnAddr6 addr6_from_bytes(const unsigned char *p) {
+    AsnAddr6 a = { 0, 0 };
+    for(int i = 0; i < 8; i++) {
+        a.hi = a.hi << 8 | p[i];
+        a.lo = a.lo << 8 | p[i + 8];
+    }
+    return a;
+}
+
+static int addr6_cmp(const AsnAddr6 *a, const AsnAddr6 *b) {
+    if(a->hi != b->hi) return a->hi < b->hi ? -1 : 1;
+    return (a->lo > b->lo) - (a->lo < b->lo);
+}
+
+// Parses a dotted quad, an IPv6 address or a plain 32-bit number
+// (the "-u32" flavour of the dataset); returns 4, 6 or 0
+static int parse_addr(const char *s, uint32_t *v4, AsnAddr6 *v6) {
+    unsigned char bytes[16];
+
+    if(strchr(s, ':')) {
+        if(inet_pton(AF_INET6, s, bytes) != 1) return 0;
+        *v6 = addr6_from_bytes(bytes);
+        return 6;
+    }
+    if(strchr(s, '.')) {
+        if(inet_pton(AF_INET, s, bytes) != 1) return 0;
+        *v4 = (uint32_t)bytes[0] << 24 | bytes[1] << 16 | bytes[2] << 8 | bytes[3];
+        return 4;
+    }
+    char *end;
+    unsigned long long n = strtoull(s, &end, 10);
+    if(end == s || *end || n > UINT32_MAX) return 0;
+    *v4 = (uint32_t)n;
+    return 4;
+}
+
+// Cuts `s` at the separator (the last field takes the rest of the line)
+// and strips blanks and CSV quotes from the field in place
+static char *next_field(char **s, char sep, int last) {
+    char *start = *s;
+    if(!start) return NULL;
+
+    char *stop = last ? NULL : strchr(start, sep);
+    if(stop) {
+        *stop = '\0';
+        *s = stop + 1;
+    } else {
+        *s = NULL;
+    }
+
+    char *end = start + strlen(start);
+    while(*start == ' ') start++;
+    while(end > start && (end[-1] == ' ' || end[-1] == '\r')) end--;
+    if(end - start >= 2 && *start == '"' && end[-1] == '"') {
+        // CSV quoting: drop the enclosing quotes and undouble the inner ones
+        char *out = ++start;
+        end--;
+        for(char *c = start; c < end; c++) {
+            *out++ = *c;
+            if(*c == '"' && c + 1 < end && c[1] == '"') c++;
+        }
+        end = out;
+    }
+    *end = '\0';
+    return start;
+}
+
+static int parse_line(AsnDb *db, AsnBuilder *b, char *line) {
+    char sep = strchr(line, '\t') ? '\t' : ',';
+    char *rest = line;
+    char *f_start = next_field(&rest, sep, 0);
+    char *f_end = next_field(&rest, sep, 0);
+    char *f_asn = next_field(&rest, sep, 0);
+    char *f_country = next_field(&rest, sep, 0);
+    char *f_org = next_field(&rest, sep, 1);
+
+    uint32_t s4 = 0, e4 = 0;
+    AsnAddr6 s6 = { 0, 0 }, e6 = { 0, 0 };
+    int family = f_org ? parse_addr(f_start, &s4, &s6) : 0;
+    if(!family && db->lines == 1) return 1;  // CSV header
+    if(strncasecmp(f_asn, "AS", 2) == 0) f_asn += 2;
+    char *asn_end;
+    unsigned long asn = strtoul(f_asn, &asn_end, 10);
+
+    if(!family || family != parse_addr(f_end, &e4, &e6) || asn_end == f_asn || *asn_end ||
+       asn > UINT32_MAX || (family == 4 ? e4 < s4 : addr6_cmp(&e6, &s6) < 0)) {
+        db->invalid++;
+        return 1;
+    }
+    if(asn == 0) {
+        db->unrouted++;
+        return 1;
+    }
+
+    char country[2] = { 0, 0 };
+    if(strlen(f_country) == 2) memcpy(country, f_country, 2);
+    size_t org_len = strlen(f_org);
+    if(org_len > ASN_MAX_ORG_LEN) org_len = ASN_MAX_ORG_LEN;
+
+    long network = intern_network(b, (uint32_t)asn, country, f_org, org_len);
+    if(network < 0) return 0;
+
+    if(family == 4) {
+        if(!grow((void **)&b->v4, &b->v4_cap, b->v4_count + 1, sizeof(Range4))) return 0;
+        b->v4[b->v4_count++] = (Range4){ s4, e4, (uint32_t)network };
+    } else {
+        if(!grow((void **)&b->v6, &b->v6_cap, b->v6_count + 1, sizeof(Range6))) return 0;
+        b->v6[b->v6_count++] = (Range6){ s6, e6, (uint32_t)network };
+    }
+    return 1;
+}
+
+static int compare_range4(const void *a, const void *b) {
+    uint32_t x = ((const Range4 *)a)->start, y = ((const Range4 *)b)->start;
+    return (x > y) - (x < y);
+}
+
+static int compare_range6(const void *a, const void *b) {
+    return addr6_cmp(&((const Range6 *)a)->start, &((const Range6 *)b)->start);
+}
+
+// Sorts by start, drops ranges overlapping an earlier one and merges
+// touching ranges of the same network; returns the new count
+static size_t normalize_v4(AsnDb *db, Range4 *r, size_t count) {
+    size_t out = 0;
+    qsort(r, count, sizeof(Range4), compare_range4);
+    for(size_t i = 0; i < count; i++) {
+        if(out && r[i].start <= r[out - 1].end) {
+            db->invalid++;
+        } else if(out && r[i].network == r[out - 1].network && r[i].start == r[out - 1].end + 1) {
+            r[out - 1].end = r[i].end;
+        } else {
+            r[out++] = r[i];
+        }
+    }
+    return out;
+}
+
+static size_t normalize_v6(AsnDb *db, Range6 *r, size_t count) {
+    size_t out = 0;
+    qsort(r, count, sizeof(Range6), compare_range6);
+    for(size_t i = 0; i < count; i++) {
+        AsnAddr6 next = { 0, 0 };
+        if(out) {
+            next = r[out - 1].end;
+            next.lo++;
+            if(next.lo == 0) next.hi++;
+        }
+        if(out && addr6_cmp(&r[i].start, &r[out - 1].end) <= 0) {
+            db->invalid++;
+        } else if(out && r[i].network == r[out - 1].network && addr6_cmp(&r[i].start, &next) == 0) {
+            r[out - 1].end = r[i].end;
+        } else {
+            r[out++] = r[i];
+        }
+    }
+    return out;
+}
+
+// Lays the builder's tables out as a compiled image in one heap block
+static int pack(AsnDb *db, const AsnBuilder *b) {
+    AsnHeader h;
+    uint64_t off[SEC_END + 1];
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, ASN_MAGIC, 4);
+    h.version = ASN_VERSION;
+    h.v4_count = b->v4_count;
+    h.v6_count = b->v6_count;
+    h.network_count = b->network_count;
+    h.strings_size = b->strings_size + 1;  // Never empty, so every offset is in range
+    layout(&h, off);
+
+    char *base = calloc(1, off[SEC_END]);
+    if(!base) return 0;
+    memcpy(base, &h, sizeof(h));
+
+    for(size_t i = 0; i < b->v4_count; i++) {
+        ((uint32_t *)(base + off[SEC_V4_START]))[i] = b->v4[i].start;
+        ((uint32_t *)(base + off[SEC_V4_END]))[i] = b->v4[i].end;
+        ((uint32_t *)(base + off[SEC_V4_NETWORK]))[i] = b->v4[i].network;
+    }
+    uint32_t *bucket = (uint32_t *)(base + off[SEC_V4_BUCKET]);
+    size_t next = 0;
+    for(size_t p = 0; p <= V4_BUCKETS; p++) {
+        uint64_t first = (uint64_t)p << (32 - ASN_V4_BUCKET_BITS);
+        while(next < b->v4_count && b->v4[next].start < first) next++;
+        bucket[p] = (uint32_t)next;
+    }
+    for(size_t i = 0; i < b->v6_count; i++) {
+        ((AsnAddr6 *)(base + off[SEC_V6_START]))[i] = b->v6[i].start;
+        ((AsnAddr6 *)(base + off[SEC_V6_END]))[i] = b->v6[i].end;
+        ((uint32_t *)(base + off[SEC_V6_NETWORK]))[i] = b->v6[i].network;
+    }
+    if(b->network_count) {
+        memcpy(base + off[SEC_NETWORKS], b->networks, b->network_count * sizeof(AsnNetwork));
+    }
+    if(b->strings_size) memcpy(base + off[SEC_STRINGS], b->strings, b->strings_size);
+
+    db->base = base;
+    db->size = off[SEC_END];
+    db->mapped = 0;
+    return attach(db);
+}
+
+static int load_text(AsnDb *db, const char *filename) {
+    // zlib reads plain files as they are, so one path covers .tsv and .tsv.gz
+    gzFile gz = gzopen(filename, "rb");
+    if(!gz) {
+        db->error = "cannot open file";
+        return 0;
+    }
+    gzbuffer(gz, 256 * 1024);
+
+    AsnBuilder b;
+    memset(&b, 0, sizeof(b));
+    char line[1024];
+    int ok = 1;
+
+    while(ok && gzgets(gz, line, sizeof(line))) {
+        size_t len = strlen(line);
+        if(len == sizeof(line) - 1 && line[len - 1] != '\n') {
+            // Overlong line: count it once and skip the remainder
+            int c;
+            while((c = gzgetc(gz)) >= 0 && c != '\n') {}
+            db->lines++;
+            db->invalid++;
+            continue;
+        }
+        while(len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        db->lines++;
+        if(len == 0 || line[0] == '#') continue;
+        if(!parse_line(db, &b, line)) {
+            db->error = "out of memory";
+            ok = 0;
+        }
+    }
+
+    int gz_error;
+    gzerror(gz, &gz_error);
+    if(ok && gz_error != Z_OK && gz_error != Z_STREAM_END) {
+        db->error = "gzip stream is corrupt";
+        ok = 0;
+    }
+    gzclose(gz);
+
+    if(ok) {
+        b.v4_count = normalize_v4(db, b.v4, b.v4_count);
+        b.v6_count = normalize_v6(db, b.v6, b.v6_count);
+        if(!pack(db, &b)) {
+            if(!db->error) db->error = "out of memory";
+            ok = 0;
+        }
+    }
+
+    free(b.v4);
+    free(b.v6);
+    free(b.networks);
+    free(b.strings);
+    free(b.slots);
+    return ok;
+}
+
+// ========== LOAD / COMPILE ==========
+int asn_load(AsnDb *db, const char *filename) {
+    memset(db, 0, sizeof(*db));
+
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0) {
+        db->error = "cannot open file";
+        return 0;
+    }
+
+    char magic[4];
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        db->error = "ASN dataset is empty";
+        return 0;
+    }
+
+    int ok;
+    if(st.st_size >= (off_t)sizeof(AsnHeader) && pread(fd, magic, 4, 0) == 4 &&
+       memcmp(magic, ASN_MAGIC, 4) == 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if(map == MAP_FAILED) {
+            db->error = "mmap failed";
+            return 0;
+        }
+        db->base = map;
+        db->size = st.st_size;
+        db->mapped = 1;
+        ok = attach(db);
+    } else {
+        close(fd);
+        ok = load_text(db, filename);
+    }
+
+    if(ok && db->v4_count + db->v6_count == 0) {
+        db->error = "no routed ranges in ASN dataset";
+        ok = 0;
+    }
+    if(!ok) {
+        const char *error = db->error;
+        asn_free(db);
+        db->error = error;
+    }
+    return ok;
+}
+
+int asn_compile(const AsnDb *db, const char *filename) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+    FILE *fp = fopen(tmp, "wb");
+    if(!fp) return 0;
+
+    int ok = fwrite(db->base, 1, db->size, fp) == db->size;
+    ok = (fclose(fp) == 0) && ok;
+    ok = ok && rename(tmp, filename) == 0;
+    if(!ok) unlink(tmp);
+    return ok;
+}
+
+void asn_free(AsnDb *db) {
+    if(db->base) {
+        if(db->mapped) munmap((void *)db->base, db->size);
+        else free((void *)db->base);
+    }
+    memset(db, 0, sizeof(*db));
+}
+
+// ========== LOOKUP ==========
+// Branch-free binary search: the loop runs log2(n) times whatever the
+// address, and the compare becomes a conditional move, so there are no
+// mispredicted jumps; only the final range check can miss
+
+const AsnNetwork *asn_lookup_v4(const AsnDb *db, uint32_t addr) {
+    // The range holding addr starts in its own /16 or is the last one before it
+    uint32_t p = addr >> (32 - ASN_V4_BUCKET_BITS);
+    size_t first = db->v4_bucket[p] ? db->v4_bucket[p] - 1 : 0;
+    const uint32_t *base = db->v4_start + first;
+    size_t n = db->v4_bucket[p + 1] - first;
+
+    if(n == 0 || addr < base[0]) return NULL;
+    while(n > 1) {
+        size_t half = n / 2;
+        base = base[half] <= addr ? base + half : base;
+        n -= half;
+    }
+
+    size_t i = base - db->v4_start;
+    return addr <= db->v4_end[i] ? &db->networks[db->v4_network[i]] : NULL;
+}
+
+const AsnNetwork *asn_lookup_v6(const AsnDb *db, const AsnAddr6 *addr) {
+    const AsnAddr6 *base = db->v6_start;
+    size_t n = db->v6_count;
+
+    if(n == 0 || addr6_cmp(addr, &base[0]) < 0) return NULL;
+    while(n > 1) {
+        size_t half = n / 2;
+        const AsnAddr6 *mid = &base[half];
+        int le = (mid->hi < addr->hi) | ((mid->hi == addr->hi) & (mid->lo <= addr->lo));
+        base = le ? mid : base;
+        n -= half;
+    }
+
+    size_t i = base - db->v6_start;
+    return addr6_cmp(addr, &db->v6_end[i]) <= 0 ? &db->networks[db->v6_network[i]] : NULL;
+}
+
+// Textual IPv4 or IPv6 address, as the DNS stage stores them
+const AsnNetwork *asn_lookup(const AsnDb *db, const char *ip) {
+    unsigned char bytes[16];
+
+    if(!db->base || !ip) return NULL;
+    if(strchr(ip, ':')) {
+        if(inet_pton(AF_INET6, ip, bytes) != 1) return NULL;
+        AsnAddr6 a = addr6_from_bytes(bytes);
+        return asn_lookup_v6(db, &a);
+    }
+    if(inet_pton(AF_INET, ip, bytes) != 1) return NULL;
+    return asn_lookup_v4(db, (uint32_t)bytes[0] << 24 | bytes[1] << 16 | bytes[2] << 8 | bytes[3]);
+}
+
+const char *asn_org(const AsnDb *db, const AsnNetwork *net) {
+    return db->strings + net->org_offset;
+}
@@ -0,0 +1,72 @@
+/*
+ * asn.h - Offline IP-to-ASN lookup
+ * An iptoasn-style dataset (range_start, range_end, AS number, country,
+ * description; TSV or CSV, gzip ok) is turned into sorted interval tables,
+ * one for IPv4 and one for IPv6, sharing a table of distinct networks.
+ * IPv4 lookups jump to their /16 through a bucket table and only search
+ * the few ranges starting there.
+ * The tables can be compiled into a binary file that later runs map and
+ * search directly, without parsing anything.
+ */
+
+#ifndef ASN_H
+#define ASN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ========== CONFIGURATION ==========
+#define ASN_MAGIC       "SSAS"
+#define ASN_VERSION     1
+#define ASN_MAX_ORG_LEN 200         // Longer descriptions are cut
+#define ASN_V4_BUCKET_BITS 16       // IPv4 searches start from the /16 bucket
+
+// ========== STRUCTURES ==========
+typedef struct {
+    uint32_t asn;
+    uint32_t org_offset;    // Description in AsnDb.strings, NUL-terminated
+    char country[2];        // ISO 3166 code, zeros when unknown
+    uint16_t org_len;
+} AsnNetwork;
+
+typedef struct {
+    uint64_t hi;            // Address bits 127..64
+    uint64_t lo;
+} AsnAddr6;
+
+typedef struct {
+    const char *base;       // Mapped compiled file or the heap block built from text
+    size_t size;
+    int mapped;
+
+    // Ranges sorted by start, never overlapping; network index per range
+    const uint32_t *v4_start;
+    const uint32_t *v4_end;
+    const uint32_t *v4_network;
+    const uint32_t *v4_bucket;      // First range starting in each /16, plus a final count
+    const AsnAddr6 *v6_start;
+    const AsnAddr6 *v6_end;
+    const uint32_t *v6_network;
+    const AsnNetwork *networks;
+    const char *strings;
+    size_t v4_count;
+    size_t v6_count;
+    size_t network_count;
+
+    // Load statistics (text datasets only)
+    size_t lines;
+    size_t unrouted;        // AS 0 rows: address space nobody announces
+    size_t invalid;
+    const char *error;
+} AsnDb;
+
+// ========== FUNCTION PROTOTYPES ==========
+int asn_load(AsnDb *db, const char *filename);
+int asn_compile(const AsnDb *db, const char *filename);
+const AsnNetwork *asn_lookup_v4(const AsnDb *db, uint32_t addr);
+const AsnNetwork *asn_lookup_v6(const AsnDb *db, const AsnAddr6 *addr);
+const AsnNetwork *asn_lookup(const AsnDb *db, const char *ip);
+const char *asn_org(const AsnDb *db, const AsnNetwork *net);
+void asn_free(AsnDb *db);
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * bench.c - Deterministic PRNG, peak RSS and result rows for the benchmarks
+ */
+
+#include <stdio.h>
+#include <sys/resource.h>
+#include "bench.h"
+
+// ========== RANDOM ==========
+// xorshift64*: fixtures must be identical on every machine and run
+void bench_rng_seed(BenchRng *r, uint64_t seed) {
+    r->state = seed ? seed : 0x9e3779b97f4a7c15ULL;
+}
+
+uint64_t bench_rng_next(BenchRng *r) {
+    r->state ^= r->state >> 12;
+    r->state ^= r->state << 25;
+    r->state ^= r->state >> 27;
+    return r->state * 0x2545f4914f6cdd1dULL;
+}
+
+size_t bench_rng_below(BenchRng *r, size_t n) {
+    return n ? (size_t)(bench_rng_next(r) % n) : 0;
+}
+
+// ========== REPORTING ==========
+long bench_peak_rss_kb() {
+    struct rusage ru;
+    return getrusage(RUSAGE_SELF, &ru) == 0 ? ru.ru_maxrss : 0;
+}
+
+void bench_header(const char *title) {
+    printf("\n%s\n", title);
+    printf("%-28s %12s %10s %14s %10s %10s\n", "benchmark", "items", "ms", "items/s", "MB/s", "rss MB");
+}
+
+// `bytes` may be 0 when throughput in MB/s does not apply
+void bench_row(const char *name, size_t items, size_t bytes, double ms) {
+    double sec = ms > 0 ? ms / 1000.0 : 1e-9;
+    printf("%-28s %12zu %10.1f %14.0f ", name, items, ms, items / sec);
+    if(bytes) printf("%10.1f ", bytes / (1024.0 * 1024.0) / sec);
+    else printf("%10s ", "-");
+    printf("%10.1f\n", bench_peak_rss_kb() / 1024.0);
+    fflush(stdout);
+}
@@ -0,0 +1,27 @@
+/*
+ * bench.h - Shared helpers for the benchmark programs
+ * Timing uses the same monotonic clock as the scanner; every result is
+ * printed as one aligned row so runs can be diffed from commit to commit.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ========== STRUCTURES ==========
+typedef struct {
+    uint64_t state;
+} BenchRng;
+
+// ========== FUNCTION PROTOTYPES ==========
+void bench_rng_seed(BenchRng *r, uint64_t seed);
+uint64_t bench_rng_next(BenchRng *r);
+size_t bench_rng_below(BenchRng *r, size_t n);
+
+long bench_peak_rss_kb();
+void bench_header(const char *title);
+void bench_row(const char *name, size_t items, size_t bytes, double ms);
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * e2e.c - End-to-end throughput through the local SOCKS5/HTTPS stand-ins
+ * Runs the real crt.sh source and the real probe engine against
+ * mock_server, with no network and no Tor, and reports time, rate,
+ * latency and peak memory for each.
+ *
+ * Usage: e2e [--socks PORT] [--names N] [--parallel P] [--rate PER_MIN]
+ *            [--domain DOMAIN] [--no-ct] [--adaptive]
+ * --adaptive runs the probes with latency-derived deadlines instead of the
+ * fixed PROBE_TIMEOUT_SEC (start mock_server with --silent to see it matter).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <curl/curl.h>
+#include "bench.h"
+#include "../http_client.h"
+#include "../passive.h"
+#include "../probe_engine.h"
+#include "../rate.h"
+#include "../metrics.h"
+#include "../deadline.h"
+
+// ========== CONFIGURATION ==========
+#define DEFAULT_SOCKS_PORT  1080
+#define DEFAULT_NAMES       5000
+#define DEFAULT_PARALLEL    32
+#define PROBE_TIMEOUT_SEC   10
+#define DEADLINE_FLOOR_MS   2000
+#define DEADLINE_CEILING_MS 20000
+
+static Metrics metrics;
+
+// One line of curl's timing breakdown for a phase
+static void print_stages(const char *phase) {
+    static const char *names[STAGE_COUNT] = { "connect", "handshake", "ttfb", "total" };
+    const PhaseMetrics *p = metrics_phase(&metrics, phase);
+    printf("  p50/p99 ms:");
+    for(int s = 0; s < STAGE_COUNT; s++) {
+        const LatencyHistogram *h = &p->stages[s];
+        printf(" %s %.1f/%.1f", names[s], histogram_percentile(h, 50) / 1e3, histogram_percentile(h, 99) / 1e3);
+    }
+    printf("\n");
+}
+
+typedef struct {
+    const char *domain;
+    size_t live;
+    size_t missing;
+    size_t errors;
+    double latency_ms;
+} ProbeTally;
+
+// ========== CRT.SH ==========
+static void count_passive(const PassiveName *name, void *userdata) {
+    (void)name;
+    (*(size_t *)userdata)++;
+}
+
+static void bench_crtsh(HttpClient *http, const DomainMatcher *target) {
+    PassiveSource source;
+    PhaseStats phase;
+    phase_init(&phase, "crt.sh");
+    passive_crtsh(&source, target, CRTSH_URL, http, NULL, 0, 0);
+    source.phase = &phase;
+    source.metrics = metrics_phase(&metrics, "crtsh");
+
+    size_t names = 0;
+    double t0 = monotonic_ms();
+    if(!passive_run(&source, 1, count_passive, &names) || !source.ok) {
+        printf("crt.sh via mock: %s\n", source.error ? source.error : "failed");
+        return;
+    }
+    bench_row("crt.sh fetch + parse", names, source.bytes, monotonic_ms() - t0);
+    printf("  %s\n", source.note);
+    print_stages("crtsh");
+}
+
+// ========== PROBES ==========
+static const char *probe_host(size_t *index, char *buf, size_t cap, void *userdata) {
+    const ProbeTally *tally = (const ProbeTally *)userdata;
+    snprintf(buf, cap, "w%zu.%s", *index, tally->domain);
+    return buf;
+}
+
+static void on_probe(size_t index, const char *host, const ProbeResult *result, void *userdata) {
+    (void)index; (void)host;
+    ProbeTally *tally = (ProbeTally *)userdata;
+    tally->latency_ms += result->latency_ms;
+    if(result->code != CURLE_OK) tally->errors++;
+    else if(result->http_status == 200) tally->live++;
+    else tally->missing++;
+}
+
+static void bench_probes(HttpClient *http, const char *domain, size_t names, int parallel, int rate,
+                         int adaptive) {
+    AdaptiveDeadline deadline;
+    deadline_init(&deadline, DEADLINE_FLOOR_MS, PROBE_TIMEOUT_SEC * 1000.0, DEADLINE_CEILING_MS);
+    ProbeConfig cfg = {
+        .http = http,
+        .timeout_sec = PROBE_TIMEOUT_SEC,
+        .deadline = adaptive ? &deadline : NULL,
+        .max_parallel = parallel,
+        .stop = NULL,
+        .metrics = metrics_phase(&metrics, "probe"),
+    };
+    TokenBucket bucket;
+    PhaseStats phase;
+    token_bucket_init(&bucket, rate, 0, 0);  // rate 0 = unpaced
+    phase_init(&phase, "probes");
+
+    ProbeTally tally = { domain, 0, 0, 0, 0 };
+    double t0 = monotonic_ms();
+    if(!probe_run(&cfg, &bucket, &phase, names, probe_host, on_probe, &tally)) {
+        printf("probe engine failed to start\n");
+        token_bucket_free(&bucket);
+        deadline_free(&deadline);
+        return;
+    }
+    char label[64];
+    snprintf(label, sizeof(label), "probes (%d in flight%s)", parallel, adaptive ? ", adaptive" : "");
+    bench_row(label, names, 0, monotonic_ms() - t0);
+    printf("  %zu live, %zu not found, %zu errors, mean latency %.1f ms, start rate %.0f/min\n",
+           tally.live, tally.missing, tally.errors,
+           names ? tally.latency_ms / names : 0.0, phase_rate_per_min(&phase));
+    if(adaptive) {
+        printf("  deadlines: connect %ld ms (p99 %.1f), response %ld ms (p99 %.1f), %zu timeouts cost %.1f sec, widened %zu times\n",
+               deadline_connect_ms(&deadline), deadline.connect.p99_ms, deadline_response_ms(&deadline),
+               deadline.response.p99_ms, deadline.timeouts, deadline.timeout_ms / 1000.0, deadline.widened);
+    }
+    print_stages("probe");
+    token_bucket_free(&bucket);
+    deadline_free(&deadline);
+}
+
+// ========== MAIN ==========
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "socks",    required_argument, NULL, 's' },
+        { "names",    required_argument, NULL, 'n' },
+        { "parallel", required_argument, NULL, 'P' },
+        { "rate",     required_argument, NULL, 'r' },
+        { "domain",   required_argument, NULL, 'd' },
+        { "no-ct",    no_argument,       NULL, 'C' },
+        { "adaptive", no_argument,       NULL, 'a' },
+        { NULL, 0, NULL, 0 }
+    };
+    int socks_port = DEFAULT_SOCKS_PORT, parallel = DEFAULT_PARALLEL, rate = 0, ct = 1, adaptive = 0;
+    size_t names = DEFAULT_NAMES;
+    const char *domain = "bench.test";
+
+    int opt;
+    while((opt = getopt_long(argc, argv, "s:n:P:r:d:Ca", long_options, NULL)) != -1) {
+        switch(opt) {
+            case 's': socks_port = atoi(optarg); break;
+            case 'n': names = strtoul(optarg, NULL, 10); break;
+            case 'P': parallel = atoi(optarg); break;
+            case 'r': rate = atoi(optarg); break;
+            case 'd': domain = optarg; break;
+            case 'C': ct = 0; break;
+            case 'a': adaptive = 1; break;
+            default:
+                fprintf(stderr, "Usage: %s [--socks PORT] [--names N] [--parallel P] "
+                        "[--rate PER_MIN] [--domain DOMAIN] [--no-ct] [--adaptive]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    // socks5h: hostnames go to the stand-in unresolved, as no DNS exists here
+    char proxy[64];
+    snprintf(proxy, sizeof(proxy), "socks5h://127.0.0.1:%d", socks_port);
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    HttpClient http;
+    DomainMatcher target;
+    if(!http_client_init(&http, proxy, "shadowscan-bench") || !domain_matcher_init(&target, domain)) {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+
+    metrics_init(&metrics);
+    bench_header("End to end via mock_server");
+    if(ct) bench_crtsh(&http, &target);
+    bench_probes(&http, target.domain, names, parallel, rate, adaptive);
+
+    metrics_free(&metrics);
+    http_client_free(&http);
+    curl_global_cleanup();
+    return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * gen_fixtures.c - Synthetic corpora for the benchmarks
+ * Writes, into DIR:
+ *   wordlist.txt   WORDS lines of subdomain-looking labels, ~2% duplicates
+ *   crtsh.json     a crt.sh-shaped JSON array of about CT_MB megabytes
+ * The output is a pure function of the arguments, so two machines (or two
+ * commits) always benchmark the same bytes.
+ *
+ * Usage: gen_fixtures DIR [WORDS] [CT_MB] [DOMAIN]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "bench.h"
+
+// ========== CONFIGURATION ==========
+#define DEFAULT_WORDS   1000000
+#define DEFAULT_CT_MB   500
+#define DEFAULT_DOMAIN  "bench.test"
+
+static const char *tokens[] = {
+    "api", "www", "mail", "dev", "staging", "prod", "test", "admin", "vpn", "cdn",
+    "static", "assets", "app", "portal", "auth", "login", "sso", "git", "ci", "build",
+    "db", "cache", "queue", "internal", "eu", "us", "ap", "west", "east", "north",
+    "v1", "v2", "beta", "alpha", "demo", "shop", "pay", "docs", "status", "metrics",
+};
+#define TOKEN_COUNT (sizeof(tokens) / sizeof(tokens[0]))
+
+// ========== NAMES ==========
+// Labels like "api", "api-eu2", "staging.eu-west" with a long tail of numbers
+static void make_label(BenchRng *r, char *buf, size_t cap) {
+    const char *a = tokens[bench_rng_below(r, TOKEN_COUNT)];
+    const char *b = tokens[bench_rng_below(r, TOKEN_COUNT)];
+    switch(bench_rng_below(r, 4)) {
+        case 0:  snprintf(buf, cap, "%s", a); break;
+        case 1:  snprintf(buf, cap, "%s-%s", a, b); break;
+        case 2:  snprintf(buf, cap, "%s%zu", a, bench_rng_below(r, 1000)); break;
+        default: snprintf(buf, cap, "%s-%s%zu", a, b, bench_rng_below(r, 100000)); break;
+    }
+}
+
+static int write_wordlist(const char *path, size_t words) {
+    FILE *fp = fopen(path, "w");
+    if(!fp) return 0;
+
+    BenchRng r;
+    bench_rng_seed(&r, 1);
+    char label[128];
+    for(size_t i = 0; i < words; i++) {
+        make_label(&r, label, sizeof(label));
+        // A unique suffix keeps duplicates rare but present
+        if(bench_rng_below(&r, 50) != 0) fprintf(fp, "%s-%zx\n", label, i);
+        else fprintf(fp, "%s\n", label);
+    }
+    return fclose(fp) == 0;
+}
+
+// ========== CRT.SH JSON ==========
+static void make_date(BenchRng *r, char *buf, size_t cap, int year) {
+    snprintf(buf, cap, "%d-%02zu-%02zuT%02zu:%02zu:%02zu", year,
+             1 + bench_rng_below(r, 12), 1 + bench_rng_below(r, 28),
+             bench_rng_below(r, 24), bench_rng_below(r, 60), bench_rng_below(r, 60));
+}
+
+static int write_crtsh(const char *path, size_t megabytes, const char *domain) {
+    FILE *fp = fopen(path, "w");
+    if(!fp) return 0;
+
+    BenchRng r;
+    bench_rng_seed(&r, 2);
+    size_t limit = megabytes * 1024 * 1024;
+    size_t written = 0, id = 1000000000;
+    char label[128], names[1024], begin[32], end[32];
+
+    written += fprintf(fp, "[");
+    while(written < limit) {
+        // One to four SANs per certificate, sometimes a wildcard, rarely out of scope
+        size_t sans = 1 + bench_rng_below(&r, 4), len = 0;
+        names[0] = '\0';
+        for(size_t i = 0; i < sans && len < sizeof(names) - 160; i++) {
+            make_label(&r, label, sizeof(label));
+            const char *star = bench_rng_below(&r, 10) == 0 ? "*." : "";
+            const char *zone = bench_rng_below(&r, 50) == 0 ? "other.example" : domain;
+            len += snprintf(names + len, sizeof(names) - len, "%s%s%s.%s", i ? "\\n" : "", star, label, zone);
+        }
+        int year = 2019 + (int)bench_rng_below(&r, 6);
+        make_date(&r, begin, sizeof(begin), year);
+        make_date(&r, end, sizeof(end), year + 1);
+
+        written += fprintf(fp,
+            "%s{\"issuer_ca_id\":%zu,\"issuer_name\":\"C=US, O=Let's Encrypt, CN=R%zu\","
+            "\"common_name\":\"%s.%s\",\"name_value\":\"%s\",\"id\":%zu,"
+            "\"entry_timestamp\":\"%s.%03zu\",\"not_before\":\"%s\",\"not_after\":\"%s\","
+            "\"serial_number\":\"%016llx%016llx\",\"result_count\":%zu}",
+            id > 1000000000 ? "," : "", 16418 + bench_rng_below(&r, 8), 3 + bench_rng_below(&r, 8),
+            label, domain, names, id, begin, bench_rng_below(&r, 1000), begin, end,
+            (unsigned long long)bench_rng_next(&r), (unsigned long long)bench_rng_next(&r),
+            2 + bench_rng_below(&r, 3));
+        id++;
+    }
+    fprintf(fp, "]\n");
+    return fclose(fp) == 0;
+}
+
+// ========== MAIN ==========
+int main(int argc, char *argv[]) {
+    if(argc < 2) {
+        fprintf(stderr, "Usage: %s DIR [WORDS] [CT_MB] [DOMAIN]\n", argv[0]);
+        return 1;
+    }
+    const char *dir = argv[1];
+    size_t words = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_WORDS;
+    size_t ct_mb = argc > 3 ? strtoul(argv[3], NULL, 10) : DEFAULT_CT_MB;
+    const char *domain = argc > 4 ? argv[4] : DEFAULT_DOMAIN;
+
+    mkdir(dir, 0755);
+    char path[4096];
+
+    snprintf(path, sizeof(path), "%s/wordlist.txt", dir);
+    if(!write_wordlist(path, words)) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    printf("%s: %zu words\n", path, words);
+
+    snprintf(path, sizeof(path), "%s/crtsh.json", dir);
+    if(!write_crtsh(path, ct_mb, domain)) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    printf("%s: %zu MB for %s\n", path, ct_mb, domain);
+    return 0;
+}
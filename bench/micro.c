@@ -0,0 +1,544 @@
+/*
+ * micro.c - Microbenchmarks for the scanner's hot paths
+ *   wordlist_load      text and compiled wordlists (what load_wordlist() runs)
+ *   ct_stream          name_value extraction from a crt.sh answer
+ *   ct_log_scan        SAN/CN extraction from synthetic get-entries batches
+ *   result_store_add   new names, then the same names again (merge path)
+ *   domain_match       the per-name scope filter
+ *   domain_scan        the scope filter over raw dump text
+ *   asn_lookup         IPv4 address to network over a synthetic iptoasn table
+ *   zone_file          owner and NS/CNAME extraction from a TLD-shaped zone file
+ * Each benchmark runs REPEAT times and the fastest run is reported.
+ *
+ * Usage: micro FIXTURE_DIR [REPEAT] [DOMAIN]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "../rate.h"
+#include "../wordlist.h"
+#include "../ct_stream.h"
+#include "../ct_log.h"
+#include "../result_store.h"
+#include "../domain_match.h"
+#include "../asn.h"
+#include "../zone.h"
+
+// ========== CONFIGURATION ==========
+#define DEFAULT_REPEAT  3
+#define STORE_NAMES     1000000
+#define CT_CHUNK        65536       // curl hands the parser at most this much
+#define CT_LOG_ENTRIES  200000      // Half x509_entry, half precert_entry leaves
+#define ASN_RANGES      500000      // About the size of the public IPv4 table
+#define ASN_NETWORKS    70000
+#define ASN_LOOKUPS     10000000
+#define ZONE_DELEGATIONS 3000000    // Two NS records each, every 100th in scope
+
+typedef struct {
+    const char *data;
+    size_t size;
+} MappedFile;
+
+static int map_file(MappedFile *m, const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        if(fd >= 0) close(fd);
+        return 0;
+    }
+    m->size = (size_t)st.st_size;
+    m->data = mmap(NULL, m->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(m->data == MAP_FAILED) return 0;
+    madvise((void *)m->data, m->size, MADV_SEQUENTIAL);
+    return 1;
+}
+
+// ========== WORDLIST ==========
+static void bench_wordlist(const char *dir, int repeat) {
+    char text[4096], compiled[4096];
+    snprintf(text, sizeof(text), "%s/wordlist.txt", dir);
+    snprintf(compiled, sizeof(compiled), "%s/wordlist.sswl", dir);
+
+    double best = 0;
+    size_t count = 0, size = 0;
+    for(int i = 0; i < repeat; i++) {
+        Wordlist wl;
+        double t0 = monotonic_ms();
+        if(!wordlist_load(&wl, text, 0)) {
+            printf("wordlist_load: %s\n", wl.error ? wl.error : "failed");
+            return;
+        }
+        double ms = monotonic_ms() - t0;
+        if(i == 0 || ms < best) best = ms;
+        count = wl.count;
+        size = wl.size;
+        if(i == 0 && !wordlist_compile(&wl, compiled)) printf("wordlist_compile failed\n");
+        wordlist_free(&wl);
+    }
+    bench_row("wordlist_load (text)", count, size, best);
+
+    for(int i = 0; i < repeat; i++) {
+        Wordlist wl;
+        double t0 = monotonic_ms();
+        if(!wordlist_load(&wl, compiled, 0)) return;
+        // Touch every word: a compiled list is only mapped at load time
+        char buf[WORDLIST_MAX_WORD_LEN + 1];
+        size_t len, total = 0;
+        for(size_t w = 0; w < wl.count; w++) total += wordlist_word(&wl, w, buf, &len) ? len : 0;
+        double ms = monotonic_ms() - t0;
+        if(i == 0 || ms < best) best = ms;
+        count = wl.count;
+        size = total;
+        wordlist_free(&wl);
+    }
+    bench_row("wordlist_load (compiled)", count, size, best);
+}
+
+// ========== CT EXTRACTION ==========
+static void count_name(const char *name, size_t len, const CtEntryInfo *info, void *userdata) {
+    (void)name; (void)len; (void)info;
+    (*(size_t *)userdata)++;
+}
+
+static void bench_ct(const MappedFile *ct, int repeat) {
+    double best = 0;
+    size_t names = 0;
+    for(int i = 0; i < repeat; i++) {
+        CtStreamParser p;
+        names = 0;
+        ct_stream_init(&p, count_name, &names);
+        double t0 = monotonic_ms();
+        int ok = 1;
+        for(size_t off = 0; ok && off < ct->size; off += CT_CHUNK) {
+            size_t n = ct->size - off < CT_CHUNK ? ct->size - off : CT_CHUNK;
+            ok = ct_stream_feed(&p, ct->data + off, n);
+        }
+        ok = ok && ct_stream_finish(&p);
+        double ms = monotonic_ms() - t0;
+        ct_stream_free(&p);
+        if(!ok) {
+            printf("ct_stream: parse error\n");
+            return;
+        }
+        if(i == 0 || ms < best) best = ms;
+    }
+    bench_row("ct_stream name_value", names, ct->size, best);
+}
+
+static void on_hit(const char *name, size_t len, void *userdata) {
+    (void)name; (void)len;
+    (*(size_t *)userdata)++;
+}
+
+// ========== CT LOG ENTRIES ==========
+typedef struct {
+    unsigned char d[1024];
+    size_t n;
+} DerBuf;
+
+static void der_put(DerBuf *b, unsigned char tag, const void *content, size_t len) {
+    b->d[b->n++] = tag;
+    if(len >= 256) {
+        b->d[b->n++] = 0x82;
+        b->d[b->n++] = (unsigned char)(len >> 8);
+    } else if(len >= 128) {
+        b->d[b->n++] = 0x81;
+    }
+    b->d[b->n++] = (unsigned char)len;
+    memcpy(b->d + b->n, content, len);
+    b->n += len;
+}
+
+static void der_wrap(DerBuf *b, unsigned char tag, const DerBuf *inner) {
+    der_put(b, tag, inner->d, inner->n);
+}
+
+// Shaped like a real leaf's TBSCertificate: CN plus three dNSName SANs
+static void make_tbs(DerBuf *tbs, BenchRng *r, const char *domain) {
+    static const unsigned char cn_oid[] = { 0x55, 0x04, 0x03 }, san_oid[] = { 0x55, 0x1d, 0x11 };
+    static const unsigned char ec_oid[] = { 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01 };
+    static const unsigned char version = 2;
+    unsigned char serial[16], key[65];
+    for(size_t i = 0; i < sizeof(serial); i++) serial[i] = (unsigned char)bench_rng_below(r, 128);
+    memset(key, 4, sizeof(key));
+
+    char names[3][96];
+    for(int i = 0; i < 3; i++) {
+        snprintf(names[i], sizeof(names[i]), "%s%zx.%s", i == 1 ? "*.api" : "host", bench_rng_next(r) & 0xffffff, domain);
+    }
+
+    DerBuf v = { .n = 0 }, alg = { .n = 0 }, atv = { .n = 0 }, rdn = { .n = 0 }, name = { .n = 0 };
+    DerBuf subject = { .n = 0 }, validity = { .n = 0 }, spki = { .n = 0 }, body = { .n = 0 };
+    der_put(&v, 0x02, &version, 1);
+    der_wrap(&body, 0xa0, &v);
+    der_put(&body, 0x02, serial, sizeof(serial));
+    der_put(&alg, 0x06, ec_oid, sizeof(ec_oid));
+    der_wrap(&body, 0x30, &alg);
+
+    der_put(&atv, 0x06, cn_oid, sizeof(cn_oid));
+    der_put(&atv, 0x0c, "Bench CA", 8);
+    der_wrap(&rdn, 0x30, &atv);
+    der_wrap(&name, 0x31, &rdn);
+    der_wrap(&body, 0x30, &name);                     // issuer
+    der_put(&validity, 0x17, "260101000000Z", 13);
+    der_put(&validity, 0x17, "270101000000Z", 13);
+    der_wrap(&body, 0x30, &validity);
+
+    atv.n = rdn.n = 0;
+    der_put(&atv, 0x06, cn_oid, sizeof(cn_oid));
+    der_put(&atv, 0x0c, names[0], strlen(names[0]));
+    der_wrap(&rdn, 0x30, &atv);
+    der_wrap(&subject, 0x31, &rdn);
+    der_wrap(&body, 0x30, &subject);
+    der_wrap(&spki, 0x30, &alg);
+    der_put(&spki, 0x03, key, sizeof(key));
+    der_wrap(&body, 0x30, &spki);
+
+    DerBuf general = { .n = 0 }, seq = { .n = 0 }, ext = { .n = 0 }, exts = { .n = 0 }, wrapper = { .n = 0 };
+    for(int i = 0; i < 3; i++) der_put(&general, 0x82, names[i], strlen(names[i]));
+    der_wrap(&seq, 0x30, &general);
+    der_put(&ext, 0x06, san_oid, sizeof(san_oid));
+    der_wrap(&ext, 0x04, &seq);
+    der_wrap(&exts, 0x30, &ext);
+    der_wrap(&wrapper, 0x30, &exts);
+    der_wrap(&body, 0xa3, &wrapper);
+
+    tbs->n = 0;
+    der_wrap(tbs, 0x30, &body);
+}
+
+static size_t base64_encode(const unsigned char *src, size_t len, char *dst) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t n = 0;
+    for(size_t i = 0; i < len; i += 3) {
+        unsigned int v = (unsigned int)src[i] << 16;
+        if(i + 1 < len) v |= (unsigned int)src[i + 1] << 8;
+        if(i + 2 < len) v |= src[i + 2];
+        dst[n++] = alphabet[(v >> 18) & 63];
+        dst[n++] = alphabet[(v >> 12) & 63];
+        dst[n++] = i + 1 < len ? alphabet[(v >> 6) & 63] : '=';
+        dst[n++] = i + 2 < len ? alphabet[v & 63] : '=';
+    }
+    return n;
+}
+
+// One get-entries batch per 1000 entries, one batch per line
+static char *make_ct_log(const char *domain, size_t *size) {
+    char *text = malloc((size_t)CT_LOG_ENTRIES * 1600 + 64);
+    if(!text) return NULL;
+    BenchRng r;
+    bench_rng_seed(&r, 5);
+
+    size_t n = 0;
+    for(size_t i = 0; i < CT_LOG_ENTRIES; i++) {
+        DerBuf tbs, cert = { .n = 0 }, inner = { .n = 0 };
+        unsigned char leaf[1200], sig[72];
+        make_tbs(&tbs, &r, domain);
+
+        size_t len = 0;
+        memset(leaf, 0, 12);
+        leaf[11] = (unsigned char)(i & 1);            // x509_entry / precert_entry
+        len = 12;
+        const DerBuf *body = &tbs;
+        if(i & 1) {
+            memset(leaf + len, 0x11, 32);             // Issuer key hash
+            len += 32;
+        } else {
+            static const unsigned char ecdsa_sha256[] = { 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02 };
+            DerBuf alg = { .n = 0 };
+            memset(sig, 0x5a, sizeof(sig));
+            memcpy(inner.d, tbs.d, tbs.n);
+            inner.n = tbs.n;
+            der_put(&alg, 0x06, ecdsa_sha256, sizeof(ecdsa_sha256));
+            der_wrap(&inner, 0x30, &alg);
+            der_put(&inner, 0x03, sig, sizeof(sig));
+            der_wrap(&cert, 0x30, &inner);
+            body = &cert;
+        }
+        leaf[len++] = (unsigned char)(body->n >> 16);
+        leaf[len++] = (unsigned char)(body->n >> 8);
+        leaf[len++] = (unsigned char)body->n;
+        memcpy(leaf + len, body->d, body->n);
+        len += body->n;
+        leaf[len++] = 0;                              // No CtExtensions
+        leaf[len++] = 0;
+
+        if(i % 1000 == 0) n += (size_t)sprintf(text + n, "%s{\"entries\":[", i ? "]}\n" : "");
+        n += (size_t)sprintf(text + n, "%s{\"leaf_input\":\"", i % 1000 ? "," : "");
+        n += base64_encode(leaf, len, text + n);
+        n += (size_t)sprintf(text + n, "\",\"extra_data\":\"\"}");
+    }
+    n += (size_t)sprintf(text + n, "]}\n");
+    *size = n;
+    return text;
+}
+
+static void bench_ct_log(const char *domain, int repeat) {
+    DomainMatcher m;
+    size_t size = 0;
+    char *text = make_ct_log(domain, &size);
+    if(!text || !domain_matcher_init(&m, domain)) {
+        free(text);
+        return;
+    }
+
+    double best = 0;
+    CtLogStats stats;
+    for(int i = 0; i < repeat; i++) {
+        size_t hits = 0;
+        memset(&stats, 0, sizeof(stats));
+        double t0 = monotonic_ms();
+        ct_log_scan(text, size, &m, on_hit, &hits, &stats);
+        double ms = monotonic_ms() - t0;
+        if(i == 0 || ms < best) best = ms;
+    }
+    bench_row("ct_log_scan (1 thread)", stats.entries, size, best);
+    if(stats.malformed) printf("ct_log_scan: %zu malformed entries\n", stats.malformed);
+    free(text);
+}
+
+// ========== RESULT STORE ==========
+static void bench_store(const char *domain, int repeat) {
+    char (*names)[64] = malloc((size_t)STORE_NAMES * 64);
+    if(!names) return;
+    BenchRng r;
+    bench_rng_seed(&r, 3);
+    for(size_t i = 0; i < STORE_NAMES; i++) {
+        snprintf(names[i], 64, "h%zx-%zu.%s", i, bench_rng_below(&r, 100), domain);
+    }
+
+    double best_new = 0, best_dup = 0;
+    size_t memory = 0;
+    for(int i = 0; i < repeat; i++) {
+        ResultStore store;
+        result_store_init(&store);
+        int is_new;
+        double t0 = monotonic_ms();
+        for(size_t n = 0; n < STORE_NAMES; n++) {
+            result_store_add(&store, names[n], 1, NULL, 0, SOURCE_CT, &is_new);
+        }
+        double t1 = monotonic_ms();
+        for(size_t n = 0; n < STORE_NAMES; n++) {
+            result_store_add(&store, names[n], 1, NULL, 200, SOURCE_HTTP, &is_new);
+        }
+        double t2 = monotonic_ms();
+        if(i == 0 || t1 - t0 < best_new) best_new = t1 - t0;
+        if(i == 0 || t2 - t1 < best_dup) best_dup = t2 - t1;
+        memory = result_store_memory(&store);
+        result_store_free(&store);
+    }
+    bench_row("result_store_add (new)", STORE_NAMES, 0, best_new);
+    bench_row("result_store_add (merge)", STORE_NAMES, 0, best_dup);
+    printf("%-28s %12.1f MB for %d names\n", "  store memory", memory / (1024.0 * 1024.0), STORE_NAMES);
+    free(names);
+}
+
+// ========== DOMAIN FILTER ==========
+static void bench_domain(const MappedFile *ct, const char *domain, int repeat) {
+    DomainMatcher m;
+    if(!domain_matcher_init(&m, domain)) return;
+
+    // Half in scope, the rest lookalikes that must be rejected
+    static const char *fakes[] = { "not%s", "%s.evil", "x-%s", "%s-cdn.net" };
+    char (*names)[96] = malloc((size_t)STORE_NAMES * 96);
+    if(!names) return;
+    BenchRng r;
+    bench_rng_seed(&r, 4);
+    for(size_t i = 0; i < STORE_NAMES; i++) {
+        char zone[64];
+        if(i % 2) snprintf(zone, sizeof(zone), fakes[bench_rng_below(&r, 4)], domain);
+        else snprintf(zone, sizeof(zone), "%s", domain);
+        snprintf(names[i], 96, "%s%zx.%s", i % 3 ? "API" : "www", i, zone);
+    }
+
+    double best = 0;
+    size_t hits = 0;
+    for(int i = 0; i < repeat; i++) {
+        hits = 0;
+        double t0 = monotonic_ms();
+        for(size_t n = 0; n < STORE_NAMES; n++) hits += domain_match(&m, names[n], strlen(names[n]));
+        double ms = monotonic_ms() - t0;
+        if(i == 0 || ms < best) best = ms;
+    }
+    bench_row("domain_match", STORE_NAMES, 0, best);
+    free(names);
+
+    if(!ct->size) return;
+    for(int i = 0; i < repeat; i++) {
+        hits = 0;
+        double t0 = monotonic_ms();
+        domain_scan(&m, ct->data, ct->size, on_hit, &hits);
+        double ms = monotonic_ms() - t0;
+        if(i == 0 || ms < best) best = ms;
+    }
+    bench_row("domain_scan (crtsh.json)", hits, ct->size, best);
+}
+
+// ========== ASN LOOKUP ==========
+// iptoasn-style TSV: back-to-back ranges of 256 to 8192 addresses with a few gaps
+static int make_asn_dataset(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if(!fp) return 0;
+    BenchRng r;
+    bench_rng_seed(&r, 6);
+    uint64_t pos = 1u << 24;
+    for(size_t i = 0; i < ASN_RANGES && pos < UINT32_MAX - 8192; i++) {
+        uint64_t end = pos + (256u << bench_rng_below(&r, 6)) - 1;
+        size_t asn = 1 + bench_rng_below(&r, ASN_NETWORKS);
+        fprintf(fp, "%u.%u.%u.%u\t%u.%u.%u.%u\t%zu\tUS\tORG-%zu\n",
+                (unsigned)(pos >> 24), (unsigned)(pos >> 16) & 255, (unsigned)(pos >> 8) & 255, (unsigned)pos & 255,
+                (unsigned)(end >> 24), (unsigned)(end >> 16) & 255, (unsigned)(end >> 8) & 255, (unsigned)end & 255,
+                asn, asn);
+        pos = end + 1 + (bench_rng_below(&r, 4) == 0 ? 256 : 0);
+    }
+    return fclose(fp) == 0;
+}
+
+static void bench_asn(const char *dir, int repeat) {
+    char text[4096], compiled[4096];
+    snprintf(text, sizeof(text), "%s/ip2asn.tsv", dir);
+    snprintf(compiled, sizeof(compiled), "%s/ip2asn.ssas", dir);
+    if(access(text, R_OK) != 0 && !make_asn_dataset(text)) {
+        printf("asn: cannot write %s\n", text);
+        return;
+    }
+
+    AsnDb db;
+    double best = 0;
+    for(int i = 0; i < repeat; i++) {
+        double t0 = monotonic_ms();
+        if(!asn_load(&db, text)) {
+            printf("asn_load: %s\n", db.error ? db.error : "failed");
+            return;
+        }
+        double ms = monotonic_ms() - t0;
+        if(i == 0 || ms < best) best = ms;
+        if(i == 0 && !asn_compile(&db, compiled)) printf("asn_compile failed\n");
+        asn_free(&db);
+    }
+    bench_row("asn_load (text)", ASN_RANGES, 0, best);
+
+    for(int i = 0; i < repeat; i++) {
+        double t0 = monotonic_ms();
+        if(!asn_load(&db, compiled)) {
+            printf("asn_load: %s\n", db.error ? db.error : "failed");
+            return;
+        }
+        double ms = monotonic_ms() - t0;
+        if(i == 0 || ms < best) best = ms;
+        if(i < repeat - 1) asn_free(&db);
+    }
+    bench_row("asn_load (compiled)", db.v4_count, db.size, best);
+
+    uint32_t *addrs = malloc((size_t)ASN_LOOKUPS * sizeof(uint32_t));
+    if(!addrs) {
+        asn_free(&db);
+        return;
+    }
+    BenchRng r;
+    bench_rng_seed(&r, 7);
+    for(size_t i = 0; i < ASN_LOOKUPS; i++) addrs[i] = (uint32_t)bench_rng_next(&r);
+
+    size_t hits = 0;
+    for(int i = 0; i < repeat; i++) {
+        hits = 0;
+        double t0 = monotonic_ms();
+        for(size_t n = 0; n < ASN_LOOKUPS; n++) hits += asn_lookup_v4(&db, addrs[n]) != NULL;
+        double ms = monotonic_ms() - t0;
+        if(i == 0 || ms < best) best = ms;
+    }
+    bench_row("asn_lookup_v4 (random)", ASN_LOOKUPS, 0, best);
+    printf("%-28s %12zu of %d addresses matched\n", "  asn hits", hits, ASN_LOOKUPS);
+    free(addrs);
+    asn_free(&db);
+}
+
+// ========== ZONE FILE ==========
+// The parent zone of `domain`: delegations with glue, relative and absolute
+// names, a multi-line SOA and a relative $ORIGIN halfway through
+static int make_zone(const char *path, const char *domain) {
+    const char *parent = strchr(domain, '.');
+    parent = parent ? parent + 1 : domain;
+    FILE *fp = fopen(path, "w");
+    if(!fp) return 0;
+
+    fprintf(fp, "$ORIGIN %s.\n$TTL 86400\n", parent);
+    fprintf(fp, "@ IN SOA a.nic.%s. hostmaster.nic.%s. (\n\t1 ; serial\n\t1800 900 604800 86400 )\n", parent, parent);
+    for(size_t i = 0; i < ZONE_DELEGATIONS; i++) {
+        if(i == ZONE_DELEGATIONS / 2) fprintf(fp, "$ORIGIN zz\n");
+        if(i % 100 == 0) {
+            fprintf(fp, "h%zu.%s.\tNS\tns1.h%zu.%s.\n", i, domain, i, domain);
+        } else {
+            fprintf(fp, "d%zu\tNS\tns1.d%zu\n", i, i);
+        }
+        fprintf(fp, "\t\tNS\tns2.dns-host.net.\n");
+        if(i % 10 == 0) fprintf(fp, "ns1.d%zu\t3600\tIN\tA\t192.0.2.%zu\n", i, i & 255);
+    }
+    return fclose(fp) == 0;
+}
+
+static void bench_zone(const char *dir, const char *domain, int repeat) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/zone.txt", dir);
+    DomainMatcher m;
+    if(!domain_matcher_init(&m, domain)) return;
+    if(access(path, R_OK) != 0 && !make_zone(path, domain)) {
+        printf("zone: cannot write %s\n", path);
+        return;
+    }
+
+    double best = 0;
+    ZoneStats stats;
+    for(int i = 0; i < repeat; i++) {
+        ResultStore out;
+        const char *error;
+        result_store_init(&out);
+        double t0 = monotonic_ms();
+        int ok = zone_file(path, &m, NULL, 0, &out, SOURCE_ZONE, &stats, &error);
+        double ms = monotonic_ms() - t0;
+        result_store_free(&out);
+        if(!ok) {
+            printf("zone_file: %s\n", error);
+            return;
+        }
+        if(i == 0 || ms < best) best = ms;
+    }
+    bench_row("zone_file (all cores)", stats.records, stats.bytes, best);
+    printf("%-28s %12zu names, %zu chunks\n", "  zone hits", stats.names, stats.chunks);
+}
+
+// ========== MAIN ==========
+int main(int argc, char *argv[]) {
+    if(argc < 2) {
+        fprintf(stderr, "Usage: %s FIXTURE_DIR [REPEAT] [DOMAIN]\n", argv[0]);
+        return 1;
+    }
+    const char *dir = argv[1];
+    int repeat = argc > 2 ? atoi(argv[2]) : DEFAULT_REPEAT;
+    const char *domain = argc > 3 ? argv[3] : "bench.test";
+    if(repeat < 1) repeat = 1;
+
+    char path[4096];
+    MappedFile ct = { NULL, 0 };
+    snprintf(path, sizeof(path), "%s/crtsh.json", dir);
+    if(!map_file(&ct, path)) printf("(no %s: CT benchmarks skipped)\n", path);
+
+    bench_header("Microbenchmarks (best of each)");
+    bench_wordlist(dir, repeat);
+    if(ct.size) bench_ct(&ct, repeat);
+    bench_ct_log(domain, repeat);
+    bench_store(domain, repeat);
+    bench_domain(&ct, domain, repeat);
+    bench_asn(dir, repeat);
+    bench_zone(dir, domain, repeat);
+
+    if(ct.size) munmap((void *)ct.data, ct.size);
+    return 0;
+}
@@ -0,0 +1,391 @@
+/*
+ * mock_server.c - Local stand-ins for Tor and the sites behind it
+ * A SOCKS5 listener accepts any CONNECT (IPv4, IPv6 or hostname) and
+ * splices it to a local HTTPS listener, so the scanner's own code paths
+ * run unchanged on a box without network access. The HTTPS side answers:
+ *   /api/ip          like check.torproject.org ({"IsTor":true})
+ *   /?q=...          the --ct file, streamed like a crt.sh answer
+ *   anything else    200 for HIT% of hostnames (stable per name), no answer
+ *                    at all for SILENT% (the client has to time out), 404 otherwise
+ * Latency is injected per SOCKS connect and per HTTP response.
+ *
+ * Usage: mock_server [--socks PORT] [--https PORT] [--ct FILE]
+ *                    [--latency MS] [--jitter MS] [--hit PERCENT]
+ *                    [--silent PERCENT] [--san DNS:a.example.com,DNS:b.example.com]
+ * Build: gcc -O2 bench/mock_server.c -o mock_server -lssl -lcrypto -lpthread
+ */
+
+#define _GNU_SOURCE  // strcasestr
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <getopt.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+// ========== CONFIGURATION ==========
+#define DEFAULT_SOCKS_PORT  1080
+#define DEFAULT_HTTPS_PORT  8443
+#define DEFAULT_HIT_PERCENT 5
+#define MAX_REQUEST         8192
+#define RELAY_BUFFER        65536
+
+typedef struct {
+    int socks_port;
+    int https_port;
+    const char *ct_file;
+    int latency_ms;
+    int jitter_ms;
+    int hit_percent;
+    int silent_percent;
+    const char *san;        // subjectAltName value for the certificate, NULL = none
+} MockConfig;
+
+static MockConfig config = { DEFAULT_SOCKS_PORT, DEFAULT_HTTPS_PORT, NULL, 0, 0, DEFAULT_HIT_PERCENT, 0, NULL };
+static SSL_CTX *tls;
+static volatile sig_atomic_t stopping = 0;
+static atomic_size_t socks_connections, tls_connections, requests, hits, ct_bytes;
+
+// ========== HELPERS ==========
+static void inject_latency() {
+    int ms = config.latency_ms;
+    if(config.jitter_ms > 0) ms += rand() % (config.jitter_ms + 1);
+    if(ms > 0) usleep((useconds_t)ms * 1000);
+}
+
+static int listen_on(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+    if(fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 512) != 0) {
+        fprintf(stderr, "cannot listen on 127.0.0.1:%d: %s\n", port, strerror(errno));
+        exit(1);
+    }
+    return fd;
+}
+
+static int read_exact(int fd, void *buf, size_t len) {
+    size_t got = 0;
+    while(got < len) {
+        ssize_t n = read(fd, (char *)buf + got, len - got);
+        if(n <= 0) return 0;
+        got += (size_t)n;
+    }
+    return 1;
+}
+
+// FNV-1a: the same hostname always gets the same answer
+static int host_bucket(const char *host) {
+    uint32_t h = 2166136261u;
+    for(; *host && *host != ':'; host++) h = (h ^ (unsigned char)*host) * 16777619u;
+    return (int)(h % 100);
+}
+
+static int host_is_live(const char *host) {
+    return host_bucket(host) < config.hit_percent;
+}
+
+static int host_is_silent(const char *host) {
+    return host_bucket(host) >= 100 - config.silent_percent;
+}
+
+// ========== TLS CERTIFICATE ==========
+// A throwaway self-signed P-256 certificate; the scanner does not verify peers
+static int setup_tls() {
+    EVP_PKEY *key = EVP_EC_gen("P-256");
+    X509 *cert = X509_new();
+    if(!key || !cert) return 0;
+
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 86400);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"shadowscan-mock", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    if(config.san) {
+        X509_EXTENSION *ext = X509V3_EXT_conf_nid(NULL, NULL, NID_subject_alt_name, config.san);
+        if(!ext || !X509_add_ext(cert, ext, -1)) return 0;
+        X509_EXTENSION_free(ext);
+    }
+    if(!X509_sign(cert, key, EVP_sha256())) return 0;
+
+    tls = SSL_CTX_new(TLS_server_method());
+    if(!tls || SSL_CTX_use_certificate(tls, cert) != 1 || SSL_CTX_use_PrivateKey(tls, key) != 1) return 0;
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return 1;
+}
+
+// ========== HTTPS ==========
+static int tls_write_all(SSL *ssl, const char *data, size_t len) {
+    while(len > 0) {
+        int n = SSL_write(ssl, data, len > INT32_MAX ? INT32_MAX : (int)len);
+        if(n <= 0) return 0;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+static int send_reply(SSL *ssl, const char *status, const char *type, const char *body, int head) {
+    char reply[512];
+    int n = snprintf(reply, sizeof(reply), "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n\r\n%s",
+                     status, type, strlen(body), head ? "" : body);
+    return n > 0 && (size_t)n < sizeof(reply) && tls_write_all(ssl, reply, (size_t)n);
+}
+
+static int send_ct_file(SSL *ssl, int head) {
+    FILE *fp = config.ct_file ? fopen(config.ct_file, "rb") : NULL;
+    if(!fp) return send_reply(ssl, "200 OK", "application/json", "[]", head);
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char header[256];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %ld\r\n\r\n", size);
+    int ok = tls_write_all(ssl, header, (size_t)n);
+
+    char *buf = malloc(RELAY_BUFFER);
+    size_t got;
+    while(ok && !head && buf && (got = fread(buf, 1, RELAY_BUFFER, fp)) > 0) {
+        ok = tls_write_all(ssl, buf, got);
+        if(ok) atomic_fetch_add(&ct_bytes, got);
+    }
+    free(buf);
+    fclose(fp);
+    return ok;
+}
+
+// Serves keep-alive requests until the client closes
+static void serve_https(int fd) {
+    SSL *ssl = SSL_new(tls);
+    SSL_set_fd(ssl, fd);
+    if(SSL_accept(ssl) != 1) {
+        SSL_free(ssl);
+        return;
+    }
+    atomic_fetch_add(&tls_connections, 1);
+
+    char req[MAX_REQUEST + 1];
+    size_t len = 0;
+    req[0] = '\0';
+    for(;;) {
+        char *end;
+        while(!(end = strstr(req, "\r\n\r\n"))) {
+            if(len >= MAX_REQUEST) goto done;
+            int n = SSL_read(ssl, req + len, (int)(MAX_REQUEST - len));
+            if(n <= 0) goto done;
+            len += (size_t)n;
+            req[len] = '\0';
+        }
+        end += 4;
+
+        char method[16] = "", path[1024] = "", host[256] = "";
+        sscanf(req, "%15s %1023s", method, path);
+        const char *h = strcasestr(req, "\r\nHost:");
+        if(h) sscanf(h + 7, " %255[^\r\n]", host);
+        int head = strcmp(method, "HEAD") == 0;
+        atomic_fetch_add(&requests, 1);
+        inject_latency();
+
+        int ok;
+        if(strncmp(path, "/api/ip", 7) == 0) {
+            ok = send_reply(ssl, "200 OK", "application/json", "{\"IsTor\":true,\"IP\":\"127.0.0.1\"}", head);
+        } else if(strncmp(path, "/?q=", 4) == 0) {
+            ok = send_ct_file(ssl, head);
+        } else if(host_is_silent(host)) {
+            // Hold the connection until the client gives up
+            char sink[256];
+            while(!stopping && SSL_read(ssl, sink, sizeof(sink)) > 0) {}
+            break;
+        } else if(host_is_live(host)) {
+            atomic_fetch_add(&hits, 1);
+            ok = send_reply(ssl, "200 OK", "text/html", "ok", head);
+        } else {
+            ok = send_reply(ssl, "404 Not Found", "text/html", "", head);
+        }
+        if(!ok) break;
+
+        // Keep any pipelined bytes for the next request
+        len -= (size_t)(end - req);
+        memmove(req, end, len);
+        req[len] = '\0';
+    }
+done:
+    SSL_shutdown(ssl);
+    SSL_free(ssl);
+}
+
+static void *https_thread(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    serve_https(fd);
+    close(fd);
+    return NULL;
+}
+
+// ========== SOCKS5 ==========
+// Both directions until either side closes
+static void relay(int a, int b) {
+    char *buf = malloc(RELAY_BUFFER);
+    struct pollfd fds[2] = { { a, POLLIN, 0 }, { b, POLLIN, 0 } };
+    while(buf && !stopping && poll(fds, 2, 1000) >= 0) {
+        for(int i = 0; i < 2; i++) {
+            if(!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            ssize_t n = read(fds[i].fd, buf, RELAY_BUFFER);
+            if(n <= 0) goto done;
+            for(ssize_t off = 0; off < n;) {
+                ssize_t w = write(fds[1 - i].fd, buf + off, (size_t)(n - off));
+                if(w <= 0) goto done;
+                off += w;
+            }
+        }
+    }
+done:
+    free(buf);
+}
+
+// RFC 1928 with no authentication; every CONNECT goes to the HTTPS listener
+static void serve_socks(int fd) {
+    unsigned char msg[262];
+    if(!read_exact(fd, msg, 2) || msg[0] != 5 || !read_exact(fd, msg + 2, msg[1])) return;
+    unsigned char choose[2] = { 5, 0 };
+    if(write(fd, choose, 2) != 2) return;
+
+    if(!read_exact(fd, msg, 4) || msg[1] != 1) return;  // CONNECT only
+    size_t skip = msg[3] == 1 ? 4 : msg[3] == 4 ? 16 : 0;
+    if(msg[3] == 3) {
+        if(!read_exact(fd, msg, 1)) return;
+        skip = msg[0];
+    }
+    if(!read_exact(fd, msg, skip + 2)) return;  // Address and port are ignored
+    atomic_fetch_add(&socks_connections, 1);
+    inject_latency();
+
+    int up = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)config.https_port);
+    int ok = up >= 0 && connect(up, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+
+    unsigned char reply[10] = { 5, ok ? 0 : 5, 0, 1, 0, 0, 0, 0, 0, 0 };
+    if(write(fd, reply, sizeof(reply)) == sizeof(reply) && ok) {
+        int one = 1;
+        setsockopt(up, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        relay(fd, up);
+    }
+    if(up >= 0) close(up);
+}
+
+static void *socks_thread(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    serve_socks(fd);
+    close(fd);
+    return NULL;
+}
+
+// ========== MAIN ==========
+static void on_signal(int sig) {
+    (void)sig;
+    stopping = 1;
+}
+
+static void spawn(void *(*fn)(void *), int fd) {
+    pthread_t t;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, 256 * 1024);
+    if(pthread_create(&t, &attr, fn, (void *)(intptr_t)fd) != 0) close(fd);
+    pthread_attr_destroy(&attr);
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "socks",   required_argument, NULL, 's' },
+        { "https",   required_argument, NULL, 'h' },
+        { "ct",      required_argument, NULL, 'c' },
+        { "latency", required_argument, NULL, 'l' },
+        { "jitter",  required_argument, NULL, 'j' },
+        { "hit",     required_argument, NULL, 'H' },
+        { "silent",  required_argument, NULL, 'Q' },
+        { "san",     required_argument, NULL, 'S' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while((opt = getopt_long(argc, argv, "s:h:c:l:j:H:Q:S:", long_options, NULL)) != -1) {
+        switch(opt) {
+            case 's': config.socks_port = atoi(optarg); break;
+            case 'h': config.https_port = atoi(optarg); break;
+            case 'c': config.ct_file = optarg; break;
+            case 'l': config.latency_ms = atoi(optarg); break;
+            case 'j': config.jitter_ms = atoi(optarg); break;
+            case 'H': config.hit_percent = atoi(optarg); break;
+            case 'Q': config.silent_percent = atoi(optarg); break;
+            case 'S': config.san = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [--socks PORT] [--https PORT] [--ct FILE] "
+                        "[--latency MS] [--jitter MS] [--hit PERCENT] [--silent PERCENT] [--san LIST]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if(!setup_tls()) {
+        ERR_print_errors_fp(stderr);
+        return 1;
+    }
+    int socks_fd = listen_on(config.socks_port);
+    int https_fd = listen_on(config.https_port);
+    printf("mock: SOCKS5 127.0.0.1:%d -> HTTPS 127.0.0.1:%d, latency %d+%d ms, %d%% live hosts, %d%% silent%s%s\n",
+           config.socks_port, config.https_port, config.latency_ms, config.jitter_ms, config.hit_percent, config.silent_percent,
+           config.ct_file ? ", CT answer " : "", config.ct_file ? config.ct_file : "");
+    fflush(stdout);
+
+    struct pollfd fds[2] = { { socks_fd, POLLIN, 0 }, { https_fd, POLLIN, 0 } };
+    while(!stopping) {
+        if(poll(fds, 2, 500) <= 0) continue;
+        for(int i = 0; i < 2; i++) {
+            if(!(fds[i].revents & POLLIN)) continue;
+            int fd = accept(fds[i].fd, NULL, NULL);
+            if(fd >= 0) spawn(i == 0 ? socks_thread : https_thread, fd);
+        }
+    }
+
+    printf("mock: %zu SOCKS connects, %zu TLS handshakes, %zu requests, %zu live answers, %.1f MB of CT data\n",
+           atomic_load(&socks_connections), atomic_load(&tls_connections), atomic_load(&requests),
+           atomic_load(&hits), atomic_load(&ct_bytes) / (1024.0 * 1024.0));
+    close(socks_fd);
+    close(https_fd);
+    SSL_CTX_free(tls);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#!/bin/sh
+# bench/run.sh - Build the benchmarks, generate fixtures once, run everything
+# Usage: bench/run.sh [FIXTURE_DIR]
+# Environment: WORDS (1000000) CT_MB (500) REPEAT (3) NAMES (5000)
+#              PARALLEL (32) LATENCY (50) JITTER (20) HIT (5) SOCKS_PORT (11080) HTTPS_PORT (18443)
+set -e
+cd "$(dirname "$0")/.."
+
+OUT=bench/out
+DIR=${1:-$OUT/fixtures}
+CFLAGS="-O2 -Wall -Wextra -I."
+LIB=$(ls *.c | grep -v '^shadowscan.c$')
+mkdir -p "$OUT"
+
+gcc $CFLAGS bench/gen_fixtures.c bench/bench.c -o "$OUT/gen_fixtures"
+gcc $CFLAGS bench/micro.c bench/bench.c $LIB -o "$OUT/micro" -lcurl -lpthread -lz
+gcc $CFLAGS bench/e2e.c bench/bench.c $LIB -o "$OUT/e2e" -lcurl -lpthread -lz
+gcc $CFLAGS bench/mock_server.c -o "$OUT/mock_server" -lssl -lcrypto -lpthread
+
+if [ ! -f "$DIR/crtsh.json" ]; then
+    "$OUT/gen_fixtures" "$DIR" "${WORDS:-1000000}" "${CT_MB:-500}"
+fi
+
+echo "commit $(git rev-parse --short HEAD 2>/dev/null || echo unknown)"
+"$OUT/micro" "$DIR" "${REPEAT:-3}"
+
+"$OUT/mock_server" --socks "${SOCKS_PORT:-11080}" --https "${HTTPS_PORT:-18443}" \
+    --ct "$DIR/crtsh.json" --latency "${LATENCY:-50}" --jitter "${JITTER:-20}" --hit "${HIT:-5}" &
+MOCK=$!
+trap 'kill $MOCK 2>/dev/null' EXIT
+sleep 1
+kill -0 $MOCK 2>/dev/null || { echo "mock_server did not start"; exit 1; }
+
+"$OUT/e2e" --socks "${SOCKS_PORT:-11080}" --names "${NAMES:-5000}" --parallel "${PARALLEL:-32}"
+kill -INT $MOCK
+wait $MOCK 2>/dev/null || true
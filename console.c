@@ -0,0 +1,238 @@
+/*
+ * console.c - Ring-buffered output rendered on a background thread
+ * Producers claim slots the same way the passive-source queue does; the
+ * renderer is the only consumer. console_flush() is the barrier callers
+ * use before printing directly, so output never interleaves.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <sched.h>
+#include "console.h"
+#include "rate.h"
+
+#define CLEAR_LINE "\r\033[K"
+
+// ========== RING ==========
+// Returns the claimed slot and its position, or NULL if the ring is full and `wait` is 0
+static ConsoleSlot *claim(Console *c, int wait, size_t *claimed) {
+    size_t pos = atomic_load_explicit(&c->head, memory_order_relaxed);
+    for(;;) {
+        ConsoleSlot *slot = &c->slots[pos & (CONSOLE_SLOTS - 1)];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if(diff == 0) {
+            if(atomic_compare_exchange_weak_explicit(&c->head, &pos, pos + 1,
+                                                     memory_order_relaxed, memory_order_relaxed)) {
+                *claimed = pos;
+                return slot;
+            }
+        } else if(diff < 0) {
+            if(!wait) return NULL;
+            sched_yield();
+            pos = atomic_load_explicit(&c->head, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&c->head, memory_order_relaxed);
+        }
+    }
+}
+
+static ConsoleSlot *next_ready(Console *c) {
+    ConsoleSlot *slot = &c->slots[c->tail & (CONSOLE_SLOTS - 1)];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    return seq == c->tail + 1 ? slot : NULL;
+}
+
+static void release(Console *c, ConsoleSlot *slot) {
+    atomic_store_explicit(&slot->seq, c->tail + CONSOLE_SLOTS, memory_order_release);
+    c->tail++;
+}
+
+// ========== RENDERER ==========
+static void *render_main(void *arg) {
+    Console *c = (Console *)arg;
+    int status_shown = 0;
+    double last_progress = 0;
+
+    for(;;) {
+        int wrote = 0;
+        ConsoleSlot *slot;
+        while((slot = next_ready(c))) {
+            if(slot->long_text) {
+                if(c->events) fwrite(slot->long_text, 1, slot->long_len, c->events);
+                free(slot->long_text);
+                slot->long_text = NULL;
+            } else if(slot->kind == CONSOLE_EVENT) {
+                if(c->events) fwrite(slot->text, 1, slot->len, c->events);
+            } else {
+                if(status_shown) {
+                    fputs(CLEAR_LINE, stdout);
+                    status_shown = 0;
+                }
+                fwrite(slot->text, 1, slot->len, stdout);
+                wrote = 1;
+            }
+            release(c, slot);
+        }
+
+        size_t dropped = atomic_exchange(&c->dropped, 0);
+        if(dropped) {
+            if(status_shown) fputs(CLEAR_LINE, stdout);
+            status_shown = 0;
+            printf("  ... %zu result lines not shown (terminal too slow); all results are in the output file\n", dropped);
+            wrote = 1;
+        }
+        size_t lost = atomic_exchange(&c->events_lost, 0);
+        if(lost) {
+            if(status_shown) fputs(CLEAR_LINE, stdout);
+            status_shown = 0;
+            printf("  ... %zu events left out of the event log (out of memory)\n", lost);
+            wrote = 1;
+        }
+
+        // Redraw the progress line in place, or log it now and then when piped
+        double now = monotonic_ms();
+        double period = c->tty ? CONSOLE_REFRESH_MS : CONSOLE_PLAIN_PROGRESS_SEC * 1000.0;
+        if(!c->quiet && now - last_progress >= period) {
+            pthread_mutex_lock(&c->progress_lock);
+            if(c->progress_dirty && c->progress[0]) {
+                if(c->tty) {
+                    printf(CLEAR_LINE "%s", c->progress);
+                    status_shown = 1;
+                } else {
+                    printf("%s\n", c->progress);
+                }
+                c->progress_dirty = 0;
+                wrote = 1;
+            }
+            pthread_mutex_unlock(&c->progress_lock);
+            last_progress = now;
+        }
+
+        // Everything queued before the request is out: hand the terminal back
+        unsigned want = atomic_load(&c->flush_requested);
+        if(want != atomic_load(&c->flush_done) && !next_ready(c)) {
+            if(status_shown) fputs(CLEAR_LINE, stdout);
+            status_shown = 0;
+            pthread_mutex_lock(&c->progress_lock);
+            c->progress[0] = '\0';  // A new phase sets its own progress
+            c->progress_dirty = 0;
+            pthread_mutex_unlock(&c->progress_lock);
+            fflush(stdout);
+            if(c->events) fflush(c->events);
+            atomic_store(&c->flush_done, want);
+            continue;
+        }
+
+        if(wrote) fflush(stdout);
+        if(atomic_load(&c->stopping) && !next_ready(c)) break;
+        if(!next_ready(c)) usleep(5000);
+    }
+    if(status_shown) fputs(CLEAR_LINE, stdout);
+    fflush(stdout);
+    if(c->events) fflush(c->events);
+    return NULL;
+}
+
+// ========== START / STOP ==========
+// Until this succeeds (or after console_stop) every call prints directly
+int console_start(Console *c, FILE *events, int quiet) {
+    memset(c, 0, sizeof(*c));
+    c->events = events;
+    c->quiet = quiet;
+    c->tty = isatty(STDOUT_FILENO);
+    c->slots = calloc(CONSOLE_SLOTS, sizeof(ConsoleSlot));
+    if(!c->slots) return 0;
+    for(size_t i = 0; i < CONSOLE_SLOTS; i++) atomic_init(&c->slots[i].seq, i);
+    pthread_mutex_init(&c->progress_lock, NULL);
+
+    if(pthread_create(&c->thread, NULL, render_main, c) != 0) {
+        free(c->slots);
+        c->slots = NULL;
+        pthread_mutex_destroy(&c->progress_lock);
+        return 0;
+    }
+    c->running = 1;
+    return 1;
+}
+
+void console_stop(Console *c) {
+    if(!c->running) return;
+    atomic_store(&c->stopping, 1);
+    pthread_join(c->thread, NULL);
+    c->running = 0;
+    free(c->slots);
+    c->slots = NULL;
+    pthread_mutex_destroy(&c->progress_lock);
+}
+
+// ========== OUTPUT ==========
+void console_printf(Console *c, ConsoleKind kind, const char *fmt, ...) {
+    if(kind == CONSOLE_DETAIL && c->quiet) return;
+    if(kind == CONSOLE_EVENT && !c->events) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    if(!c->running) {
+        vfprintf(kind == CONSOLE_EVENT ? c->events : stdout, fmt, ap);
+        va_end(ap);
+        return;
+    }
+
+    size_t pos;
+    ConsoleSlot *slot = claim(c, kind != CONSOLE_DETAIL, &pos);
+    if(!slot) {
+        va_end(ap);
+        atomic_fetch_add(&c->dropped, 1);
+        return;
+    }
+    va_list again;
+    va_copy(again, ap);
+    int n = vsnprintf(slot->text, sizeof(slot->text), fmt, ap);
+    va_end(ap);
+    if(n < 0) n = 0;
+    slot->long_text = NULL;
+    if((size_t)n >= sizeof(slot->text) && kind == CONSOLE_EVENT) {
+        // Half a JSON object is worse than none: keep the whole event or drop it
+        slot->long_text = malloc((size_t)n + 1);
+        if(slot->long_text) {
+            vsnprintf(slot->long_text, (size_t)n + 1, fmt, again);
+            slot->long_len = (size_t)n;
+        } else {
+            atomic_fetch_add(&c->events_lost, 1);
+        }
+        n = 0;
+    } else if((size_t)n >= sizeof(slot->text)) {
+        // Keep the line ending of a truncated line
+        n = sizeof(slot->text) - 1;
+        slot->text[n - 1] = '\n';
+    }
+    va_end(again);
+    slot->len = (unsigned short)n;
+    slot->kind = (unsigned char)kind;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);  // Ready for the renderer
+}
+
+// Replaces the progress text; the renderer picks up the latest at its next redraw
+void console_progress(Console *c, const char *fmt, ...) {
+    if(c->quiet || !c->running) return;
+    va_list ap;
+    va_start(ap, fmt);
+    pthread_mutex_lock(&c->progress_lock);
+    vsnprintf(c->progress, sizeof(c->progress), fmt, ap);
+    c->progress_dirty = 1;
+    pthread_mutex_unlock(&c->progress_lock);
+    va_end(ap);
+}
+
+// Waits until everything queued so far is written and the progress line is gone
+void console_flush(Console *c) {
+    if(!c->running) {
+        fflush(stdout);
+        return;
+    }
+    unsigned want = atomic_fetch_add(&c->flush_requested, 1) + 1;
+    while((int)(atomic_load(&c->flush_done) - want) < 0) usleep(1000);
+}
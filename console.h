@@ -0,0 +1,67 @@
+/*
+ * console.h - Asynchronous terminal and event-log output
+ * Hot paths format a line into a lock-free ring and return; a background
+ * thread writes the ring out in batches and redraws a single progress
+ * line at a fixed rate, so a slow terminal never throttles a scan.
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// ========== CONFIGURATION ==========
+#define CONSOLE_SLOTS        4096    // Power of two
+#define CONSOLE_LINE_MAX     320     // Longer terminal lines are cut; longer events go to the heap
+#define CONSOLE_REFRESH_MS   200     // Progress redraw period on a terminal
+#define CONSOLE_PLAIN_PROGRESS_SEC 10  // Progress line period when stdout is not a terminal
+
+typedef enum {
+    CONSOLE_TEXT,           // Terminal line; waits for room when the ring is full
+    CONSOLE_DETAIL,         // Per-result terminal line; dropped when full or quiet
+    CONSOLE_EVENT           // JSON line for the event log; never dropped
+} ConsoleKind;
+
+// ========== STRUCTURES ==========
+typedef struct {
+    _Atomic size_t seq;
+    unsigned char kind;
+    unsigned short len;
+    char text[CONSOLE_LINE_MAX];
+    char *long_text;                // Event that did not fit in `text`, `long_len` bytes
+    size_t long_len;
+} ConsoleSlot;
+
+typedef struct {
+    ConsoleSlot *slots;
+    _Atomic size_t head;
+    size_t tail;                    // Renderer thread only
+
+    FILE *events;                   // JSON lines, NULL = no event log
+    int quiet;                      // No detail lines and no progress
+    int tty;                        // stdout is a terminal: progress redraws in place
+
+    pthread_mutex_t progress_lock;
+    char progress[CONSOLE_LINE_MAX];
+    int progress_dirty;
+
+    _Atomic size_t dropped;
+    _Atomic size_t events_lost;     // Events that could not be stored whole
+    _Atomic unsigned flush_requested;
+    _Atomic unsigned flush_done;
+    _Atomic int stopping;
+    pthread_t thread;
+    int running;
+} Console;
+
+// ========== FUNCTION PROTOTYPES ==========
+int console_start(Console *c, FILE *events, int quiet);
+void console_stop(Console *c);
+void console_printf(Console *c, ConsoleKind kind, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+void console_progress(Console *c, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void console_flush(Console *c);
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * ct_cache.c - Local cache of parsed crt.sh results
+ * File layout: magic line, fetch time line, then one name per line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "ct_cache.h"
+
+// ========== PATHS ==========
+// <dir>/<domain><suffix>, with anything unusual in the domain replaced
+void cache_path(char *buf, size_t cap, const char *dir, const char *domain, const char *suffix) {
+    char safe[256];
+    size_t i = 0;
+    for(; domain[i] && i < sizeof(safe) - 1; i++) {
+        char c = domain[i];
+        int ok = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '.' || c == '-';
+        safe[i] = ok ? c : '_';
+    }
+    safe[i] = '\0';
+    snprintf(buf, cap, "%s/%s%s", dir, safe, suffix);
+}
+
+// ========== LOAD ==========
+// Returns 1 and fills `names` if a snapshot exists for the domain
+int ct_cache_load(const char *dir, const char *domain, ResultStore *names, time_t *fetched_at) {
+    char path[4096];
+    cache_path(path, sizeof(path), dir, domain, ".ct");
+
+    FILE *fp = fopen(path, "r");
+    if(!fp) return 0;
+
+    char line[512];
+    long long stamp = 0;
+    if(!fgets(line, sizeof(line), fp) || strcmp(line, CT_CACHE_MAGIC) != 0 ||
+       !fgets(line, sizeof(line), fp) || sscanf(line, "%lld", &stamp) != 1) {
+        fclose(fp);
+        return 0;
+    }
+
+    while(fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\n")] = '\0';
+        if(line[0]) result_store_add(names, line, 1, NULL, 0, SOURCE_CT, NULL);
+    }
+    fclose(fp);
+
+    *fetched_at = (time_t)stamp;
+    return 1;
+}
+
+// ========== SAVE ==========
+int ct_cache_save(const char *dir, const char *domain, const ResultStore *names, time_t fetched_at) {
+    if(mkdir(dir, 0700) != 0 && errno != EEXIST) return 0;
+
+    char path[4096], tmp[4200];
+    cache_path(path, sizeof(path), dir, domain, ".ct");
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp, "w");
+    if(!fp) return 0;
+
+    fputs(CT_CACHE_MAGIC, fp);
+    fprintf(fp, "%lld\n", (long long)fetched_at);
+    for(size_t i = 0; i < names->count; i++) {
+        fputs(names->records[i].subdomain, fp);
+        fputc('\n', fp);
+    }
+
+    int ok = !ferror(fp);
+    ok = (fclose(fp) == 0) && ok;
+    ok = ok && rename(tmp, path) == 0;
+    if(!ok) unlink(tmp);
+    return ok;
+}
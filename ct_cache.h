@@ -0,0 +1,21 @@
+/*
+ * ct_cache.h - Local cache of parsed crt.sh results
+ * One file per domain holding the deduplicated in-scope name set and the
+ * time it was fetched, so repeat runs skip the network round trip.
+ */
+
+#ifndef CT_CACHE_H
+#define CT_CACHE_H
+
+#include <time.h>
+#include "result_store.h"
+
+// ========== CONFIGURATION ==========
+#define CT_CACHE_MAGIC   "SSCT1\n"
+
+// ========== FUNCTION PROTOTYPES ==========
+void cache_path(char *buf, size_t cap, const char *dir, const char *domain, const char *suffix);
+int ct_cache_load(const char *dir, const char *domain, ResultStore *names, time_t *fetched_at);
+int ct_cache_save(const char *dir, const char *domain, const ResultStore *names, time_t fetched_at);
+
+#endif
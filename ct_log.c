@@ -0,0 +1,316 @@
+/*
+ * ct_log.c - Offline decoder for mirrored RFC 6962 log entries
+ *
+ * MerkleTreeLeaf (RFC 6962 section 3.4):
+ *   u8 version (0), u8 leaf_type (0 = timestamped_entry), u64 timestamp,
+ *   u16 entry_type, then
+ *     x509_entry:    u24 length + DER Certificate
+ *     precert_entry: 32-byte issuer key hash, u24 length + DER TBSCertificate
+ *
+ * Only the TLVs on the path to the subject and the subjectAltName
+ * extension are looked at; everything else is skipped by length.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ct_log.h"
+
+#define LEAF_HEADER_LEN  12          // version, leaf_type, timestamp, entry_type
+#define ENTRY_X509       0
+#define ENTRY_PRECERT    1
+
+// DER tags
+#define TAG_BOOLEAN      0x01
+#define TAG_INTEGER      0x02
+#define TAG_OCTET_STRING 0x04
+#define TAG_OID          0x06
+#define TAG_UTF8STRING   0x0c
+#define TAG_PRINTABLE    0x13
+#define TAG_T61STRING    0x14
+#define TAG_IA5STRING    0x16
+#define TAG_SEQUENCE     0x30
+#define TAG_SET          0x31
+#define TAG_DNS_NAME     0x82        // GeneralName [2] IMPLICIT IA5String
+#define TAG_VERSION      0xa0        // TBSCertificate [0] EXPLICIT
+#define TAG_EXTENSIONS   0xa3        // TBSCertificate [3] EXPLICIT
+
+static const unsigned char OID_COMMON_NAME[] = { 0x55, 0x04, 0x03 };  // 2.5.4.3
+static const unsigned char OID_SAN[] = { 0x55, 0x1d, 0x11 };          // 2.5.29.17
+
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+} Der;
+
+typedef struct {
+    const DomainMatcher *m;
+    DomainHitCallback on_hit;
+    void *userdata;
+    int hits;
+} NameSink;
+
+// ========== DER WALKER ==========
+// Reads one TLV header; `out` covers its value. Returns 0 on truncation or
+// on forms certificates never use (high tag numbers, indefinite lengths).
+static int der_next(Der *d, unsigned char *tag, Der *out) {
+    if(d->end - d->p < 2) return 0;
+    *tag = d->p[0];
+    if((*tag & 0x1f) == 0x1f) return 0;
+
+    size_t len = d->p[1];
+    const unsigned char *v = d->p + 2;
+    if(len & 0x80) {
+        size_t bytes = len & 0x7f;
+        if(bytes == 0 || bytes > 4 || (size_t)(d->end - v) < bytes) return 0;
+        len = 0;
+        for(size_t i = 0; i < bytes; i++) len = (len << 8) | *v++;
+    }
+    if((size_t)(d->end - v) < len) return 0;
+
+    out->p = v;
+    out->end = v + len;
+    d->p = v + len;
+    return 1;
+}
+
+static int der_expect(Der *d, unsigned char want, Der *out) {
+    unsigned char tag;
+    return der_next(d, &tag, out) && tag == want;
+}
+
+static int oid_is(const Der *oid, const unsigned char *want, size_t len) {
+    return (size_t)(oid->end - oid->p) == len && memcmp(oid->p, want, len) == 0;
+}
+
+// ========== NAMES ==========
+// Hostname characters only; anything else is a display name or garbage
+static int plausible_name(const unsigned char *s, size_t len) {
+    if(len == 0 || len > 253) return 0;
+    for(size_t i = 0; i < len; i++) {
+        unsigned char c = s[i];
+        if(!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+             c == '-' || c == '.' || c == '*' || c == '_')) return 0;
+    }
+    return 1;
+}
+
+static void emit(NameSink *sink, const Der *value) {
+    size_t len = (size_t)(value->end - value->p);
+    if(!plausible_name(value->p, len)) return;
+    if(!domain_match(sink->m, (const char *)value->p, len)) return;
+    sink->on_hit((const char *)value->p, len, sink->userdata);
+    sink->hits++;
+}
+
+// Name ::= SEQUENCE OF SET OF AttributeTypeAndValue { OID, ANY }
+static int scan_subject(Der name, NameSink *sink) {
+    Der rdn;
+    while(name.p < name.end) {
+        if(!der_expect(&name, TAG_SET, &rdn)) return 0;
+        while(rdn.p < rdn.end) {
+            Der atv, oid, value;
+            unsigned char tag;
+            if(!der_expect(&rdn, TAG_SEQUENCE, &atv)) return 0;
+            if(!der_expect(&atv, TAG_OID, &oid) || !der_next(&atv, &tag, &value)) return 0;
+            if(oid_is(&oid, OID_COMMON_NAME, sizeof(OID_COMMON_NAME)) &&
+               (tag == TAG_UTF8STRING || tag == TAG_PRINTABLE || tag == TAG_IA5STRING || tag == TAG_T61STRING)) {
+                emit(sink, &value);
+            }
+        }
+    }
+    return 1;
+}
+
+// Extensions ::= SEQUENCE OF Extension { OID, BOOLEAN DEFAULT FALSE, OCTET STRING }
+static int scan_extensions(Der wrapper, NameSink *sink) {
+    Der list;
+    if(!der_expect(&wrapper, TAG_SEQUENCE, &list)) return 0;
+    while(list.p < list.end) {
+        Der ext, oid, value;
+        unsigned char tag;
+        if(!der_expect(&list, TAG_SEQUENCE, &ext) || !der_expect(&ext, TAG_OID, &oid)) return 0;
+        if(!oid_is(&oid, OID_SAN, sizeof(OID_SAN))) continue;
+
+        if(!der_next(&ext, &tag, &value)) return 0;
+        if(tag == TAG_BOOLEAN && !der_next(&ext, &tag, &value)) return 0;
+        if(tag != TAG_OCTET_STRING) return 0;
+
+        Der names;
+        if(!der_expect(&value, TAG_SEQUENCE, &names)) return 0;
+        while(names.p < names.end) {
+            Der general;
+            if(!der_next(&names, &tag, &general)) return 0;
+            if(tag == TAG_DNS_NAME) emit(sink, &general);
+        }
+    }
+    return 1;
+}
+
+// TBSCertificate: [0] version, serial, signature, issuer, validity,
+// subject, subjectPublicKeyInfo, [1] [2] unique IDs, [3] extensions
+static int scan_tbs(Der tbs, NameSink *sink) {
+    Der field, subject;
+    unsigned char tag;
+
+    if(!der_next(&tbs, &tag, &field)) return 0;
+    if(tag == TAG_VERSION && !der_next(&tbs, &tag, &field)) return 0;
+    if(tag != TAG_INTEGER) return 0;
+    if(!der_expect(&tbs, TAG_SEQUENCE, &field) ||      // signature
+       !der_expect(&tbs, TAG_SEQUENCE, &field) ||      // issuer
+       !der_expect(&tbs, TAG_SEQUENCE, &field) ||      // validity
+       !der_expect(&tbs, TAG_SEQUENCE, &subject) ||
+       !der_expect(&tbs, TAG_SEQUENCE, &field)) {      // subjectPublicKeyInfo
+        return 0;
+    }
+    if(!scan_subject(subject, sink)) return 0;
+
+    while(tbs.p < tbs.end) {
+        if(!der_next(&tbs, &tag, &field)) return 0;
+        if(tag == TAG_EXTENSIONS) return scan_extensions(field, sink);
+    }
+    return 1;
+}
+
+// Reports in-scope SAN dNSNames and CNs of one decoded MerkleTreeLeaf.
+// Returns the number reported, or -1 if the leaf is malformed.
+int ct_leaf_names(const unsigned char *leaf, size_t len, const DomainMatcher *m,
+                  DomainHitCallback on_hit, void *userdata) {
+    if(len < LEAF_HEADER_LEN + 3 || leaf[0] != 0 || leaf[1] != 0) return -1;
+    unsigned int type = ((unsigned int)leaf[10] << 8) | leaf[11];
+    const unsigned char *p = leaf + LEAF_HEADER_LEN;
+    const unsigned char *end = leaf + len;
+
+    if(type == ENTRY_PRECERT) {
+        if(end - p < 32 + 3) return -1;
+        p += 32;
+    } else if(type != ENTRY_X509) {
+        return -1;
+    }
+    size_t body_len = ((size_t)p[0] << 16) | ((size_t)p[1] << 8) | p[2];
+    p += 3;
+    if((size_t)(end - p) < body_len) return -1;
+
+    Der body = { p, p + body_len }, tbs;
+    if(type == ENTRY_X509) {
+        Der cert;
+        if(!der_expect(&body, TAG_SEQUENCE, &cert)) return -1;
+        body = cert;
+    }
+    if(!der_expect(&body, TAG_SEQUENCE, &tbs)) return -1;
+
+    NameSink sink = { m, on_hit, userdata, 0 };
+    return scan_tbs(tbs, &sink) ? sink.hits : -1;
+}
+
+// ========== BASE64 ==========
+// 0x80 marks characters outside the alphabet
+static const unsigned char b64_value[256] = {
+    128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
+    128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
+    128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,  62, 128, 128, 128,  63,
+     52,  53,  54,  55,  56,  57,  58,  59,  60,  61, 128, 128, 128, 128, 128, 128,
+    128,   0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,
+     15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25, 128, 128, 128, 128, 128,
+    128,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+     41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51, 128, 128, 128, 128, 128,
+    128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
+    128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
+    128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
+    128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
+    128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
+    128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
+    128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
+    128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,};
+
+// Decodes a JSON string value; "\/" escapes are skipped, '=' ends the data.
+// Returns the decoded length, or (size_t)-1 on a character outside the alphabet.
+static size_t base64_decode(const char *src, size_t len, unsigned char *dst) {
+    const unsigned char *s = (const unsigned char *)src;
+    unsigned char *out = dst;
+    size_t i = 0;
+
+    // Four characters at a time while there is nothing to special-case
+    while(i + 4 <= len) {
+        unsigned int a = b64_value[s[i]], b = b64_value[s[i + 1]];
+        unsigned int c = b64_value[s[i + 2]], d = b64_value[s[i + 3]];
+        if((a | b | c | d) & 0x80) break;
+        unsigned int v = (a << 18) | (b << 12) | (c << 6) | d;
+        out[0] = (unsigned char)(v >> 16);
+        out[1] = (unsigned char)(v >> 8);
+        out[2] = (unsigned char)v;
+        out += 3;
+        i += 4;
+    }
+
+    unsigned int acc = 0;
+    int bits = 0;
+    for(; i < len; i++) {
+        if(s[i] == '\\') continue;
+        if(s[i] == '=') break;
+        unsigned int v = b64_value[s[i]];
+        if(v & 0x80) return (size_t)-1;
+        acc = (acc << 6) | v;
+        bits += 6;
+        if(bits >= 8) {
+            bits -= 8;
+            *out++ = (unsigned char)(acc >> bits);
+        }
+    }
+    return (size_t)(out - dst);
+}
+
+// ========== JSON SCAN ==========
+// Offset of the first "leaf_input" key in text, or len if there is none
+size_t ct_log_boundary(const char *text, size_t len) {
+    const char *p = text, *end = text + len;
+    while((p = memchr(p, '"', (size_t)(end - p))) != NULL) {
+        if((size_t)(end - p) < CT_LOG_KEY_LEN) break;
+        if(memcmp(p, CT_LOG_KEY, CT_LOG_KEY_LEN) == 0) return (size_t)(p - text);
+        p++;
+    }
+    return len;
+}
+
+// Decodes every leaf_input value in text (other keys, extra_data included,
+// are skipped) and reports in-scope names; returns how many were reported
+size_t ct_log_scan(const char *text, size_t len, const DomainMatcher *m,
+                   DomainHitCallback on_hit, void *userdata, CtLogStats *stats) {
+    const char *p = text, *end = text + len;
+    unsigned char *leaf = NULL;
+    size_t cap = 0, hits = 0;
+
+    for(;;) {
+        size_t at = ct_log_boundary(p, (size_t)(end - p));
+        if(at == (size_t)(end - p)) break;
+        p += at + CT_LOG_KEY_LEN;
+
+        while(p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == ':')) p++;
+        if(p >= end || *p != '"') continue;
+        const char *value = ++p;
+        const char *close = memchr(value, '"', (size_t)(end - value));
+        if(!close) break;
+        p = close + 1;
+
+        size_t value_len = (size_t)(close - value);
+        size_t need = value_len / 4 * 3 + 3;
+        if(need > cap) {
+            unsigned char *grown = realloc(leaf, need);
+            if(!grown) break;
+            leaf = grown;
+            cap = need;
+        }
+
+        stats->entries++;
+        size_t leaf_len = base64_decode(value, value_len, leaf);
+        int found = leaf_len == (size_t)-1 ? -1 : ct_leaf_names(leaf, leaf_len, m, on_hit, userdata);
+        if(found < 0) {
+            stats->malformed++;
+            continue;
+        }
+        if(leaf_len > 11 && leaf[11] == ENTRY_PRECERT) stats->precerts++;
+        hits += (size_t)found;
+    }
+
+    free(leaf);
+    return hits;
+}
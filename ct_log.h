@@ -0,0 +1,32 @@
+/*
+ * ct_log.h - Offline decoder for mirrored RFC 6962 log entries
+ * Reads get-entries batches ({"entries":[{"leaf_input":"<base64>",...}]})
+ * and pulls dNSName SANs and subject CNs straight out of the DER, without
+ * a full X.509 parse, for both x509_entry and precert_entry leaves.
+ */
+
+#ifndef CT_LOG_H
+#define CT_LOG_H
+
+#include <stddef.h>
+#include "domain_match.h"
+
+// ========== CONFIGURATION ==========
+#define CT_LOG_KEY     "\"leaf_input\""
+#define CT_LOG_KEY_LEN 12
+
+// ========== STRUCTURES ==========
+typedef struct {
+    size_t entries;         // leaf_input values seen
+    size_t precerts;        // ... of which were precert_entry leaves
+    size_t malformed;       // Bad base64, unknown leaf type or truncated DER
+} CtLogStats;
+
+// ========== FUNCTION PROTOTYPES ==========
+int ct_leaf_names(const unsigned char *leaf, size_t len, const DomainMatcher *m,
+                  DomainHitCallback on_hit, void *userdata);
+size_t ct_log_scan(const char *text, size_t len, const DomainMatcher *m,
+                   DomainHitCallback on_hit, void *userdata, CtLogStats *stats);
+size_t ct_log_boundary(const char *text, size_t len);
+
+#endif
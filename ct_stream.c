@@ -0,0 +1,331 @@
+/*
+ * ct_stream.c - Incremental crt.sh JSON parser
+ * A small byte-at-a-time JSON tokenizer that only keeps the fields we
+ * care about (name_value, not_before, not_after) of each entry object.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ct_stream.h"
+
+// ========== INIT / FREE ==========
+void ct_stream_init(CtStreamParser *p, CtNameCallback on_name, void *userdata) {
+    memset(p, 0, sizeof(*p));
+    p->on_name = on_name;
+    p->userdata = userdata;
+}
+
+void ct_stream_free(CtStreamParser *p) {
+    free(p->value);
+    free(p->names);
+    p->value = NULL;
+    p->names = NULL;
+    p->value_cap = 0;
+    p->names_cap = 0;
+}
+
+// ========== VALUE BUFFER ==========
+static void append_value(CtStreamParser *p, const char *bytes, size_t n) {
+    if(p->value_oversized) return;
+    if(p->value_len + n > CT_MAX_VALUE_LEN) {
+        // A cut-off name list would yield a cut-off name: drop the value whole
+        p->value_oversized = 1;
+        p->truncated_values++;
+        return;
+    }
+    if(p->value_len + n + 1 > p->value_cap) {
+        size_t cap = p->value_cap ? p->value_cap : 256;
+        while(cap < p->value_len + n + 1) cap *= 2;
+        char *ptr = realloc(p->value, cap);
+        if(!ptr) {
+            p->error = 1;
+            return;
+        }
+        p->value = ptr;
+        p->value_cap = cap;
+    }
+    memcpy(p->value + p->value_len, bytes, n);
+    p->value_len += n;
+}
+
+static void append_char(CtStreamParser *p, unsigned char c) {
+    if(p->reading_key) {
+        if(p->key_len < CT_MAX_KEY_LEN) p->key[p->key_len] = (char)c;
+        p->key_len++;
+    } else if(p->capture) {
+        append_value(p, (const char *)&c, 1);
+    }
+}
+
+static void append_codepoint(CtStreamParser *p, unsigned int cp) {
+    unsigned char out[4];
+    size_t n;
+
+    if(cp < 0x80) {
+        out[0] = (unsigned char)cp;
+        n = 1;
+    } else if(cp < 0x800) {
+        out[0] = 0xC0 | (cp >> 6);
+        out[1] = 0x80 | (cp & 0x3F);
+        n = 2;
+    } else if(cp < 0x10000) {
+        out[0] = 0xE0 | (cp >> 12);
+        out[1] = 0x80 | ((cp >> 6) & 0x3F);
+        out[2] = 0x80 | (cp & 0x3F);
+        n = 3;
+    } else {
+        out[0] = 0xF0 | (cp >> 18);
+        out[1] = 0x80 | ((cp >> 12) & 0x3F);
+        out[2] = 0x80 | ((cp >> 6) & 0x3F);
+        out[3] = 0x80 | (cp & 0x3F);
+        n = 4;
+    }
+    for(size_t i = 0; i < n; i++) append_char(p, out[i]);
+}
+
+static void finish_unicode(CtStreamParser *p) {
+    unsigned int cp = p->unicode_value;
+
+    if(cp >= 0xD800 && cp <= 0xDBFF) {
+        if(p->high_surrogate) append_codepoint(p, 0xFFFD);
+        p->high_surrogate = cp;
+        return;
+    }
+    if(cp >= 0xDC00 && cp <= 0xDFFF) {
+        if(p->high_surrogate) {
+            cp = 0x10000 + ((p->high_surrogate - 0xD800) << 10) + (cp - 0xDC00);
+            p->high_surrogate = 0;
+        } else {
+            cp = 0xFFFD;
+        }
+    } else if(p->high_surrogate) {
+        append_codepoint(p, 0xFFFD);
+        p->high_surrogate = 0;
+    }
+    append_codepoint(p, cp);
+}
+
+static int hex_value(unsigned char c) {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// ========== ENTRY HANDLING ==========
+static void begin_entry(CtStreamParser *p) {
+    p->names_len = 0;
+    p->info.not_before[0] = '\0';
+    p->info.not_after[0] = '\0';
+}
+
+static void copy_date(char *dst, const char *src, size_t len) {
+    if(len >= CT_DATE_LEN) len = CT_DATE_LEN - 1;
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static void end_entry(CtStreamParser *p) {
+    p->entries++;
+    if(!p->names_len || !p->on_name) return;
+
+    // name_value holds one name per line once the JSON \n escapes are undone
+    char *line = p->names;
+    char *end = p->names + p->names_len;
+    while(line < end) {
+        char *nl = memchr(line, '\n', end - line);
+        char *stop = nl ? nl : end;
+
+        char *s = line;
+        char *e = stop;
+        while(s < e && (*s == ' ' || *s == '\t' || *s == '\r')) s++;
+        while(e > s && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r')) e--;
+
+        if(e > s) {
+            char saved = *e;
+            *e = '\0';
+            p->on_name(s, e - s, &p->info, p->userdata);
+            *e = saved;
+            p->names_emitted++;
+        }
+        line = stop + 1;
+    }
+}
+
+static void end_string(CtStreamParser *p) {
+    if(p->high_surrogate) {
+        append_codepoint(p, 0xFFFD);
+        p->high_surrogate = 0;
+    }
+
+    if(p->reading_key) {
+        if(p->key_len > CT_MAX_KEY_LEN) p->key_len = 0;  // Too long to be one of ours
+        p->key[p->key_len] = '\0';
+        p->reading_key = 0;
+        return;
+    }
+
+    if(!p->capture) return;
+    p->capture = 0;
+
+    size_t len = p->value_len;
+    p->value_len = 0;
+    if(p->value_oversized) {
+        p->value_oversized = 0;
+        if(strcmp(p->key, "name_value") == 0) p->names_len = 0;
+        return;
+    }
+
+    if(strcmp(p->key, "name_value") == 0) {
+        // Swap buffers instead of copying; the old names buffer is reused for values
+        char *tmp = p->names;
+        size_t tmp_cap = p->names_cap;
+        p->names = p->value;
+        p->names_cap = p->value_cap;
+        p->names_len = len;
+        p->value = tmp;
+        p->value_cap = tmp_cap;
+    } else if(strcmp(p->key, "not_before") == 0) {
+        copy_date(p->info.not_before, p->value, len);
+    } else if(strcmp(p->key, "not_after") == 0) {
+        copy_date(p->info.not_after, p->value, len);
+    }
+}
+
+static int in_entry(const CtStreamParser *p) {
+    // Entries are the objects directly inside the top-level array
+    return p->depth == 2 && p->stack[0] == 'a' && p->stack[1] == 'o';
+}
+
+static int wanted_key(const char *key) {
+    return strcmp(key, "name_value") == 0 ||
+           strcmp(key, "not_before") == 0 ||
+           strcmp(key, "not_after") == 0;
+}
+
+// ========== FEED ==========
+int ct_stream_feed(CtStreamParser *p, const char *data, size_t len) {
+    if(p->error) return 0;
+    p->bytes_fed += len;
+
+    const unsigned char *s = (const unsigned char *)data;
+    const unsigned char *end = s + len;
+
+    while(s < end) {
+        unsigned char c = *s;
+
+        if(p->in_string) {
+            if(p->unicode_left) {
+                int h = hex_value(c);
+                if(h < 0) {
+                    p->error = 1;
+                    return 0;
+                }
+                p->unicode_value = (p->unicode_value << 4) | (unsigned int)h;
+                if(--p->unicode_left == 0) finish_unicode(p);
+                s++;
+            } else if(p->escape) {
+                p->escape = 0;
+                switch(c) {
+                    case 'n': append_char(p, '\n'); break;
+                    case 't': append_char(p, '\t'); break;
+                    case 'r': append_char(p, '\r'); break;
+                    case 'b': append_char(p, '\b'); break;
+                    case 'f': append_char(p, '\f'); break;
+                    case 'u':
+                        p->unicode_left = 4;
+                        p->unicode_value = 0;
+                        break;
+                    default: append_char(p, c); break;  // \" \\ \/
+                }
+                s++;
+            } else {
+                // Fast path: copy a run of plain characters in one go
+                const unsigned char *run = s;
+                while(s < end && *s != '"' && *s != '\\') s++;
+                if(s > run) {
+                    if(p->high_surrogate) {
+                        append_codepoint(p, 0xFFFD);
+                        p->high_surrogate = 0;
+                    }
+                    if(p->capture && !p->reading_key) {
+                        append_value(p, (const char *)run, s - run);
+                    } else if(p->reading_key) {
+                        for(const unsigned char *k = run; k < s; k++) append_char(p, *k);
+                    }
+                }
+                if(s < end) {
+                    if(*s == '"') {
+                        p->in_string = 0;
+                        end_string(p);
+                    } else {
+                        p->escape = 1;
+                    }
+                    s++;
+                }
+            }
+            if(p->error) return 0;
+            continue;
+        }
+
+        switch(c) {
+            case '{':
+            case '[':
+                if(p->depth >= CT_MAX_DEPTH) {
+                    p->error = 1;
+                    return 0;
+                }
+                p->stack[p->depth++] = (c == '{') ? 'o' : 'a';
+                p->expect_key = (c == '{');
+                if(in_entry(p)) begin_entry(p);
+                break;
+            case '}':
+            case ']':
+                if(p->depth == 0 || p->stack[p->depth - 1] != (c == '}' ? 'o' : 'a')) {
+                    p->error = 1;
+                    return 0;
+                }
+                if(c == '}' && in_entry(p)) end_entry(p);
+                p->depth--;
+                p->expect_key = 0;
+                break;
+            case ',':
+                p->expect_key = (p->depth > 0 && p->stack[p->depth - 1] == 'o');
+                break;
+            case ':':
+                p->expect_key = 0;
+                break;
+            case '"':
+                p->in_string = 1;
+                p->reading_key = (p->depth > 0 && p->stack[p->depth - 1] == 'o' && p->expect_key);
+                if(p->reading_key) {
+                    p->key_len = 0;
+                } else {
+                    p->capture = in_entry(p) && wanted_key(p->key);
+                    p->value_len = 0;
+                    p->value_oversized = 0;
+                }
+                break;
+            default:
+                // Whitespace, numbers, true/false/null: nothing to keep
+                break;
+        }
+        s++;
+    }
+
+    return !p->error;
+}
+
+int ct_stream_finish(CtStreamParser *p) {
+    // Returns 1 only if a complete document was seen
+    return !p->error && p->depth == 0 && !p->in_string && p->bytes_fed > 0;
+}
+
+// ========== CURL WRITE CALLBACK ==========
+size_t ct_stream_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    CtStreamParser *p = (CtStreamParser *)userp;
+
+    if(!ct_stream_feed(p, contents, realsize)) return 0;  // Abort transfer on malformed JSON
+    return realsize;
+}
@@ -0,0 +1,76 @@
+/*
+ * ct_stream.h - Incremental crt.sh JSON parser
+ * Consumes the response chunk by chunk straight from the curl write
+ * callback, so memory stays bounded and names are extracted while the
+ * transfer is still running.
+ */
+
+#ifndef CT_STREAM_H
+#define CT_STREAM_H
+
+#include <stddef.h>
+
+// ========== CONFIGURATION ==========
+#define CT_MAX_VALUE_LEN   (1024 * 1024)  // Longer string values are dropped (bytes)
+#define CT_MAX_KEY_LEN     32             // Longer keys are never interesting
+#define CT_MAX_DEPTH       64             // Nesting tracked exactly up to here
+#define CT_DATE_LEN        32
+
+// ========== STRUCTURES ==========
+typedef struct {
+    char not_before[CT_DATE_LEN];  // "" when the entry has no such field
+    char not_after[CT_DATE_LEN];
+} CtEntryInfo;
+
+// Called once per name found in an entry's name_value field.
+// `name` is NUL-terminated and only valid during the call.
+typedef void (*CtNameCallback)(const char *name, size_t len,
+                               const CtEntryInfo *info, void *userdata);
+
+typedef struct {
+    // Tokenizer state
+    int depth;
+    unsigned char stack[CT_MAX_DEPTH];   // 'a' array / 'o' object per level
+    int expect_key;                      // Next string in this object is a key
+    int in_string;
+    int escape;
+    int unicode_left;                    // Hex digits still expected in \uXXXX
+    unsigned int unicode_value;
+    unsigned int high_surrogate;
+
+    // Current key/value being read
+    char key[CT_MAX_KEY_LEN + 1];
+    size_t key_len;
+    int reading_key;
+    int capture;                         // Current value is one we keep
+    char *value;
+    size_t value_len;                    // Bytes actually held in value
+    size_t value_cap;
+    int value_oversized;                 // Went past CT_MAX_VALUE_LEN; dropped at its closing quote
+
+    // Per-entry fields, flushed when the entry object closes
+    char *names;
+    size_t names_len;
+    size_t names_cap;
+    CtEntryInfo info;
+
+    // Output
+    CtNameCallback on_name;
+    void *userdata;
+
+    // Statistics
+    size_t bytes_fed;
+    size_t entries;
+    size_t names_emitted;
+    size_t truncated_values;             // Oversized values dropped
+    int error;
+} CtStreamParser;
+
+// ========== FUNCTION PROTOTYPES ==========
+void ct_stream_init(CtStreamParser *p, CtNameCallback on_name, void *userdata);
+int ct_stream_feed(CtStreamParser *p, const char *data, size_t len);
+int ct_stream_finish(CtStreamParser *p);
+void ct_stream_free(CtStreamParser *p);
+size_t ct_stream_write_callback(void *contents, size_t size, size_t nmemb, void *userp);
+
+#endif
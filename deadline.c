@@ -0,0 +1,106 @@
+/*
+ * deadline.c - Per-request deadlines derived from observed latency
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "deadline.h"
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double clamp(const AdaptiveDeadline *d, double ms) {
+    if(ms < d->floor_ms) return d->floor_ms;
+    if(ms > d->ceiling_ms) return d->ceiling_ms;
+    return ms;
+}
+
+// ========== STAGES ==========
+// The window is small and requests are rate limited, so sorting a copy
+// on every sample is cheaper than anything incremental would be to get right
+static void stage_add(const AdaptiveDeadline *d, DeadlineStage *s, double ms) {
+    s->samples[s->next] = ms;
+    s->next = (s->next + 1) % DEADLINE_WINDOW;
+    if(s->count < DEADLINE_WINDOW) s->count++;
+    if(s->count < DEADLINE_MIN_SAMPLES) return;
+
+    double sorted[DEADLINE_WINDOW];
+    memcpy(sorted, s->samples, s->count * sizeof(double));
+    qsort(sorted, s->count, sizeof(double), compare_double);
+    size_t rank = (s->count * DEADLINE_PERCENTILE + 99) / 100;
+    s->p99_ms = sorted[rank > 0 ? rank - 1 : 0];
+    s->deadline_ms = clamp(d, s->p99_ms * DEADLINE_FACTOR + DEADLINE_MARGIN_MS);
+}
+
+static long effective(const AdaptiveDeadline *d, const DeadlineStage *s) {
+    double ms = s->count >= DEADLINE_MIN_SAMPLES ? s->deadline_ms : d->initial_ms;
+    for(int i = 0; i < d->backoff && ms < d->ceiling_ms; i++) ms *= 2;
+    return (long)(ms < d->ceiling_ms ? ms : d->ceiling_ms);
+}
+
+static long response_locked(const AdaptiveDeadline *d) {
+    long response = effective(d, &d->response);
+    long connect = effective(d, &d->connect);
+    return response > connect ? response : connect;
+}
+
+// ========== API ==========
+void deadline_init(AdaptiveDeadline *d, double floor_ms, double initial_ms, double ceiling_ms) {
+    memset(d, 0, sizeof(*d));
+    d->floor_ms = floor_ms;
+    d->initial_ms = initial_ms;
+    d->ceiling_ms = ceiling_ms;
+    pthread_mutex_init(&d->lock, NULL);
+}
+
+void deadline_free(AdaptiveDeadline *d) {
+    pthread_mutex_destroy(&d->lock);
+}
+
+long deadline_connect_ms(AdaptiveDeadline *d) {
+    pthread_mutex_lock(&d->lock);
+    long ms = effective(d, &d->connect);
+    pthread_mutex_unlock(&d->lock);
+    return ms;
+}
+
+// Whole request, so never shorter than the connect deadline
+long deadline_response_ms(AdaptiveDeadline *d) {
+    pthread_mutex_lock(&d->lock);
+    long ms = response_locked(d);
+    pthread_mutex_unlock(&d->lock);
+    return ms;
+}
+
+// Answered requests feed the percentiles; timeouts only count towards a streak
+void deadline_observe(AdaptiveDeadline *d, CURL *easy, CURLcode code) {
+    if(code == CURLE_OK) {
+        curl_off_t app_connect = 0, first_byte = 0;
+        curl_easy_getinfo(easy, CURLINFO_APPCONNECT_TIME_T, &app_connect);
+        curl_easy_getinfo(easy, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+        pthread_mutex_lock(&d->lock);
+        // A reused connection reports no handshake; its answer still says the path works
+        if(app_connect > 0) stage_add(d, &d->connect, app_connect / 1000.0);
+        if(first_byte > 0) stage_add(d, &d->response, first_byte / 1000.0);
+        d->answered++;
+        d->streak = 0;
+        d->backoff = 0;
+        pthread_mutex_unlock(&d->lock);
+    } else if(code == CURLE_OPERATION_TIMEDOUT) {
+        curl_off_t total = 0;
+        curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME_T, &total);
+        pthread_mutex_lock(&d->lock);
+        d->timeouts++;
+        d->timeout_ms += total / 1000.0;
+        if(++d->streak >= DEADLINE_STALL_TIMEOUTS) {
+            d->streak = 0;
+            if(effective(d, &d->response) < d->ceiling_ms) {
+                d->backoff++;
+                d->widened++;
+            }
+        }
+        pthread_mutex_unlock(&d->lock);
+    }
+}
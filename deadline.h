@@ -0,0 +1,58 @@
+/*
+ * deadline.h - Per-request deadlines derived from observed latency
+ * The connect deadline (proxy, Tor stream and TLS handshake) and the
+ * response deadline (first response byte) each follow the p99 of recent
+ * answered requests plus a margin, clamped to a floor and a ceiling.
+ * Non-responders then cost about as long as a slow real answer instead
+ * of a fixed worst case, while a run of timeouts with no answer in
+ * between (a bad circuit) widens both deadlines again. Concurrent probe
+ * runs may share one set of deadlines.
+ */
+
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include <curl/curl.h>
+
+// ========== CONFIGURATION ==========
+#define DEADLINE_WINDOW         256     // Recent answers the percentiles cover
+#define DEADLINE_MIN_SAMPLES    8       // Until then the initial deadline applies
+#define DEADLINE_PERCENTILE     99
+#define DEADLINE_FACTOR         1.5     // Deadline = p99 * factor + margin
+#define DEADLINE_MARGIN_MS      500
+#define DEADLINE_STALL_TIMEOUTS 8       // Timeouts in a row that double the deadlines
+
+// ========== STRUCTURES ==========
+typedef struct {
+    double samples[DEADLINE_WINDOW];    // Milliseconds, ring buffer
+    size_t count;                       // Valid samples (<= DEADLINE_WINDOW)
+    size_t next;
+    double p99_ms;                      // 0 until DEADLINE_MIN_SAMPLES
+    double deadline_ms;                 // Before backoff
+} DeadlineStage;
+
+typedef struct {
+    double floor_ms;
+    double initial_ms;
+    double ceiling_ms;
+    DeadlineStage connect;
+    DeadlineStage response;
+    int backoff;                        // Doublings from timeout streaks
+    int streak;                         // Timeouts since the last answer
+    size_t answered;
+    size_t timeouts;
+    size_t widened;                     // Times a streak doubled the deadlines
+    double timeout_ms;                  // Wall-clock spent on requests that timed out
+    pthread_mutex_t lock;
+} AdaptiveDeadline;
+
+// ========== FUNCTION PROTOTYPES ==========
+void deadline_init(AdaptiveDeadline *d, double floor_ms, double initial_ms, double ceiling_ms);
+void deadline_free(AdaptiveDeadline *d);
+long deadline_connect_ms(AdaptiveDeadline *d);
+long deadline_response_ms(AdaptiveDeadline *d);
+void deadline_observe(AdaptiveDeadline *d, CURL *easy, CURLcode code);
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * domain_match.c - Label-aware, case-insensitive "is under domain" checks
+ * domain_scan() finds candidate suffixes in bulk text with SSE2 (first and
+ * last byte of the domain compared 16 positions at a time) and only looks
+ * at the surrounding bytes for those candidates.
+ */
+
+#include <string.h>
+#include "domain_match.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// ========== HELPERS ==========
+static inline unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+}
+
+static inline int is_name_char(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '-' || c == '_';
+}
+
+// Compares `len` bytes of `s` against the lowercase `lower`, folding `s`
+static int equal_fold(const char *s, const char *lower, size_t len) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i upper_a = _mm_set1_epi8('A' - 1);
+    const __m128i upper_z = _mm_set1_epi8('Z' + 1);
+    const __m128i bit = _mm_set1_epi8(0x20);
+    for(; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i is_upper = _mm_and_si128(_mm_cmpgt_epi8(v, upper_a), _mm_cmplt_epi8(v, upper_z));
+        v = _mm_or_si128(v, _mm_and_si128(is_upper, bit));
+        __m128i w = _mm_loadu_si128((const __m128i *)(lower + i));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(v, w)) != 0xFFFF) return 0;
+    }
+#endif
+    for(; i < len; i++) {
+        if(fold((unsigned char)s[i]) != (unsigned char)lower[i]) return 0;
+    }
+    return 1;
+}
+
+// ========== INIT ==========
+int domain_matcher_init(DomainMatcher *m, const char *domain) {
+    size_t len = strlen(domain);
+    while(len > 0 && domain[len - 1] == '.') len--;
+    while(len > 0 && domain[0] == '.') { domain++; len--; }
+    if(len == 0 || len >= sizeof(m->domain)) return 0;
+
+    for(size_t i = 0; i < len; i++) m->domain[i] = (char)fold((unsigned char)domain[i]);
+    m->domain[len] = '\0';
+    m->len = len;
+    return 1;
+}
+
+// ========== SINGLE NAME ==========
+int domain_match(const DomainMatcher *m, const char *name, size_t len) {
+    if(len > 0 && name[len - 1] == '.') len--;
+    if(len < m->len) return 0;
+    if(len > m->len && name[len - m->len - 1] != '.') return 0;
+    return equal_fold(name + len - m->len, m->domain, m->len);
+}
+
+// ========== BULK SCAN ==========
+// Checks the candidate at `pos` and reports the full name around it.
+// Returns where scanning should resume.
+static size_t check_candidate(const DomainMatcher *m, const char *text, size_t len, size_t pos,
+                              DomainHitCallback on_hit, void *userdata, size_t *hits) {
+    size_t end = pos + m->len;
+    if(!equal_fold(text + pos, m->domain, m->len)) return pos + 1;
+
+    // Right boundary: the domain must be the last label ("example.com.evil" fails)
+    if(end < len) {
+        unsigned char c = (unsigned char)text[end];
+        if(is_name_char(c)) return pos + 1;
+        if(c == '.' && end + 1 < len && is_name_char((unsigned char)text[end + 1])) return pos + 1;
+    }
+
+    // Left boundary: start of a name or a label separator ("notexample.com" fails)
+    size_t start = pos;
+    if(pos > 0) {
+        unsigned char c = (unsigned char)text[pos - 1];
+        if(is_name_char(c)) return pos + 1;
+        if(c == '.') {
+            start = pos - 1;
+            while(start > 0 && (is_name_char((unsigned char)text[start - 1]) ||
+                                text[start - 1] == '.' || text[start - 1] == '*')) {
+                start--;
+            }
+            // A JSON escape such as "\nwww.example.com" is not part of the name
+            if(start > 0 && text[start - 1] == '\\') start++;
+            while(start < pos && text[start] == '.') start++;
+        }
+    }
+
+    on_hit(text + start, end - start, userdata);
+    (*hits)++;
+    return end;
+}
+
+size_t domain_scan(const DomainMatcher *m, const char *text, size_t len,
+                   DomainHitCallback on_hit, void *userdata) {
+    size_t hits = 0;
+    size_t n = m->len;
+    if(n == 0 || len < n) return 0;
+
+    size_t i = 0;
+#ifdef __SSE2__
+    // OR-ing 0x20 folds letters; the few non-letters it aliases are weeded
+    // out by the exact comparison in check_candidate()
+    const __m128i bit = _mm_set1_epi8(0x20);
+    const __m128i first = _mm_set1_epi8((char)(m->domain[0] | 0x20));
+    const __m128i last = _mm_set1_epi8((char)(m->domain[n - 1] | 0x20));
+
+    while(i + n - 1 + 16 <= len) {
+        __m128i a = _mm_or_si128(_mm_loadu_si128((const __m128i *)(text + i)), bit);
+        __m128i b = _mm_or_si128(_mm_loadu_si128((const __m128i *)(text + i + n - 1)), bit);
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+
+        size_t next = i + 16;
+        while(mask) {
+            size_t pos = i + (size_t)__builtin_ctz(mask);
+            mask &= mask - 1;
+            size_t resume = check_candidate(m, text, len, pos, on_hit, userdata, &hits);
+            if(resume > pos + 1) {
+                // Drop candidates inside the name we just reported
+                while(mask && i + (size_t)__builtin_ctz(mask) < resume) mask &= mask - 1;
+                if(resume > next) next = resume;
+            }
+        }
+        i = next;
+    }
+#endif
+    unsigned char first_c = (unsigned char)m->domain[0];
+    while(i + n <= len) {
+        if(fold((unsigned char)text[i]) == first_c) {
+            i = check_candidate(m, text, len, i, on_hit, userdata, &hits);
+        } else {
+            i++;
+        }
+    }
+    return hits;
+}
@@ -0,0 +1,28 @@
+/*
+ * domain_match.h - Label-aware, case-insensitive "is under domain" checks
+ * "api.example.com" and "example.com" match example.com;
+ * "notexample.com" and "example.com.evil" do not.
+ */
+
+#ifndef DOMAIN_MATCH_H
+#define DOMAIN_MATCH_H
+
+#include <stddef.h>
+
+// ========== STRUCTURES ==========
+typedef struct {
+    char domain[256];       // Lowercase, no trailing dot
+    size_t len;
+} DomainMatcher;
+
+// Called for every in-scope name found by domain_scan(); `name` is not
+// NUL-terminated and may contain uppercase letters
+typedef void (*DomainHitCallback)(const char *name, size_t len, void *userdata);
+
+// ========== FUNCTION PROTOTYPES ==========
+int domain_matcher_init(DomainMatcher *m, const char *domain);
+int domain_match(const DomainMatcher *m, const char *name, size_t len);
+size_t domain_scan(const DomainMatcher *m, const char *text, size_t len,
+                   DomainHitCallback on_hit, void *userdata);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * http_client.c - Shared curl context and common handle setup
+ * Scans on different threads use curl at the same time, and libcurl does
+ * not allow a connection pool to be shared between concurrent threads, so
+ * only the DNS cache and TLS sessions are shared (under the locks below).
+ * Connections stay in the pool of the handle or multi handle that opened
+ * them.
+ */
+
+#include <string.h>
+#include "http_client.h"
+
+// ========== SHARE LOCKS ==========
+static void share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
+    (void)handle; (void)access;
+    HttpClient *c = (HttpClient *)userptr;
+    if(data >= 0 && data < CURL_LOCK_DATA_LAST) pthread_mutex_lock(&c->locks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userptr) {
+    (void)handle;
+    HttpClient *c = (HttpClient *)userptr;
+    if(data >= 0 && data < CURL_LOCK_DATA_LAST) pthread_mutex_unlock(&c->locks[data]);
+}
+
+// ========== INIT / FREE ==========
+// `c` must stay at the same address while handles from it are in use
+int http_client_init(HttpClient *c, const char *proxy, const char *user_agent) {
+    memset(c, 0, sizeof(*c));
+    c->proxy = proxy;
+    c->user_agent = user_agent;
+
+    c->share = curl_share_init();
+    if(!c->share) return 0;
+    for(int i = 0; i < CURL_LOCK_DATA_LAST; i++) pthread_mutex_init(&c->locks[i], NULL);
+
+    curl_share_setopt(c->share, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(c->share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    curl_share_setopt(c->share, CURLSHOPT_USERDATA, c);
+    curl_share_setopt(c->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(c->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    return 1;
+}
+
+// Every handle from the client must already be cleaned up
+void http_client_free(HttpClient *c) {
+    if(!c->share) return;
+    curl_share_cleanup(c->share);
+    for(int i = 0; i < CURL_LOCK_DATA_LAST; i++) pthread_mutex_destroy(&c->locks[i]);
+    memset(c, 0, sizeof(*c));
+}
+
+// ========== HANDLES ==========
+// A new easy handle with the shared settings; the caller sets the URL,
+// write callback and anything specific to its request
+CURL *http_client_handle(HttpClient *c) {
+    CURL *curl = curl_easy_init();
+    if(!curl) return NULL;
+
+    if(c->share) curl_easy_setopt(curl, CURLOPT_SHARE, c->share);
+    if(c->proxy) {
+        curl_easy_setopt(curl, CURLOPT_PROXY, c->proxy);
+        curl_easy_setopt(curl, CURLOPT_PROXYTYPE, CURLPROXY_SOCKS5);
+    }
+    if(c->user_agent) curl_easy_setopt(curl, CURLOPT_USERAGENT, c->user_agent);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    // Probes only look at the status line, so a certificate issued for
+    // another name (shared hosting, default vhosts) must not fail them
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    // "" offers every encoding this libcurl can decode (gzip, br, ...);
+    // bodies reach the write callback already decompressed, chunk by chunk
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+
+    // Stalls are detected by throughput, not by a wall clock that would
+    // also cut off large answers that are still arriving steadily
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, (long)HTTP_CONNECT_TIMEOUT_SEC);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, (long)HTTP_LOW_SPEED_BYTES);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)HTTP_LOW_SPEED_SEC);
+    return curl;
+}
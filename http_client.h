@@ -0,0 +1,34 @@
+/*
+ * http_client.h - One curl context shared by every phase
+ * The Tor check, crt.sh and the probes all take their easy handles from
+ * here, so DNS answers and TLS sessions carry over from one phase (and
+ * one scan) to the next instead of being rebuilt each time. Open
+ * connections are pooled per handle: the probe engine's multi handle
+ * keeps its own for the length of a run.
+ */
+
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <pthread.h>
+#include <curl/curl.h>
+
+// ========== CONFIGURATION ==========
+#define HTTP_CONNECT_TIMEOUT_SEC 30     // Tor circuits can be slow to build
+#define HTTP_LOW_SPEED_BYTES     256    // Abort a transfer that stays below this rate...
+#define HTTP_LOW_SPEED_SEC       60     // ...for this many seconds
+
+// ========== STRUCTURES ==========
+typedef struct {
+    CURLSH *share;
+    pthread_mutex_t locks[CURL_LOCK_DATA_LAST];
+    const char *proxy;          // NULL = direct
+    const char *user_agent;
+} HttpClient;
+
+// ========== FUNCTION PROTOTYPES ==========
+int http_client_init(HttpClient *c, const char *proxy, const char *user_agent);
+void http_client_free(HttpClient *c);
+CURL *http_client_handle(HttpClient *c);
+
+#endif
@@ -0,0 +1,330 @@
+/*
+ * ingest.c - Offline ingest of passive-DNS export files
+ * Plain files are mmap'd and split in place; gzip files are inflated by
+ * the calling thread and handed over chunk by chunk. Each worker keeps its
+ * own deduplicating store, merged into the caller's store at the end.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "ingest.h"
+
+#define QUEUE_SLOTS 16
+
+// ========== STRUCTURES ==========
+typedef struct {
+    const char *data;
+    size_t len;
+    char *owned;            // Freed by the worker when set
+} IngestChunk;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    IngestChunk items[QUEUE_SLOTS];
+    size_t head;
+    size_t count;
+    int closed;
+} ChunkQueue;
+
+typedef struct {
+    pthread_t thread;
+    ChunkQueue *queue;
+    IngestFormat format;
+    const DomainMatcher *matcher;
+    ResultStore local;
+    CtLogStats ct;
+    size_t hits;
+    size_t bytes;
+    size_t chunks;
+} IngestWorker;
+
+// ========== CHUNK QUEUE ==========
+static void queue_push(ChunkQueue *q, IngestChunk chunk) {
+    pthread_mutex_lock(&q->lock);
+    while(q->count == QUEUE_SLOTS) pthread_cond_wait(&q->not_full, &q->lock);
+    q->items[(q->head + q->count) % QUEUE_SLOTS] = chunk;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static int queue_pop(ChunkQueue *q, IngestChunk *chunk) {
+    pthread_mutex_lock(&q->lock);
+    while(q->count == 0 && !q->closed) pthread_cond_wait(&q->not_empty, &q->lock);
+    if(q->count == 0) {
+        pthread_mutex_unlock(&q->lock);
+        return 0;
+    }
+    *chunk = q->items[q->head];
+    q->head = (q->head + 1) % QUEUE_SLOTS;
+    q->count--;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return 1;
+}
+
+static void queue_close(ChunkQueue *q) {
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// ========== WORKER ==========
+static void on_hit(const char *name, size_t len, void *userdata) {
+    IngestWorker *w = (IngestWorker *)userdata;
+    char buf[MAX_NAME_LEN + 1];
+
+    if(len > MAX_NAME_LEN) return;
+    memcpy(buf, name, len);
+    buf[len] = '\0';
+    result_store_add(&w->local, buf, 1, NULL, 0, 0, NULL);
+    w->hits++;
+}
+
+static void *worker_main(void *arg) {
+    IngestWorker *w = (IngestWorker *)arg;
+    IngestChunk chunk;
+
+    while(queue_pop(w->queue, &chunk)) {
+        if(w->format == INGEST_CT_LOG) {
+            ct_log_scan(chunk.data, chunk.len, w->matcher, on_hit, w, &w->ct);
+        } else {
+            domain_scan(w->matcher, chunk.data, chunk.len, on_hit, w);
+        }
+        w->bytes += chunk.len;
+        w->chunks++;
+        free(chunk.owned);
+    }
+    return NULL;
+}
+
+// ========== CHUNK BOUNDARIES ==========
+// Text is cut after a newline so no name straddles two chunks; CT batches
+// right before a "leaf_input" key so every chunk holds whole entries
+
+// Offset of the first cut point in data, or len if there is none
+static size_t first_cut(IngestFormat format, const char *data, size_t len) {
+    if(format == INGEST_CT_LOG) return ct_log_boundary(data, len);
+    const char *nl = memchr(data, '\n', len);
+    return nl ? (size_t)(nl - data) + 1 : len;
+}
+
+// Offset of the last cut point in data, or 0 if there is none
+static size_t last_cut(IngestFormat format, const char *data, size_t len) {
+    if(format == INGEST_CT_LOG) {
+        size_t last = 0, pos = 0;
+        while(pos < len) {
+            size_t at = pos + ct_log_boundary(data + pos, len - pos);
+            if(at == len) break;
+            last = at;
+            pos = at + 1;
+        }
+        return last;
+    }
+    const char *nl = data + len;
+    while(nl > data && nl[-1] != '\n') nl--;
+    return (size_t)(nl - data);
+}
+
+// ========== PRODUCERS ==========
+static void produce_mapped(ChunkQueue *q, IngestFormat format, const char *map, size_t size) {
+    size_t pos = 0;
+    while(pos < size) {
+        size_t end = pos + INGEST_CHUNK_SIZE;
+        if(end >= size) {
+            end = size;
+        } else {
+            end += first_cut(format, map + end, size - end);
+        }
+        IngestChunk chunk = { map + pos, end - pos, NULL };
+        queue_push(q, chunk);
+        pos = end;
+    }
+
+    queue_close(q);
+}
+
+static int produce_gzip(ChunkQueue *q, IngestFormat format, const char *path, const char **error) {
+    gzFile gz = gzopen(path, "rb");
+    if(!gz) {
+        *error = "cannot open gzip file";
+        queue_close(q);
+        return 0;
+    }
+    gzbuffer(gz, 256 * 1024);
+
+    char *carry = NULL;
+    size_t carry_len = 0;
+    int ok = 1;
+
+    for(;;) {
+        char *buf = malloc(carry_len + INGEST_CHUNK_SIZE);
+        if(!buf) {
+            *error = "out of memory";
+            ok = 0;
+            break;
+        }
+        if(carry_len) memcpy(buf, carry, carry_len);
+        free(carry);
+        carry = NULL;
+
+        int n = gzread(gz, buf + carry_len, INGEST_CHUNK_SIZE);
+        if(n < 0) {
+            *error = "gzip stream is corrupt";
+            free(buf);
+            ok = 0;
+            break;
+        }
+        size_t len = carry_len + (size_t)n;
+        carry_len = 0;
+        if(len == 0) {
+            free(buf);
+            break;
+        }
+
+        // Keep the partial last line (or entry) for the next chunk
+        size_t cut = len;
+        if(n > 0) {
+            size_t last = last_cut(format, buf, len);
+            if(last > 0) cut = last;
+        }
+        if(cut < len) {
+            carry_len = len - cut;
+            carry = malloc(carry_len);
+            if(!carry) {
+                *error = "out of memory";
+                free(buf);
+                ok = 0;
+                break;
+            }
+            memcpy(carry, buf + cut, carry_len);
+        }
+
+        IngestChunk chunk = { buf, cut, buf };
+        queue_push(q, chunk);
+        if(n == 0 && carry_len == 0) break;
+    }
+
+    free(carry);
+    gzclose(gz);
+    queue_close(q);
+    return ok;
+}
+
+// ========== INGEST FILE ==========
+int ingest_file(const char *path, IngestFormat format, const DomainMatcher *m, int threads,
+                ResultStore *out, unsigned int source, IngestStats *stats,
+                const char **error) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    memset(stats, 0, sizeof(*stats));
+    *error = NULL;
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        *error = "cannot open file";
+        return 0;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        *error = "cannot stat file";
+        return 0;
+    }
+    if(st.st_size == 0) {
+        close(fd);
+        return 1;
+    }
+
+    unsigned char magic[2] = { 0, 0 };
+    stats->gzip = pread(fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+
+    if(threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads <= 0) threads = 1;
+    if(threads > INGEST_MAX_THREADS) threads = INGEST_MAX_THREADS;
+
+    ChunkQueue queue;
+    memset(&queue, 0, sizeof(queue));
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.not_empty, NULL);
+    pthread_cond_init(&queue.not_full, NULL);
+
+    IngestWorker *workers = calloc(threads, sizeof(IngestWorker));
+    if(!workers) {
+        close(fd);
+        *error = "out of memory";
+        return 0;
+    }
+
+    int started = 0;
+    for(int i = 0; i < threads; i++) {
+        workers[i].queue = &queue;
+        workers[i].format = format;
+        workers[i].matcher = m;
+        result_store_init(&workers[i].local);
+        if(pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) break;
+        started++;
+    }
+
+    int ok = 1;
+    char *map = NULL;
+    if(started == 0) {
+        *error = "could not start worker threads";
+        ok = 0;
+    } else if(stats->gzip) {
+        ok = produce_gzip(&queue, format, path, error);
+    } else {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map == MAP_FAILED) {
+            map = NULL;
+            *error = "mmap failed";
+            ok = 0;
+        } else {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            produce_mapped(&queue, format, map, (size_t)st.st_size);
+        }
+    }
+    queue_close(&queue);
+    close(fd);
+
+    // Mapped chunks point into the mapping, so unmap only once workers are done
+    for(int i = 0; i < started; i++) pthread_join(workers[i].thread, NULL);
+    if(map) munmap(map, st.st_size);
+
+    // Merge the per-thread stores into the caller's
+    for(int i = 0; i < threads; i++) {
+        IngestWorker *w = &workers[i];
+        for(size_t j = 0; j < w->local.count; j++) {
+            int is_new = 0;
+            result_store_add(out, w->local.records[j].subdomain, 1, NULL, 0, source, &is_new);
+            stats->names += is_new;
+        }
+        stats->hits += w->hits;
+        stats->bytes += w->bytes;
+        stats->chunks += w->chunks;
+        stats->ct.entries += w->ct.entries;
+        stats->ct.precerts += w->ct.precerts;
+        stats->ct.malformed += w->ct.malformed;
+        result_store_free(&w->local);
+    }
+    free(workers);
+
+    pthread_mutex_destroy(&queue.lock);
+    pthread_cond_destroy(&queue.not_empty);
+    pthread_cond_destroy(&queue.not_full);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    stats->seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    return ok;
+}
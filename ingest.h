@@ -0,0 +1,42 @@
+/*
+ * ingest.h - Offline ingest of passive-DNS export files
+ * JSON Lines, CSV or any other line-oriented text, optionally gzip'd.
+ * The file is cut into line-aligned chunks that a pool of threads scans
+ * for names under the target domain. Mirrored CT log batches go through
+ * the same pool, cut at entry boundaries and decoded by ct_log.
+ */
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stddef.h>
+#include "domain_match.h"
+#include "result_store.h"
+#include "ct_log.h"
+
+// ========== CONFIGURATION ==========
+#define INGEST_CHUNK_SIZE  (4 * 1024 * 1024)  // Bytes per work item
+#define INGEST_MAX_THREADS 64
+
+// ========== STRUCTURES ==========
+typedef enum {
+    INGEST_TEXT,            // Any text: every in-scope name is taken
+    INGEST_CT_LOG,          // RFC 6962 get-entries batches
+} IngestFormat;
+
+typedef struct {
+    size_t bytes;           // Uncompressed bytes scanned
+    size_t chunks;
+    size_t hits;            // In-scope names seen, before dedup
+    size_t names;           // New names added to the store
+    CtLogStats ct;          // INGEST_CT_LOG only
+    double seconds;
+    int gzip;
+} IngestStats;
+
+// ========== FUNCTION PROTOTYPES ==========
+int ingest_file(const char *path, IngestFormat format, const DomainMatcher *m, int threads,
+                ResultStore *out, unsigned int source, IngestStats *stats,
+                const char **error);
+
+#endif
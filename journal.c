@@ -0,0 +1,154 @@
+/*
+ * journal.c - Append-only checkpoint journal for wordlist scans
+ * Line format:
+ *   SSJ1 <domain> <words> <fingerprint>    header, first line only
+ *   P <index> <found> <http> <name>        one completed probe
+ *   W <position>                           checkpoint, written at each fsync
+ * A line without its newline is a torn write from a crash and is dropped.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include "journal.h"
+#include "rate.h"
+
+// ========== HELPERS ==========
+static void mark_done(Journal *j, size_t index) {
+    if(index >= j->words || journal_is_done(j, index)) return;
+    j->done[index / 8] |= (unsigned char)(1 << (index % 8));
+    j->completed++;
+    while(j->position < j->words && journal_is_done(j, j->position)) j->position++;
+}
+
+int journal_is_done(const Journal *j, size_t index) {
+    return index < j->words && (j->done[index / 8] & (1 << (index % 8)));
+}
+
+static int write_header(Journal *j, const char *domain, uint64_t fingerprint) {
+    fprintf(j->fp, "%s %s %zu %016" PRIx64 "\n", JOURNAL_MAGIC, domain, j->words, fingerprint);
+    return journal_sync(j);
+}
+
+// Replays `fp` into `j`; returns the offset just past the last complete line
+static long replay_file(Journal *j, FILE *fp, const char *domain, uint64_t fingerprint,
+                        JournalReplayFn replay, void *userdata, const char **error) {
+    char line[MAX_NAME_LEN + 128];
+    long good = 0;
+
+    if(!fgets(line, sizeof(line), fp) || !strchr(line, '\n')) {
+        *error = "journal has no header";
+        return -1;
+    }
+    char magic[8], journal_domain[256];
+    size_t words;
+    uint64_t journal_fingerprint;
+    if(sscanf(line, "%7s %255s %zu %" SCNx64, magic, journal_domain, &words, &journal_fingerprint) != 4 ||
+       strcmp(magic, JOURNAL_MAGIC) != 0) {
+        *error = "not a scan journal";
+        return -1;
+    }
+    if(strcmp(journal_domain, domain) != 0 || words != j->words || journal_fingerprint != fingerprint) {
+        *error = "journal was written for a different domain or wordlist";
+        return -1;
+    }
+    good = ftell(fp);
+
+    while(fgets(line, sizeof(line), fp)) {
+        if(!strchr(line, '\n')) break;
+        line[strcspn(line, "\n")] = '\0';
+
+        size_t index;
+        int found, http, name_at = 0;
+        if(line[0] == 'P' && sscanf(line, "P %zu %d %d %n", &index, &found, &http, &name_at) == 3 &&
+           name_at > 0 && line[name_at] && index < j->words) {
+            if(!journal_is_done(j, index)) replay(index, line + name_at, found, http, userdata);
+            mark_done(j, index);
+        } else if(line[0] != 'W') {
+            break;  // Garbage: keep everything before it
+        }
+        good = ftell(fp);
+    }
+    return good;
+}
+
+// ========== OPEN / CLOSE ==========
+int journal_open(Journal *j, const char *path, const char *domain, size_t words,
+                 uint64_t fingerprint, int resume, JournalReplayFn replay, void *userdata,
+                 const char **error) {
+    memset(j, 0, sizeof(*j));
+    j->words = words;
+    j->done = calloc(words / 8 + 1, 1);
+    if(!j->done) {
+        *error = "out of memory";
+        return 0;
+    }
+
+    FILE *old = resume ? fopen(path, "r+") : NULL;
+    if(old) {
+        long good = replay_file(j, old, domain, fingerprint, replay, userdata, error);
+        if(good < 0) {
+            fclose(old);
+            journal_close(j);
+            return 0;
+        }
+        // Cut off a torn tail so new records start on a fresh line
+        fflush(old);
+        if(ftruncate(fileno(old), good) != 0 || fseek(old, good, SEEK_SET) != 0) {
+            fclose(old);
+            journal_close(j);
+            *error = "cannot truncate journal";
+            return 0;
+        }
+        j->fp = old;
+        j->last_sync_ms = monotonic_ms();
+        return 1;
+    }
+
+    // A fresh scan never silently discards an earlier journal
+    if(!resume && access(path, F_OK) == 0) {
+        char prev[4200];
+        snprintf(prev, sizeof(prev), "%s.prev", path);
+        rename(path, prev);
+    }
+
+    j->fp = fopen(path, "w");
+    if(!j->fp || !write_header(j, domain, fingerprint)) {
+        journal_close(j);
+        *error = "cannot create journal";
+        return 0;
+    }
+    return 1;
+}
+
+void journal_close(Journal *j) {
+    if(j->fp) {
+        journal_sync(j);
+        fclose(j->fp);
+    }
+    free(j->done);
+    memset(j, 0, sizeof(*j));
+}
+
+// ========== APPEND ==========
+int journal_sync(Journal *j) {
+    if(!j->fp) return 0;
+    if(j->completed) fprintf(j->fp, "W %zu\n", j->position);
+    int ok = fflush(j->fp) == 0 && fsync(fileno(j->fp)) == 0;
+    j->unsynced = 0;
+    j->last_sync_ms = monotonic_ms();
+    return ok;
+}
+
+int journal_probe(Journal *j, size_t index, const char *name, int found, int http_status) {
+    if(!j->fp) return 0;
+    fprintf(j->fp, "P %zu %d %d %s\n", index, found, http_status, name);
+    mark_done(j, index);
+
+    if(++j->unsynced >= JOURNAL_SYNC_RECORDS || monotonic_ms() - j->last_sync_ms >= JOURNAL_SYNC_MS) {
+        return journal_sync(j);
+    }
+    return !ferror(j->fp);
+}
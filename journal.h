@@ -0,0 +1,44 @@
+/*
+ * journal.h - Append-only checkpoint journal for wordlist scans
+ * Every completed probe is appended as one line and the file is fsync'd
+ * at short intervals, so an interrupted scan can be resumed without
+ * probing any candidate twice.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "result_store.h"
+
+// ========== CONFIGURATION ==========
+#define JOURNAL_MAGIC        "SSJ1"
+#define JOURNAL_SYNC_RECORDS 16      // fsync after this many probes...
+#define JOURNAL_SYNC_MS      5000    // ...or this long since the last fsync
+
+// ========== STRUCTURES ==========
+typedef struct {
+    FILE *fp;
+    unsigned char *done;    // Bit per wordlist index
+    size_t words;
+    size_t position;        // Every index below this has completed
+    size_t completed;
+    size_t unsynced;
+    double last_sync_ms;
+} Journal;
+
+// Called for each probe replayed from an existing journal
+typedef void (*JournalReplayFn)(size_t index, const char *name, int found, int http_status, void *userdata);
+
+// ========== FUNCTION PROTOTYPES ==========
+int journal_open(Journal *j, const char *path, const char *domain, size_t words,
+                 uint64_t fingerprint, int resume, JournalReplayFn replay, void *userdata,
+                 const char **error);
+int journal_is_done(const Journal *j, size_t index);
+int journal_probe(Journal *j, size_t index, const char *name, int found, int http_status);
+int journal_sync(Journal *j);
+void journal_close(Journal *j);
+
+#endif
@@ -0,0 +1,305 @@
+/*
+ * metrics.c - Log-linear latency histograms and their exporters
+ * Bucket i < 16 holds exactly i microseconds; above that each power of
+ * two is split into 16 equal sub-buckets, the same layout HDR histograms
+ * use with one significant hex digit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "metrics.h"
+#include "rate.h"
+
+#define SUB_COUNT (1 << METRICS_SUB_BITS)
+
+static const char *stage_names[STAGE_COUNT] = { "connect", "handshake", "ttfb", "total" };
+
+// Upper bounds exported as Prometheus buckets, in seconds
+static const double prom_bounds[] = { 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60 };
+#define PROM_BOUNDS (sizeof(prom_bounds) / sizeof(prom_bounds[0]))
+
+// ========== HISTOGRAM ==========
+static size_t bucket_of(uint64_t us) {
+    if(us < SUB_COUNT) return (size_t)us;
+    int msb = 63 - __builtin_clzll(us);
+    int shift = msb - METRICS_SUB_BITS;
+    size_t index = (size_t)(shift + 1) * SUB_COUNT + (size_t)((us >> shift) - SUB_COUNT);
+    return index < METRICS_BUCKETS ? index : METRICS_BUCKETS - 1;
+}
+
+static uint64_t bucket_low(size_t index) {
+    if(index < SUB_COUNT) return index;
+    int shift = (int)(index / SUB_COUNT) - 1;
+    return (uint64_t)(SUB_COUNT + index % SUB_COUNT) << shift;
+}
+
+static uint64_t bucket_width(size_t index) {
+    return index < SUB_COUNT ? 1 : (uint64_t)1 << (index / SUB_COUNT - 1);
+}
+
+void histogram_add(LatencyHistogram *h, uint64_t us) {
+    h->buckets[bucket_of(us)]++;
+    if(h->count == 0 || us < h->min_us) h->min_us = us;
+    if(us > h->max_us) h->max_us = us;
+    h->count++;
+    h->sum_us += us;
+}
+
+// Midpoint of the bucket holding the pct-th percentile, clamped to min/max
+uint64_t histogram_percentile(const LatencyHistogram *h, double pct) {
+    if(h->count == 0) return 0;
+    uint64_t rank = (uint64_t)(pct / 100.0 * h->count + 0.5);
+    if(rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for(size_t i = 0; i < METRICS_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if(seen >= rank) {
+            uint64_t mid = bucket_low(i) + bucket_width(i) / 2;
+            if(mid < h->min_us) mid = h->min_us;
+            if(mid > h->max_us) mid = h->max_us;
+            return mid;
+        }
+    }
+    return h->max_us;
+}
+
+// Values at or below `us`, to bucket resolution
+static uint64_t histogram_count_below(const LatencyHistogram *h, uint64_t us) {
+    uint64_t n = 0;
+    for(size_t i = 0; i < METRICS_BUCKETS && bucket_low(i) + bucket_width(i) <= us + 1; i++) {
+        n += h->buckets[i];
+    }
+    return n;
+}
+
+// ========== REGISTRY ==========
+void metrics_init(Metrics *m) {
+    memset(m, 0, sizeof(*m));
+    pthread_mutex_init(&m->lock, NULL);
+    pthread_cond_init(&m->wake, NULL);
+    m->started_ms = monotonic_ms();
+}
+
+void metrics_free(Metrics *m) {
+    metrics_stop_export(m);
+    pthread_mutex_destroy(&m->lock);
+    pthread_cond_destroy(&m->wake);
+}
+
+// Finds or registers a phase; NULL once METRICS_MAX_PHASES are in use
+PhaseMetrics *metrics_phase(Metrics *m, const char *name) {
+    PhaseMetrics *p = NULL;
+    pthread_mutex_lock(&m->lock);
+    for(int i = 0; i < m->phase_count && !p; i++) {
+        if(strcmp(m->phases[i].name, name) == 0) p = &m->phases[i];
+    }
+    if(!p && m->phase_count < METRICS_MAX_PHASES) {
+        p = &m->phases[m->phase_count++];
+        p->owner = m;
+        p->name = name;
+    }
+    pthread_mutex_unlock(&m->lock);
+    return p;
+}
+
+// Reads the finished transfer's timings off `easy`; `p` may be NULL
+void metrics_record(PhaseMetrics *p, CURL *easy, CURLcode code) {
+    if(!p) return;
+    Metrics *m = p->owner;
+    curl_off_t connect = 0, app = 0, first = 0, total = 0;
+    long http = 0, connects = 0;
+    curl_easy_getinfo(easy, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(easy, CURLINFO_APPCONNECT_TIME_T, &app);
+    curl_easy_getinfo(easy, CURLINFO_STARTTRANSFER_TIME_T, &first);
+    curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &http);
+    curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &connects);
+
+    pthread_mutex_lock(&m->lock);
+    p->requests++;
+    if(code == CURLE_OPERATION_TIMEDOUT) p->timeouts++;
+    else if(code != CURLE_OK) p->errors++;
+    else p->status[http >= 200 && http < 600 ? http / 100 : 0]++;
+
+    // A reused connection has no connect or handshake of its own
+    if(connects > 0) {
+        p->new_connections++;
+        histogram_add(&p->stages[STAGE_CONNECT], (uint64_t)connect);
+        if(app > connect) histogram_add(&p->stages[STAGE_HANDSHAKE], (uint64_t)(app - connect));
+    }
+    curl_off_t ready = app > connect ? app : connect;
+    if(code == CURLE_OK && first >= ready) histogram_add(&p->stages[STAGE_TTFB], (uint64_t)(first - ready));
+    histogram_add(&p->stages[STAGE_TOTAL], (uint64_t)total);
+    pthread_mutex_unlock(&m->lock);
+}
+
+// ========== PROMETHEUS ==========
+static void prom_counter(FILE *fp, const char *name, const char *help) {
+    fprintf(fp, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+}
+
+static void write_prometheus(Metrics *m, FILE *fp) {
+    prom_counter(fp, "shadowscan_requests_total", "Finished requests by phase");
+    for(int i = 0; i < m->phase_count; i++) {
+        fprintf(fp, "shadowscan_requests_total{phase=\"%s\"} %llu\n",
+                m->phases[i].name, (unsigned long long)m->phases[i].requests);
+    }
+    prom_counter(fp, "shadowscan_request_failures_total", "Requests without an HTTP response, by kind");
+    for(int i = 0; i < m->phase_count; i++) {
+        const PhaseMetrics *p = &m->phases[i];
+        fprintf(fp, "shadowscan_request_failures_total{phase=\"%s\",kind=\"timeout\"} %llu\n",
+                p->name, (unsigned long long)p->timeouts);
+        fprintf(fp, "shadowscan_request_failures_total{phase=\"%s\",kind=\"error\"} %llu\n",
+                p->name, (unsigned long long)p->errors);
+    }
+    prom_counter(fp, "shadowscan_responses_total", "HTTP responses by status class");
+    for(int i = 0; i < m->phase_count; i++) {
+        const PhaseMetrics *p = &m->phases[i];
+        for(int c = 0; c < 6; c++) {
+            if(c == 1) continue;
+            char cls[8];
+            if(c == 0) snprintf(cls, sizeof(cls), "other");
+            else snprintf(cls, sizeof(cls), "%dxx", c);
+            fprintf(fp, "shadowscan_responses_total{phase=\"%s\",class=\"%s\"} %llu\n",
+                    p->name, cls, (unsigned long long)p->status[c]);
+        }
+    }
+    prom_counter(fp, "shadowscan_connections_total", "New connections opened (not reused)");
+    for(int i = 0; i < m->phase_count; i++) {
+        fprintf(fp, "shadowscan_connections_total{phase=\"%s\"} %llu\n",
+                m->phases[i].name, (unsigned long long)m->phases[i].new_connections);
+    }
+
+    fprintf(fp, "# HELP shadowscan_latency_seconds Request timing by phase and stage\n"
+                "# TYPE shadowscan_latency_seconds histogram\n");
+    for(int i = 0; i < m->phase_count; i++) {
+        const PhaseMetrics *p = &m->phases[i];
+        for(int s = 0; s < STAGE_COUNT; s++) {
+            const LatencyHistogram *h = &p->stages[s];
+            for(size_t b = 0; b < PROM_BOUNDS; b++) {
+                fprintf(fp, "shadowscan_latency_seconds_bucket{phase=\"%s\",stage=\"%s\",le=\"%g\"} %llu\n",
+                        p->name, stage_names[s], prom_bounds[b],
+                        (unsigned long long)histogram_count_below(h, (uint64_t)(prom_bounds[b] * 1e6)));
+            }
+            fprintf(fp, "shadowscan_latency_seconds_bucket{phase=\"%s\",stage=\"%s\",le=\"+Inf\"} %llu\n",
+                    p->name, stage_names[s], (unsigned long long)h->count);
+            fprintf(fp, "shadowscan_latency_seconds_sum{phase=\"%s\",stage=\"%s\"} %.6f\n",
+                    p->name, stage_names[s], h->sum_us / 1e6);
+            fprintf(fp, "shadowscan_latency_seconds_count{phase=\"%s\",stage=\"%s\"} %llu\n",
+                    p->name, stage_names[s], (unsigned long long)h->count);
+        }
+    }
+
+    fprintf(fp, "# HELP shadowscan_latency_quantile_seconds Percentiles from the full-resolution histogram\n"
+                "# TYPE shadowscan_latency_quantile_seconds gauge\n");
+    static const double quantiles[] = { 50, 90, 99 };
+    for(int i = 0; i < m->phase_count; i++) {
+        const PhaseMetrics *p = &m->phases[i];
+        for(int s = 0; s < STAGE_COUNT; s++) {
+            if(p->stages[s].count == 0) continue;
+            for(int q = 0; q < 3; q++) {
+                fprintf(fp, "shadowscan_latency_quantile_seconds{phase=\"%s\",stage=\"%s\",quantile=\"%g\"} %.6f\n",
+                        p->name, stage_names[s], quantiles[q] / 100,
+                        histogram_percentile(&p->stages[s], quantiles[q]) / 1e6);
+            }
+        }
+    }
+    fprintf(fp, "# HELP shadowscan_uptime_seconds Time since the scan started\n"
+                "# TYPE shadowscan_uptime_seconds gauge\n"
+                "shadowscan_uptime_seconds %.3f\n", (monotonic_ms() - m->started_ms) / 1000.0);
+}
+
+// Written to a temporary file and renamed, so scrapers never see half a file
+int metrics_write_prometheus(Metrics *m, const char *path) {
+    char tmp[4200];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "w");
+    if(!fp) return 0;
+    pthread_mutex_lock(&m->lock);
+    write_prometheus(m, fp);
+    pthread_mutex_unlock(&m->lock);
+    int ok = fclose(fp) == 0;
+    return ok && rename(tmp, path) == 0;
+}
+
+static void *export_main(void *arg) {
+    Metrics *m = (Metrics *)arg;
+    pthread_mutex_lock(&m->lock);
+    while(!m->stopping) {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += METRICS_INTERVAL_SEC;
+        pthread_cond_timedwait(&m->wake, &m->lock, &until);
+        pthread_mutex_unlock(&m->lock);
+        metrics_write_prometheus(m, m->prom_path);
+        pthread_mutex_lock(&m->lock);
+    }
+    pthread_mutex_unlock(&m->lock);
+    return NULL;
+}
+
+int metrics_start_export(Metrics *m, const char *path, const char **error) {
+    m->prom_path = path;
+    if(!metrics_write_prometheus(m, path)) {
+        *error = "cannot write metrics file";
+        return 0;
+    }
+    if(pthread_create(&m->thread, NULL, export_main, m) != 0) {
+        *error = "cannot start metrics thread";
+        return 0;
+    }
+    m->exporting = 1;
+    return 1;
+}
+
+// Stops the background writer after one last rewrite
+void metrics_stop_export(Metrics *m) {
+    if(!m->exporting) return;
+    pthread_mutex_lock(&m->lock);
+    m->stopping = 1;
+    pthread_cond_signal(&m->wake);
+    pthread_mutex_unlock(&m->lock);
+    pthread_join(m->thread, NULL);
+    m->exporting = 0;
+}
+
+// ========== JSON SUMMARY ==========
+static void json_histogram(FILE *fp, const LatencyHistogram *h) {
+    fprintf(fp, "{\"count\":%llu", (unsigned long long)h->count);
+    if(h->count) {
+        fprintf(fp, ",\"min\":%.3f,\"mean\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f",
+                h->min_us / 1e3, h->sum_us / 1e3 / h->count,
+                histogram_percentile(h, 50) / 1e3, histogram_percentile(h, 90) / 1e3,
+                histogram_percentile(h, 99) / 1e3, h->max_us / 1e3);
+    }
+    fprintf(fp, "}");
+}
+
+int metrics_write_json(Metrics *m, const char *path, const char *domain) {
+    FILE *fp = fopen(path, "w");
+    if(!fp) return 0;
+
+    pthread_mutex_lock(&m->lock);
+    fprintf(fp, "{\"domain\":\"%s\",\"finished\":%lld,\"duration_sec\":%.3f,\"latency_unit\":\"ms\",\"phases\":[",
+            domain, (long long)time(NULL), (monotonic_ms() - m->started_ms) / 1000.0);
+    for(int i = 0; i < m->phase_count; i++) {
+        const PhaseMetrics *p = &m->phases[i];
+        fprintf(fp, "%s\n  {\"name\":\"%s\",\"requests\":%llu,\"timeouts\":%llu,\"errors\":%llu,"
+                "\"new_connections\":%llu,\"status\":{\"2xx\":%llu,\"3xx\":%llu,\"4xx\":%llu,\"5xx\":%llu,\"other\":%llu}",
+                i ? "," : "", p->name, (unsigned long long)p->requests, (unsigned long long)p->timeouts,
+                (unsigned long long)p->errors, (unsigned long long)p->new_connections,
+                (unsigned long long)p->status[2], (unsigned long long)p->status[3],
+                (unsigned long long)p->status[4], (unsigned long long)p->status[5],
+                (unsigned long long)p->status[0]);
+        for(int s = 0; s < STAGE_COUNT; s++) {
+            fprintf(fp, ",\"%s\":", stage_names[s]);
+            json_histogram(fp, &p->stages[s]);
+        }
+        fprintf(fp, "}");
+    }
+    fprintf(fp, "\n]}\n");
+    pthread_mutex_unlock(&m->lock);
+    return fclose(fp) == 0;
+}
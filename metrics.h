@@ -0,0 +1,84 @@
+/*
+ * metrics.h - Per-phase request timing histograms and counters
+ * Every finished transfer contributes curl's timing breakdown (proxy
+ * connect, TLS handshake, time to first byte, total) to log-linear
+ * histograms, so Tor circuit latency and slow targets show up as
+ * separate distributions. Exported as a Prometheus text file that is
+ * rewritten in the background and as a JSON summary at exit.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <curl/curl.h>
+
+// ========== CONFIGURATION ==========
+#define METRICS_SUB_BITS     4       // 16 sub-buckets per power of two: <= 6.25% error
+#define METRICS_BUCKETS      576     // Covers 1 us to several days
+#define METRICS_MAX_PHASES   8
+#define METRICS_INTERVAL_SEC 10      // Prometheus file rewrite period
+
+// curl reports SOCKS negotiation inside its app-connect interval, so for
+// proxied requests "handshake" is Tor stream setup plus TLS with the target
+typedef enum {
+    STAGE_CONNECT,          // TCP connect (to the proxy when there is one)
+    STAGE_HANDSHAKE,        // SOCKS stream setup + TLS handshake
+    STAGE_TTFB,             // Connected to first response byte
+    STAGE_TOTAL,
+    STAGE_COUNT
+} MetricsStage;
+
+// ========== STRUCTURES ==========
+typedef struct Metrics Metrics;
+
+typedef struct {
+    uint64_t buckets[METRICS_BUCKETS];  // Microseconds, log-linear
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t min_us;
+    uint64_t max_us;
+} LatencyHistogram;
+
+typedef struct {
+    Metrics *owner;
+    const char *name;       // Prometheus label value, e.g. "probe"
+    uint64_t requests;
+    uint64_t timeouts;
+    uint64_t errors;        // Transport failures other than timeouts
+    uint64_t status[6];     // By class: [2] = 2xx ... [5] = 5xx, [0] = other
+    uint64_t new_connections;
+    LatencyHistogram stages[STAGE_COUNT];
+} PhaseMetrics;
+
+struct Metrics {
+    pthread_mutex_t lock;
+    PhaseMetrics phases[METRICS_MAX_PHASES];
+    int phase_count;
+    double started_ms;
+
+    // Background Prometheus export
+    const char *prom_path;
+    pthread_t thread;
+    pthread_cond_t wake;
+    int exporting;
+    int stopping;
+};
+
+// ========== FUNCTION PROTOTYPES ==========
+void metrics_init(Metrics *m);
+void metrics_free(Metrics *m);
+PhaseMetrics *metrics_phase(Metrics *m, const char *name);
+void metrics_record(PhaseMetrics *p, CURL *easy, CURLcode code);
+
+void histogram_add(LatencyHistogram *h, uint64_t us);
+uint64_t histogram_percentile(const LatencyHistogram *h, double pct);
+
+int metrics_start_export(Metrics *m, const char *path, const char **error);
+void metrics_stop_export(Metrics *m);
+int metrics_write_prometheus(Metrics *m, const char *path);
+int metrics_write_json(Metrics *m, const char *path, const char *domain);
+
+#endif
@@ -0,0 +1,368 @@
+/*
+ * name_index.c - Persistent index of every name ever discovered
+ * The file is immutable once written: a merge builds a new sorted file
+ * next to it and renames it into place, so readers never see a partial
+ * index.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "name_index.h"
+#include "arena.h"
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    uint64_t strings_size;
+    uint64_t records_offset;
+    uint64_t strings_offset;
+} NameIndexHeader;
+
+typedef struct {
+    const char *key;
+    uint16_t len;
+    uint8_t sources;
+} NewName;
+
+// ========== KEYS ==========
+// "api.example.com" -> "com.example.api"
+size_t reverse_labels(char *dst, size_t cap, const char *name, size_t len) {
+    if(len >= cap) return 0;
+
+    size_t out = 0;
+    size_t end = len;
+    while(end > 0) {
+        size_t start = end;
+        while(start > 0 && name[start - 1] != '.') start--;
+        if(out) dst[out++] = '.';
+        memcpy(dst + out, name + start, end - start);
+        out += end - start;
+        end = start ? start - 1 : 0;
+    }
+    dst[out] = '\0';
+    return out;
+}
+
+static int compare_key(const char *a, size_t alen, const char *b, size_t blen) {
+    size_t n = alen < blen ? alen : blen;
+    int c = memcmp(a, b, n);
+    if(c) return c;
+    return (alen > blen) - (alen < blen);
+}
+
+// Sets *corrupt and returns ix->count if it reads a record with a bad key
+static size_t lower_bound(const NameIndex *ix, const char *key, size_t len, int *corrupt) {
+    size_t lo = 0, hi = ix->count;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const NameIndexRecord *r = &ix->records[mid];
+        const char *k = name_index_key(ix, r);
+        if(!k) {
+            *corrupt = 1;
+            return ix->count;
+        }
+        if(compare_key(k, r->key_len, key, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// ========== OPEN / CLOSE ==========
+// count items of `item` bytes at `offset` lie inside a file of `size` bytes
+static int section_fits(size_t size, uint64_t offset, uint64_t count, size_t item) {
+    if(offset > size) return 0;
+    return count <= (size - offset) / item;
+}
+
+int name_index_open(NameIndex *ix, const char *path, const char **error) {
+    memset(ix, 0, sizeof(*ix));
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return 1;  // No index yet: empty, not an error
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return 1;
+    }
+    if((size_t)st.st_size < sizeof(NameIndexHeader)) {
+        close(fd);
+        *error = "index file is truncated";
+        return 0;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        *error = "mmap failed";
+        return 0;
+    }
+
+    NameIndexHeader h;
+    memcpy(&h, map, sizeof(h));
+    // Only the header is checked here, so opening costs the same for any
+    // index size; each record's key is checked when it is read
+    const char *problem = NULL;
+    if(memcmp(h.magic, NAME_INDEX_MAGIC, 4) != 0 || h.version != NAME_INDEX_VERSION) {
+        problem = "not a valid index file";
+    } else if(!section_fits(st.st_size, h.records_offset, h.count, sizeof(NameIndexRecord)) ||
+              h.records_offset % _Alignof(NameIndexRecord) != 0 ||
+              !section_fits(st.st_size, h.strings_offset, h.strings_size, 1)) {
+        problem = "index file is truncated or corrupt";
+    }
+    if(problem) {
+        munmap(map, st.st_size);
+        *error = problem;
+        return 0;
+    }
+
+    ix->base = map;
+    ix->size = st.st_size;
+    ix->records = (const NameIndexRecord *)(ix->base + h.records_offset);
+    ix->strings = ix->base + h.strings_offset;
+    ix->strings_size = h.strings_size;
+    ix->count = h.count;
+    return 1;
+}
+
+void name_index_close(NameIndex *ix) {
+    if(ix->base) munmap((void *)ix->base, ix->size);
+    memset(ix, 0, sizeof(*ix));
+}
+
+// The key of a record, or NULL if it does not lie inside the string table
+const char *name_index_key(const NameIndex *ix, const NameIndexRecord *r) {
+    if(r->key_len == 0 || r->key_len > MAX_NAME_LEN || r->key_offset > ix->strings_size ||
+       r->key_len > ix->strings_size - r->key_offset) {
+        return NULL;
+    }
+    return ix->strings + r->key_offset;
+}
+
+// ========== QUERY ==========
+static void emit(const char *key, const NameIndexRecord *r, NameIndexCallback cb, void *userdata) {
+    char name[MAX_NAME_LEN + 1];
+    if(reverse_labels(name, sizeof(name), key, r->key_len)) {
+        cb(name, r, userdata);
+    }
+}
+
+// Stops at the first record whose key lies outside the string table and
+// sets *error; the names passed to `cb` before that are still valid
+size_t name_index_query(const NameIndex *ix, const char *suffix,
+                        NameIndexCallback cb, void *userdata, const char **error) {
+    char normalized[MAX_NAME_LEN + 1];
+    char key[MAX_NAME_LEN + 2];
+    size_t len = normalize_name(normalized, sizeof(normalized), suffix, strlen(suffix));
+    if(!len || !ix->count) return 0;
+    len = reverse_labels(key, sizeof(key) - 1, normalized, len);
+    if(!len) return 0;
+
+    size_t matches = 0;
+    int corrupt = 0;
+
+    // The suffix itself, then everything below it ("com.example." prefix)
+    size_t i = lower_bound(ix, key, len, &corrupt);
+    if(i < ix->count) {
+        const NameIndexRecord *r = &ix->records[i];
+        const char *k = name_index_key(ix, r);
+        if(k && compare_key(k, r->key_len, key, len) == 0) {
+            emit(k, r, cb, userdata);
+            matches++;
+        }
+    }
+
+    key[len++] = '.';
+    for(i = corrupt ? ix->count : lower_bound(ix, key, len, &corrupt); i < ix->count; i++) {
+        const NameIndexRecord *r = &ix->records[i];
+        const char *k = name_index_key(ix, r);
+        if(!k) {
+            corrupt = 1;
+            break;
+        }
+        if(r->key_len < len || memcmp(k, key, len) != 0) break;
+        emit(k, r, cb, userdata);
+        matches++;
+    }
+    if(corrupt) *error = "index entry points outside the string table";
+    return matches;
+}
+
+// ========== MERGE ==========
+static int compare_new(const void *a, const void *b) {
+    const NewName *x = a, *y = b;
+    return compare_key(x->key, x->len, y->key, y->len);
+}
+
+typedef struct {
+    NameIndexRecord *records;
+    size_t count;
+    size_t capacity;
+    char *strings;
+    size_t strings_size;
+    size_t strings_cap;
+} IndexBuilder;
+
+static int builder_add(IndexBuilder *b, const char *key, size_t len, uint8_t sources,
+                       int64_t first_seen, int64_t last_seen) {
+    if(b->count == b->capacity) {
+        size_t cap = b->capacity ? b->capacity * 2 : 4096;
+        NameIndexRecord *records = realloc(b->records, cap * sizeof(NameIndexRecord));
+        if(!records) return 0;
+        b->records = records;
+        b->capacity = cap;
+    }
+    if(b->strings_size + len > b->strings_cap) {
+        size_t cap = b->strings_cap ? b->strings_cap * 2 : 65536;
+        while(cap < b->strings_size + len) cap *= 2;
+        char *strings = realloc(b->strings, cap);
+        if(!strings) return 0;
+        b->strings = strings;
+        b->strings_cap = cap;
+    }
+
+    NameIndexRecord *r = &b->records[b->count++];
+    memset(r, 0, sizeof(*r));
+    r->key_offset = (uint32_t)b->strings_size;
+    r->key_len = (uint16_t)len;
+    r->sources = sources;
+    r->first_seen = first_seen;
+    r->last_seen = last_seen;
+    memcpy(b->strings + b->strings_size, key, len);
+    b->strings_size += len;
+    return 1;
+}
+
+static int write_index(const char *path, const IndexBuilder *b) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "wb");
+    if(!fp) return 0;
+
+    NameIndexHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, NAME_INDEX_MAGIC, 4);
+    h.version = NAME_INDEX_VERSION;
+    h.count = b->count;
+    h.strings_size = b->strings_size;
+    h.records_offset = sizeof(h);
+    h.strings_offset = h.records_offset + b->count * sizeof(NameIndexRecord);
+
+    int ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+             fwrite(b->records, sizeof(NameIndexRecord), b->count, fp) == b->count &&
+             fwrite(b->strings, 1, b->strings_size, fp) == b->strings_size;
+    ok = (fflush(fp) == 0) && ok;
+    ok = (fsync(fileno(fp)) == 0) && ok;
+    ok = (fclose(fp) == 0) && ok;
+    ok = ok && rename(tmp, path) == 0;
+    if(!ok) unlink(tmp);
+    return ok;
+}
+
+int name_index_merge(const char *path, const ResultStore *store, time_t now,
+                     size_t *added, const char **error) {
+    *added = 0;
+
+    // Serialize concurrent runs that share an index
+    char lock_path[4096];
+    snprintf(lock_path, sizeof(lock_path), "%s.lock", path);
+    int lock_fd = open(lock_path, O_CREAT | O_RDWR, 0644);
+    if(lock_fd >= 0) flock(lock_fd, LOCK_EX);
+
+    NameIndex old;
+    if(!name_index_open(&old, path, error)) {
+        if(lock_fd >= 0) close(lock_fd);
+        return 0;
+    }
+
+    // Reversed keys of this run's confirmed names, sorted
+    Arena keys;
+    arena_init(&keys);
+    NewName *fresh = malloc((store->count + 1) * sizeof(NewName));
+    size_t fresh_count = 0;
+    int ok = fresh != NULL;
+
+    for(size_t i = 0; ok && i < store->count; i++) {
+        const SubdomainResult *r = &store->records[i];
+        if(!r->found) continue;
+        char key[MAX_NAME_LEN + 1];
+        size_t len = reverse_labels(key, sizeof(key), r->subdomain, r->name_len);
+        if(!len) continue;
+        fresh[fresh_count].key = arena_strndup(&keys, key, len);
+        fresh[fresh_count].len = (uint16_t)len;
+        fresh[fresh_count].sources = r->sources;
+        if(!fresh[fresh_count].key) ok = 0;
+        fresh_count++;
+    }
+    if(ok) qsort(fresh, fresh_count, sizeof(NewName), compare_new);
+
+    // Merge-join the two sorted sequences
+    IndexBuilder b;
+    memset(&b, 0, sizeof(b));
+    size_t i = 0, j = 0;
+    const char *corrupt = NULL;
+    size_t checked = 0;  // Old records below this one have sound, ascending keys
+    while(ok && (i < old.count || j < fresh_count)) {
+        const NameIndexRecord *o = i < old.count ? &old.records[i] : NULL;
+        const NewName *n = j < fresh_count ? &fresh[j] : NULL;
+        const char *okey = o ? name_index_key(&old, o) : NULL;
+
+        // The merge reads every old record anyway, so this is where a damaged
+        // index is caught before it could be written back out of order
+        if(o && i == checked) {
+            const NameIndexRecord *p = i > 0 ? &old.records[i - 1] : NULL;
+            if(!okey) {
+                corrupt = "index entry points outside the string table";
+            } else if(p && compare_key(name_index_key(&old, p), p->key_len, okey, o->key_len) >= 0) {
+                corrupt = "index entries are out of order";
+            }
+            if(corrupt) {
+                ok = 0;
+                break;
+            }
+            checked++;
+        }
+
+        int c = !o ? 1 : !n ? -1 : compare_key(okey, o->key_len, n->key, n->len);
+
+        if(c < 0) {
+            ok = builder_add(&b, okey, o->key_len, o->sources,
+                             o->first_seen, o->last_seen);
+            i++;
+        } else if(c > 0) {
+            ok = builder_add(&b, n->key, n->len, n->sources, now, now);
+            (*added)++;
+            j++;
+        } else {
+            ok = builder_add(&b, n->key, n->len, o->sources | n->sources, o->first_seen, now);
+            i++;
+            j++;
+        }
+    }
+
+    if(ok) {
+        name_index_close(&old);  // Release the mapping before replacing the file
+        ok = write_index(path, &b);
+        if(!ok) *error = "could not write index file";
+    } else {
+        name_index_close(&old);
+        *error = corrupt ? corrupt : "out of memory";
+    }
+
+    free(b.records);
+    free(b.strings);
+    free(fresh);
+    arena_free(&keys);
+    if(lock_fd >= 0) close(lock_fd);
+    return ok;
+}
@@ -0,0 +1,52 @@
+/*
+ * name_index.h - Persistent index of every name ever discovered
+ * Keys are stored with their labels reversed (api.example.com becomes
+ * com.example.api) and sorted, so all names under a suffix form one
+ * contiguous range found by binary search in the mapped file.
+ */
+
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "result_store.h"
+
+// ========== CONFIGURATION ==========
+#define NAME_INDEX_MAGIC   "SSIX"
+#define NAME_INDEX_VERSION 1
+
+// ========== STRUCTURES ==========
+typedef struct {
+    uint32_t key_offset;    // Reversed name in the string table
+    uint16_t key_len;
+    uint8_t sources;        // SOURCE_* bitmask, accumulated over runs
+    uint8_t reserved;
+    int64_t first_seen;
+    int64_t last_seen;
+} NameIndexRecord;
+
+typedef struct {
+    const char *base;       // Mapped file, NULL for a missing/empty index
+    size_t size;
+    const NameIndexRecord *records;
+    const char *strings;
+    size_t strings_size;
+    size_t count;
+} NameIndex;
+
+// `name` is in normal label order and NUL-terminated
+typedef void (*NameIndexCallback)(const char *name, const NameIndexRecord *record, void *userdata);
+
+// ========== FUNCTION PROTOTYPES ==========
+int name_index_open(NameIndex *ix, const char *path, const char **error);
+void name_index_close(NameIndex *ix);
+const char *name_index_key(const NameIndex *ix, const NameIndexRecord *r);
+size_t name_index_query(const NameIndex *ix, const char *suffix,
+                        NameIndexCallback cb, void *userdata, const char **error);
+int name_index_merge(const char *path, const ResultStore *store, time_t now,
+                     size_t *added, const char **error);
+size_t reverse_labels(char *dst, size_t cap, const char *name, size_t len);
+
+#endif
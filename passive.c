@@ -0,0 +1,423 @@
+/*
+ * passive.c - Concurrent passive sources feeding one dedup stage
+ * Sources never print; they fill in their result fields and a one-line
+ * note that the caller reports once the phase is over.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sched.h>
+#include <curl/curl.h>
+#include "passive.h"
+#include "ct_stream.h"
+#include "ct_cache.h"
+#include "ingest.h"
+#include "zone.h"
+#include "name_index.h"
+
+// ========== QUEUE ==========
+// Blocks (yielding) while the queue is full; returns 0 only for an unusable name
+int passive_push(PassiveQueue *q, const PassiveName *name) {
+    size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    PassiveCell *cell;
+
+    for(;;) {
+        cell = &q->cells[pos & (PASSIVE_QUEUE_SLOTS - 1)];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if(diff == 0) {
+            if(atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                     memory_order_relaxed, memory_order_relaxed)) break;
+        } else if(diff < 0) {
+            sched_yield();  // Full: wait for the consumer
+            pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+        }
+    }
+
+    cell->item = *name;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    return 1;
+}
+
+static int queue_pop(PassiveQueue *q, PassiveName *name) {
+    PassiveCell *cell = &q->cells[q->tail & (PASSIVE_QUEUE_SLOTS - 1)];
+    size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+    if(seq != q->tail + 1) return 0;
+
+    *name = cell->item;
+    atomic_store_explicit(&cell->seq, q->tail + PASSIVE_QUEUE_SLOTS, memory_order_release);
+    q->tail++;
+    return 1;
+}
+
+// Normalizes, scope-checks and queues one name; a known one still reaches
+// the result store, it is only not reported as new
+static int emit_name(PassiveSource *s, PassiveQueue *q, const char *name, size_t len,
+                     unsigned int sources, const CtEntryInfo *info, int known) {
+    PassiveName item;
+    size_t n = normalize_name(item.name, sizeof(item.name), name, len);
+    if(!n || !domain_match(s->target, item.name, n)) return 0;
+
+    item.sources = (uint8_t)sources;
+    item.not_before[0] = item.not_after[0] = '\0';
+    if(info) {
+        snprintf(item.not_before, sizeof(item.not_before), "%.10s", info->not_before);
+        snprintf(item.not_after, sizeof(item.not_after), "%.10s", info->not_after);
+    }
+    item.known = (uint8_t)known;
+    passive_push(q, &item);
+    if(known) s->known++;
+    else s->names++;
+    return 1;
+}
+
+static int emit(PassiveSource *s, PassiveQueue *q, const char *name, size_t len,
+                unsigned int sources, const CtEntryInfo *info) {
+    return emit_name(s, q, name, len, sources, info, 0);
+}
+
+// ========== CERTIFICATE TRANSPARENCY ==========
+typedef struct {
+    PassiveSource *source;
+    PassiveQueue *out;
+    ResultStore fetched;            // Every in-scope name of this query, for the cache
+    ResultStore previous;           // Last cached snapshot
+} CtContext;
+
+// Called by the streaming parser for every name, while the download is running
+static void on_ct_name(const char *name, size_t len, const CtEntryInfo *info, void *userdata) {
+    CtContext *ctx = (CtContext *)userdata;
+    char normalized[MAX_NAME_LEN + 1];
+    size_t n = normalize_name(normalized, sizeof(normalized), name, len);
+    if(!n || !domain_match(ctx->source->target, normalized, n)) return;
+
+    // crt.sh repeats names across certificates; only pass each one on once
+    int is_new = 0;
+    result_store_add(&ctx->fetched, normalized, 1, NULL, 0, SOURCE_CT, &is_new);
+    if(!is_new) return;
+
+    int known = ctx->source->delta && result_store_find(&ctx->previous, normalized);
+    emit_name(ctx->source, ctx->out, normalized, n, SOURCE_CT, info, known);
+}
+
+static int run_crtsh(PassiveSource *s, PassiveQueue *out) {
+    CtContext ctx;
+    ctx.source = s;
+    ctx.out = out;
+    result_store_init(&ctx.fetched);
+    result_store_init(&ctx.previous);
+
+    // A fresh enough snapshot answers the query without touching the network
+    time_t fetched_at = 0;
+    time_t now = time(NULL);
+    int cached = s->cache_dir && ct_cache_load(s->cache_dir, s->target->domain, &ctx.previous, &fetched_at);
+
+    if(cached && s->cache_ttl > 0 && now - fetched_at < s->cache_ttl) {
+        // In delta mode everything in a still-valid snapshot is already known
+        for(size_t i = 0; i < ctx.previous.count; i++) {
+            const SubdomainResult *r = &ctx.previous.records[i];
+            emit_name(s, out, r->subdomain, r->name_len, SOURCE_CT, NULL, s->delta);
+        }
+        snprintf(s->note, sizeof(s->note), "cached result from %ld min ago (TTL %ld min)",
+                 (long)(now - fetched_at) / 60, s->cache_ttl / 60);
+        result_store_free(&ctx.fetched);
+        result_store_free(&ctx.previous);
+        return 1;
+    }
+
+    CURL *curl = http_client_handle(s->http);
+    if(!curl) {
+        s->error = "curl_easy_init failed";
+        result_store_free(&ctx.fetched);
+        result_store_free(&ctx.previous);
+        return 0;
+    }
+
+    CtStreamParser parser;
+    ct_stream_init(&parser, on_ct_name, &ctx);
+
+    char url[1024];
+    snprintf(url, sizeof(url), s->url ? s->url : CRTSH_URL, s->target->domain);
+
+    // No overall timeout: large answers stream for minutes; the client's
+    // low-speed limit still aborts a stalled transfer
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, ct_stream_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &parser);
+
+    if(s->bucket) token_bucket_wait(s->bucket);
+    if(s->phase) phase_request(s->phase);
+    double started = monotonic_ms();
+    CURLcode res = curl_easy_perform(curl);
+    int complete = ct_stream_finish(&parser);
+    if(s->phase) phase_done(s->phase, monotonic_ms() - started, res != CURLE_OK);
+    metrics_record(s->metrics, curl, res);
+    s->bytes = parser.bytes_fed;
+
+    // Bytes received before decompression, to show what the encoding saved
+    curl_off_t wire = 0;
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &wire);
+
+    int ok = res == CURLE_OK && complete;
+    if(ok) {
+        snprintf(s->note, sizeof(s->note), "%zu certificates, %.1f MB (%.1f MB transferred)%s",
+                 parser.entries, s->bytes / (1024.0 * 1024.0), wire / (1024.0 * 1024.0),
+                 parser.truncated_values ? ", some oversized fields dropped" : "");
+        // Only complete answers are cached; a cut-off transfer would hide names
+        if(s->cache_dir && !ct_cache_save(s->cache_dir, s->target->domain, &ctx.fetched, now)) {
+            snprintf(s->note, sizeof(s->note), "%zu certificates, could not write cache in %s",
+                     parser.entries, s->cache_dir);
+        }
+    } else if(parser.error) {
+        s->error = "malformed crt.sh response";
+    } else {
+        s->error = res != CURLE_OK ? curl_easy_strerror(res) : "response ended early";
+    }
+
+    ct_stream_free(&parser);
+    curl_easy_cleanup(curl);
+    result_store_free(&ctx.fetched);
+    result_store_free(&ctx.previous);
+    return ok;
+}
+
+// A crt.sh JSON answer saved to disk, parsed with the same streaming parser
+static int run_ct_file(PassiveSource *s, PassiveQueue *out) {
+    FILE *fp = fopen(s->path, "rb");
+    if(!fp) {
+        s->error = "cannot open file";
+        return 0;
+    }
+
+    CtContext ctx;
+    ctx.source = s;
+    ctx.out = out;
+    result_store_init(&ctx.fetched);
+    result_store_init(&ctx.previous);
+    CtStreamParser parser;
+    ct_stream_init(&parser, on_ct_name, &ctx);
+
+    char buf[65536];
+    size_t n;
+    int ok = 1;
+    while(ok && (n = fread(buf, 1, sizeof(buf), fp)) > 0) ok = ct_stream_feed(&parser, buf, n);
+    ok = ok && ct_stream_finish(&parser);
+    if(!ok) s->error = parser.error ? "malformed CT JSON" : "file ends mid-document";
+    else snprintf(s->note, sizeof(s->note), "%zu certificates", parser.entries);
+    s->bytes = parser.bytes_fed;
+
+    fclose(fp);
+    ct_stream_free(&parser);
+    result_store_free(&ctx.fetched);
+    result_store_free(&ctx.previous);
+    return ok;
+}
+
+// ========== PASSIVE DNS ==========
+static int run_dns_file(PassiveSource *s, PassiveQueue *out) {
+    ResultStore local;
+    IngestStats stats;
+    result_store_init(&local);
+
+    int ok = ingest_file(s->path, INGEST_TEXT, s->target, s->threads, &local, SOURCE_IMPORT, &stats, &s->error);
+    for(size_t i = 0; i < local.count; i++) {
+        emit(s, out, local.records[i].subdomain, local.records[i].name_len, SOURCE_IMPORT, NULL);
+    }
+    s->bytes = stats.bytes;
+
+    double mb = stats.bytes / (1024.0 * 1024.0);
+    snprintf(s->note, sizeof(s->note), "%.1f MB%s at %.0f MB/s, %zu in-scope hits",
+             mb, stats.gzip ? " gzip" : "", stats.seconds > 0 ? mb / stats.seconds : 0.0, stats.hits);
+    result_store_free(&local);
+    return ok;
+}
+
+// ========== CT LOG MIRROR ==========
+static int run_ct_log(PassiveSource *s, PassiveQueue *out) {
+    ResultStore local;
+    IngestStats stats;
+    result_store_init(&local);
+
+    int ok = ingest_file(s->path, INGEST_CT_LOG, s->target, s->threads, &local, SOURCE_CT, &stats, &s->error);
+    for(size_t i = 0; i < local.count; i++) {
+        emit(s, out, local.records[i].subdomain, local.records[i].name_len, SOURCE_CT, NULL);
+    }
+    s->bytes = stats.bytes;
+
+    const CtLogStats *ct = &stats.ct;
+    snprintf(s->note, sizeof(s->note), "%zu entries (%zu precerts, %zu malformed) at %.0fk/s, %.1f MB%s, %zu in-scope hits",
+             ct->entries, ct->precerts, ct->malformed, stats.seconds > 0 ? ct->entries / stats.seconds / 1000 : 0.0,
+             stats.bytes / (1024.0 * 1024.0), stats.gzip ? " gzip" : "", stats.hits);
+    result_store_free(&local);
+    return ok;
+}
+
+// ========== ZONE FILE ==========
+// Names without an $ORIGIN in force are taken to be relative to the target
+static int run_zone_file(PassiveSource *s, PassiveQueue *out) {
+    ResultStore local;
+    ZoneStats stats;
+    result_store_init(&local);
+
+    int ok = zone_file(s->path, s->target, s->target->domain, s->threads, &local, SOURCE_ZONE, &stats, &s->error);
+    for(size_t i = 0; i < local.count; i++) {
+        emit(s, out, local.records[i].subdomain, local.records[i].name_len, SOURCE_ZONE, NULL);
+    }
+    s->bytes = stats.bytes;
+
+    double mb = stats.bytes / (1024.0 * 1024.0);
+    snprintf(s->note, sizeof(s->note), "%.1f MB at %.0f MB/s, %zu records in %zu chunks, %zu in-scope hits",
+             mb, stats.seconds > 0 ? mb / stats.seconds : 0.0, stats.records, stats.chunks, stats.hits);
+    result_store_free(&local);
+    return ok;
+}
+
+// ========== NAME INDEX ==========
+typedef struct {
+    PassiveSource *source;
+    PassiveQueue *out;
+} IndexContext;
+
+static void on_indexed_name(const char *name, const NameIndexRecord *record, void *userdata) {
+    IndexContext *ctx = (IndexContext *)userdata;
+    (void)record;
+    emit(ctx->source, ctx->out, name, strlen(name), SOURCE_INDEX, NULL);
+}
+
+static int run_index(PassiveSource *s, PassiveQueue *out) {
+    NameIndex ix;
+    if(!name_index_open(&ix, s->path, &s->error)) return 0;
+
+    IndexContext ctx = { s, out };
+    name_index_query(&ix, s->target->domain, on_indexed_name, &ctx, &s->error);
+    snprintf(s->note, sizeof(s->note), "%zu names in the index", ix.count);
+    name_index_close(&ix);
+    return s->error == NULL;
+}
+
+// ========== SOURCE CONSTRUCTORS ==========
+static void source_init(PassiveSource *s, const char *name, const DomainMatcher *target,
+                        int (*run)(PassiveSource *, PassiveQueue *)) {
+    memset(s, 0, sizeof(*s));
+    s->name = name;
+    s->target = target;
+    s->run = run;
+}
+
+void passive_crtsh(PassiveSource *s, const DomainMatcher *target, const char *url,
+                   HttpClient *http, const char *cache_dir, long cache_ttl, int delta) {
+    source_init(s, "crt.sh", target, run_crtsh);
+    s->url = url;
+    s->http = http;
+    s->cache_dir = cache_dir;
+    s->cache_ttl = cache_ttl;
+    s->delta = delta;
+}
+
+void passive_ct_file(PassiveSource *s, const DomainMatcher *target, const char *path) {
+    source_init(s, "CT dump", target, run_ct_file);
+    s->path = path;
+}
+
+void passive_dns_file(PassiveSource *s, const DomainMatcher *target, const char *path, int threads) {
+    source_init(s, "passive DNS", target, run_dns_file);
+    s->path = path;
+    s->threads = threads;
+}
+
+void passive_ct_log(PassiveSource *s, const DomainMatcher *target, const char *path, int threads) {
+    source_init(s, "CT log", target, run_ct_log);
+    s->path = path;
+    s->threads = threads;
+}
+
+void passive_zone_file(PassiveSource *s, const DomainMatcher *target, const char *path, int threads) {
+    source_init(s, "zone file", target, run_zone_file);
+    s->path = path;
+    s->threads = threads;
+}
+
+void passive_index(PassiveSource *s, const DomainMatcher *target, const char *path) {
+    source_init(s, "name index", target, run_index);
+    s->path = path;
+}
+
+// ========== RUN ==========
+typedef struct {
+    PassiveSource *source;
+    PassiveQueue *queue;
+    int started;
+} SourceThread;
+
+static void *source_main(void *arg) {
+    SourceThread *t = (SourceThread *)arg;
+    double started = monotonic_ms();
+    t->source->ok = t->source->run(t->source, t->queue);
+    t->source->seconds = (monotonic_ms() - started) / 1000.0;
+
+    // Every push happens before this, so the consumer sees them all
+    atomic_fetch_sub_explicit(&t->queue->producers, 1, memory_order_release);
+    return NULL;
+}
+
+// Runs every source on its own thread and drains their names into `sink`
+int passive_run(PassiveSource *sources, int count, PassiveSink sink, void *userdata) {
+    PassiveQueue q;
+    memset(&q, 0, sizeof(q));
+    q.cells = malloc(PASSIVE_QUEUE_SLOTS * sizeof(PassiveCell));
+    SourceThread *threads = calloc(count > 0 ? count : 1, sizeof(SourceThread));
+    if(!q.cells || !threads) {
+        free(q.cells);
+        free(threads);
+        return 0;
+    }
+    for(size_t i = 0; i < PASSIVE_QUEUE_SLOTS; i++) atomic_init(&q.cells[i].seq, i);
+    atomic_init(&q.head, 0);
+    atomic_init(&q.producers, count);
+
+    for(int i = 0; i < count; i++) {
+        threads[i].source = &sources[i];
+        threads[i].queue = &q;
+        if(pthread_create(&sources[i].thread, NULL, source_main, &threads[i]) == 0) {
+            threads[i].started = 1;
+        } else {
+            sources[i].error = "could not start thread";
+            atomic_fetch_sub(&q.producers, 1);
+        }
+    }
+
+    PassiveName name;
+    int idle = 0;
+    for(;;) {
+        if(queue_pop(&q, &name)) {
+            sink(&name, userdata);
+            idle = 0;
+            continue;
+        }
+        // Re-check after the last producer left: its final pushes are visible now
+        if(atomic_load_explicit(&q.producers, memory_order_acquire) == 0) {
+            if(queue_pop(&q, &name)) {
+                sink(&name, userdata);
+                continue;
+            }
+            break;
+        }
+        if(++idle < 64) {
+            sched_yield();
+        } else {
+            struct timespec pause = { 0, 500000 };  // Sources are slow: don't spin
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    for(int i = 0; i < count; i++) {
+        if(threads[i].started) pthread_join(sources[i].thread, NULL);
+    }
+    free(threads);
+    free(q.cells);
+    return 1;
+}
@@ -0,0 +1,97 @@
+/*
+ * passive.h - Concurrent passive sources feeding one dedup stage
+ * Every source (crt.sh, CT dump files, mirrored CT log entries, passive-DNS
+ * files, zone files, the name index) runs on its own thread and pushes normalized
+ * in-scope names into a lock-free multi-producer queue; the calling thread drains it, so the
+ * phase takes as long as the slowest source instead of the sum of all.
+ */
+
+#ifndef PASSIVE_H
+#define PASSIVE_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <pthread.h>
+#include "result_store.h"
+#include "domain_match.h"
+#include "rate.h"
+#include "http_client.h"
+#include "metrics.h"
+
+// ========== CONFIGURATION ==========
+#define PASSIVE_QUEUE_SLOTS 4096    // Power of two
+#define PASSIVE_MAX_FILES   64      // Per kind of local source: CT files, CT logs, dumps, zones
+#define PASSIVE_MAX_SOURCES (4 * PASSIVE_MAX_FILES + 2)  // ...plus crt.sh and the name index
+#define PASSIVE_DATE_LEN    11      // "YYYY-MM-DD"
+#define CRTSH_URL           "https://crt.sh/?q=%s&output=json"
+
+// ========== STRUCTURES ==========
+typedef struct {
+    char name[MAX_NAME_LEN + 1];
+    uint8_t sources;                // SOURCE_* bits this observation carries
+    char not_before[PASSIVE_DATE_LEN];  // Certificate validity, "" if unknown
+    char not_after[PASSIVE_DATE_LEN];
+    uint8_t known;                  // Delta mode: in the last crt.sh snapshot, stored but not reported
+} PassiveName;
+
+typedef struct {
+    _Atomic size_t seq;
+    PassiveName item;
+} PassiveCell;
+
+// Bounded Vyukov-style queue: producers claim cells with a CAS on `head`,
+// the single consumer owns `tail`
+typedef struct {
+    PassiveCell *cells;
+    _Atomic size_t head;
+    size_t tail;
+    _Atomic int producers;          // Sources still running
+} PassiveQueue;
+
+typedef struct PassiveSource PassiveSource;
+
+struct PassiveSource {
+    const char *name;               // For progress output, e.g. "crt.sh"
+    int (*run)(PassiveSource *self, PassiveQueue *out);
+    const DomainMatcher *target;
+
+    // Source configuration (only the fields a source uses are set)
+    const char *path;               // Dump file or index file
+    int threads;                    // Passive-DNS / CT log ingest threads
+    const char *url;                // crt.sh URL template with one %s
+    HttpClient *http;               // A client without a proxy reaches local stand-ins
+    const char *cache_dir;          // crt.sh snapshot directory, NULL = none
+    long cache_ttl;
+    int delta;                      // Mark names in the previous snapshot as known
+    TokenBucket *bucket;            // Request pacing, NULL = none
+    PhaseStats *phase;
+    PhaseMetrics *metrics;          // Request timing breakdown, NULL = none
+
+    // Results, read by the caller after the phase
+    pthread_t thread;
+    int ok;
+    const char *error;
+    size_t names;                   // Names pushed to be reported
+    size_t known;                   // Delta mode: names pushed as known
+    size_t bytes;
+    double seconds;
+    char note[160];                 // One line of source-specific detail
+};
+
+// Called on the draining thread for every queued name
+typedef void (*PassiveSink)(const PassiveName *name, void *userdata);
+
+// ========== FUNCTION PROTOTYPES ==========
+void passive_crtsh(PassiveSource *s, const DomainMatcher *target, const char *url,
+                   HttpClient *http, const char *cache_dir, long cache_ttl, int delta);
+void passive_ct_file(PassiveSource *s, const DomainMatcher *target, const char *path);
+void passive_dns_file(PassiveSource *s, const DomainMatcher *target, const char *path, int threads);
+void passive_ct_log(PassiveSource *s, const DomainMatcher *target, const char *path, int threads);
+void passive_zone_file(PassiveSource *s, const DomainMatcher *target, const char *path, int threads);
+void passive_index(PassiveSource *s, const DomainMatcher *target, const char *path);
+
+int passive_push(PassiveQueue *q, const PassiveName *name);
+int passive_run(PassiveSource *sources, int count, PassiveSink sink, void *userdata);
+
+#endif
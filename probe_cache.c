@@ -0,0 +1,198 @@
+/*
+ * probe_cache.c - Cross-run cache of wordlist probe outcomes
+ * File layout: "SSPC" u32 version, u64 count, then count ProbeCacheEntry
+ * records in host byte order. Expired entries are dropped on load and
+ * on save; names are only kept as 64-bit hashes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "probe_cache.h"
+#include "ct_cache.h"
+#include "result_store.h"
+#include "hash.h"
+
+#define PROBE_CACHE_SUFFIX ".probes"
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+} ProbeCacheHeader;
+
+// ========== KEYS ==========
+static uint64_t name_hash(const char *name) {
+    char key[MAX_NAME_LEN + 1];
+    size_t len = normalize_name(key, sizeof(key), name, strlen(name));
+    if(len == 0) return 0;
+    uint64_t h = hash_bytes(key, len);
+    return h ? h : 1;
+}
+
+// ========== BLOOM FILTER ==========
+// Double hashing: probe i tests bit (h1 + i * h2)
+static void bloom_add(ProbeCache *c, uint64_t h) {
+    uint64_t h1 = h, h2 = (h >> 32) | 1;
+    for(int i = 0; i < PROBE_CACHE_BLOOM_HASHES; i++) {
+        size_t bit = (size_t)((h1 + i * h2) & c->bloom_mask);
+        c->bloom[bit / 64] |= 1ULL << (bit % 64);
+    }
+}
+
+static int bloom_maybe(const ProbeCache *c, uint64_t h) {
+    uint64_t h1 = h, h2 = (h >> 32) | 1;
+    for(int i = 0; i < PROBE_CACHE_BLOOM_HASHES; i++) {
+        size_t bit = (size_t)((h1 + i * h2) & c->bloom_mask);
+        if(!(c->bloom[bit / 64] & (1ULL << (bit % 64)))) return 0;
+    }
+    return 1;
+}
+
+// ========== TABLE ==========
+static ProbeCacheEntry *lookup(const ProbeCache *c, uint64_t h) {
+    // The low bits feed the Bloom filter, so probe the table with the high ones
+    size_t i = (size_t)(h >> 24) & c->slot_mask;
+    while(c->slots[i].hash && c->slots[i].hash != h) i = (i + 1) & c->slot_mask;
+    return &c->slots[i];
+}
+
+static int grow(ProbeCache *c) {
+    size_t size = c->slots ? (c->slot_mask + 1) * 2 : 1024;
+    ProbeCacheEntry *old = c->slots;
+    size_t old_size = old ? c->slot_mask + 1 : 0;
+
+    c->slots = calloc(size, sizeof(ProbeCacheEntry));
+    if(!c->slots) {
+        c->slots = old;
+        return 0;
+    }
+    c->slot_mask = size - 1;
+    for(size_t i = 0; i < old_size; i++) {
+        if(old[i].hash) *lookup(c, old[i].hash) = old[i];
+    }
+    free(old);
+    return 1;
+}
+
+static int insert(ProbeCache *c, const ProbeCacheEntry *e) {
+    // Keep the table at most half full
+    if(!c->slots || (c->count + 1) * 2 > c->slot_mask + 1) {
+        if(!grow(c)) return 0;
+    }
+    ProbeCacheEntry *slot = lookup(c, e->hash);
+    if(!slot->hash) c->count++;
+    *slot = *e;
+    bloom_add(c, e->hash);
+    return 1;
+}
+
+// ========== LOAD ==========
+// Sizes the filter for the stored entries plus `expected` new ones; a
+// missing or unreadable file just starts an empty cache
+int probe_cache_load(ProbeCache *c, const char *dir, const char *domain, size_t expected, time_t now) {
+    memset(c, 0, sizeof(*c));
+
+    char path[4096];
+    ProbeCacheHeader h;
+    FILE *fp = NULL;
+    if(dir) {
+        cache_path(path, sizeof(path), dir, domain, PROBE_CACHE_SUFFIX);
+        fp = fopen(path, "rb");
+    }
+    if(fp && (fread(&h, sizeof(h), 1, fp) != 1 || memcmp(h.magic, PROBE_CACHE_MAGIC, 4) != 0 ||
+              h.version != PROBE_CACHE_VERSION || h.count > PROBE_CACHE_MAX_ENTRIES)) {
+        fclose(fp);
+        fp = NULL;
+    }
+
+    size_t bits = 1 << 16;
+    size_t want = ((fp ? (size_t)h.count : 0) + expected) * PROBE_CACHE_BLOOM_BITS;
+    while(bits < want) bits *= 2;
+    c->bloom = calloc(bits / 64, sizeof(uint64_t));
+    c->bloom_mask = bits - 1;
+    if(!c->bloom || !grow(c)) {
+        if(fp) fclose(fp);
+        probe_cache_free(c);
+        return 0;
+    }
+    if(!fp) return 1;
+
+    ProbeCacheEntry e;
+    for(uint64_t i = 0; i < h.count && fread(&e, sizeof(e), 1, fp) == 1; i++) {
+        if(!e.hash || (time_t)e.expires <= now) continue;
+        if(!insert(c, &e)) break;
+        c->loaded++;
+    }
+    fclose(fp);
+    return 1;
+}
+
+// ========== GET / PUT ==========
+// Returns the unexpired outcome for name, or NULL if it must be probed
+const ProbeCacheEntry *probe_cache_get(ProbeCache *c, const char *name, time_t now) {
+    if(!c->slots) return NULL;
+    uint64_t h = name_hash(name);
+    if(!h) return NULL;
+    if(!bloom_maybe(c, h)) {
+        c->bloom_skips++;
+        return NULL;
+    }
+
+    const ProbeCacheEntry *e = lookup(c, h);
+    if(!e->hash || (time_t)e->expires <= now) return NULL;
+    c->hits++;
+    return e;
+}
+
+void probe_cache_put(ProbeCache *c, const char *name, int found, int http_status, time_t expires) {
+    if(!c->slots) return;
+    ProbeCacheEntry e;
+    memset(&e, 0, sizeof(e));
+    e.hash = name_hash(name);
+    if(!e.hash) return;
+    e.expires = expires > 0xffffffffL ? 0xffffffffu : (uint32_t)expires;
+    e.http_status = (uint16_t)http_status;
+    e.found = found ? 1 : 0;
+    insert(c, &e);
+}
+
+// ========== SAVE ==========
+int probe_cache_save(const ProbeCache *c, const char *dir, const char *domain, time_t now) {
+    if(!c->slots || !dir) return 0;
+    if(mkdir(dir, 0700) != 0 && errno != EEXIST) return 0;
+
+    char path[4096], tmp[4200];
+    cache_path(path, sizeof(path), dir, domain, PROBE_CACHE_SUFFIX);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp, "wb");
+    if(!fp) return 0;
+
+    ProbeCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PROBE_CACHE_MAGIC, 4);
+    h.version = PROBE_CACHE_VERSION;
+    for(size_t i = 0; i <= c->slot_mask; i++) {
+        if(c->slots[i].hash && (time_t)c->slots[i].expires > now) h.count++;
+    }
+
+    int ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+    for(size_t i = 0; ok && i <= c->slot_mask; i++) {
+        const ProbeCacheEntry *e = &c->slots[i];
+        if(e->hash && (time_t)e->expires > now) ok = fwrite(e, sizeof(*e), 1, fp) == 1;
+    }
+    ok = (fclose(fp) == 0) && ok;
+    ok = ok && rename(tmp, path) == 0;
+    if(!ok) unlink(tmp);
+    return ok;
+}
+
+void probe_cache_free(ProbeCache *c) {
+    free(c->slots);
+    free(c->bloom);
+    memset(c, 0, sizeof(*c));
+}
@@ -0,0 +1,51 @@
+/*
+ * probe_cache.h - Cross-run cache of wordlist probe outcomes
+ * Live and dead answers are kept per name with their own expiry, so a
+ * repeat scan of the same domain only spends rate-limited requests on
+ * names whose outcome is unknown or stale. A Bloom filter in front of
+ * the table turns the common "never probed" case into a few bit tests.
+ */
+
+#ifndef PROBE_CACHE_H
+#define PROBE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// ========== CONFIGURATION ==========
+#define PROBE_CACHE_MAGIC       "SSPC"
+#define PROBE_CACHE_VERSION     1
+#define PROBE_CACHE_BLOOM_BITS  10   // Per expected entry (about 1% false positives)
+#define PROBE_CACHE_BLOOM_HASHES 6
+#define PROBE_CACHE_MAX_ENTRIES (1 << 26)  // Larger counts mean a corrupt file
+
+// ========== STRUCTURES ==========
+// In-memory slot and on-disk record alike
+typedef struct {
+    uint64_t hash;          // hash_bytes() of the normalized name, 0 = empty slot
+    uint32_t expires;       // Unix time
+    uint16_t http_status;
+    uint8_t found;
+    uint8_t reserved;
+} ProbeCacheEntry;
+
+typedef struct {
+    ProbeCacheEntry *slots;
+    size_t slot_mask;       // Table size - 1 (power of two)
+    size_t count;
+    uint64_t *bloom;
+    size_t bloom_mask;      // Filter size in bits - 1 (power of two)
+    size_t loaded;          // Unexpired entries read from disk
+    size_t hits;            // Lookups answered from the cache
+    size_t bloom_skips;     // Misses settled by the filter alone
+} ProbeCache;
+
+// ========== FUNCTION PROTOTYPES ==========
+int probe_cache_load(ProbeCache *c, const char *dir, const char *domain, size_t expected, time_t now);
+const ProbeCacheEntry *probe_cache_get(ProbeCache *c, const char *name, time_t now);
+void probe_cache_put(ProbeCache *c, const char *name, int found, int http_status, time_t expires);
+int probe_cache_save(const ProbeCache *c, const char *dir, const char *domain, time_t now);
+void probe_cache_free(ProbeCache *c);
+
+#endif
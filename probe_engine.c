@@ -0,0 +1,161 @@
+/*
+ * probe_engine.c - Concurrent HTTPS probes on the curl multi interface
+ * One easy handle per slot is configured once and reused, so connection
+ * setup options are not rebuilt for every candidate.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "probe_engine.h"
+#include "result_store.h"
+
+typedef struct {
+    CURL *easy;
+    size_t index;
+    int busy;
+    double started_ms;
+    char host[MAX_NAME_LEN + 1];
+    char url[MAX_NAME_LEN + 16];
+} ProbeSlot;
+
+// ========== SLOTS ==========
+static CURL *make_handle(const ProbeConfig *cfg, ProbeSlot *slot) {
+    CURL *curl = http_client_handle(cfg->http);
+    if(!curl) return NULL;
+
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, cfg->timeout_sec);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);  // HEAD request
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, slot);
+    if(cfg->certinfo) curl_easy_setopt(curl, CURLOPT_CERTINFO, 1L);
+    return curl;
+}
+
+// Points the result at the leaf certificate's SAN and Subject entries
+static void leaf_names(CURL *easy, ProbeResult *result) {
+    struct curl_certinfo *chain = NULL;
+    if(curl_easy_getinfo(easy, CURLINFO_CERTINFO, &chain) != CURLE_OK || !chain || chain->num_of_certs < 1) return;
+
+    for(struct curl_slist *field = chain->certinfo[0]; field; field = field->next) {
+        if(strncmp(field->data, "X509v3 Subject Alternative Name:", 32) == 0) {
+            result->cert_san = field->data + 32;
+        } else if(strncmp(field->data, "Subject:", 8) == 0) {
+            result->cert_subject = field->data + 8;
+        }
+    }
+}
+
+static void finish_slot(const ProbeConfig *cfg, ProbeSlot *slot, CURLcode code, PhaseStats *phase,
+                        ProbeCallback on_result, void *userdata) {
+    ProbeResult result;
+    memset(&result, 0, sizeof(result));
+    result.code = code;
+    result.latency_ms = monotonic_ms() - slot->started_ms;
+    result.content_length = -1;
+    if(code == CURLE_OK) {
+        char *location = NULL;
+        curl_easy_getinfo(slot->easy, CURLINFO_RESPONSE_CODE, &result.http_status);
+        curl_easy_getinfo(slot->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &result.content_length);
+        curl_easy_getinfo(slot->easy, CURLINFO_REDIRECT_URL, &location);
+        if(location) snprintf(result.redirect, sizeof(result.redirect), "%s", location);
+        if(cfg->certinfo) leaf_names(slot->easy, &result);
+    }
+
+    slot->busy = 0;
+    phase_done(phase, result.latency_ms, code != CURLE_OK);
+    metrics_record(cfg->metrics, slot->easy, code);
+    if(cfg->deadline) deadline_observe(cfg->deadline, slot->easy, code);
+    on_result(slot->index, slot->host, &result, userdata);
+}
+
+// ========== RUN ==========
+int probe_run(const ProbeConfig *cfg, TokenBucket *bucket, PhaseStats *phase, size_t count,
+              ProbeHostFn get_host, ProbeCallback on_result, void *userdata) {
+    int parallel = cfg->max_parallel > 0 ? cfg->max_parallel : PROBE_DEFAULT_PARALLEL;
+    if(parallel > PROBE_MAX_PARALLEL) parallel = PROBE_MAX_PARALLEL;
+    if((size_t)parallel > count) parallel = count ? (int)count : 1;
+
+    CURLM *multi = curl_multi_init();
+    ProbeSlot *slots = calloc(parallel, sizeof(ProbeSlot));
+    if(!multi || !slots) {
+        if(multi) curl_multi_cleanup(multi);
+        free(slots);
+        return 0;
+    }
+
+    int ok = 1;
+    for(int i = 0; i < parallel; i++) {
+        slots[i].easy = make_handle(cfg, &slots[i]);
+        if(!slots[i].easy) ok = 0;
+    }
+
+    size_t next = 0;
+    int active = 0;
+    ProbeSlot *waiting = NULL;  // Has its host but lost the token to another bucket user
+    while(ok && (next < count || waiting || active > 0) && !(cfg->stop && *cfg->stop)) {
+        // Start as many transfers as the bucket and the free slots allow
+        while((next < count || waiting) && active < parallel && token_bucket_delay_ms(bucket) <= 0) {
+            ProbeSlot *slot = waiting;
+            if(!slot) {
+                for(int i = 0; i < parallel; i++) {
+                    if(!slots[i].busy) {
+                        slot = &slots[i];
+                        break;
+                    }
+                }
+
+                size_t index = next++;
+                if(!get_host(&index, slot->host, sizeof(slot->host), userdata)) continue;
+                snprintf(slot->url, sizeof(slot->url), "https://%s", slot->host);
+                slot->index = index;
+            }
+
+            waiting = token_bucket_take(bucket) ? NULL : slot;
+            if(waiting) break;
+            slot->busy = 1;
+            slot->started_ms = monotonic_ms();
+            curl_easy_setopt(slot->easy, CURLOPT_URL, slot->url);
+            if(cfg->deadline) {
+                curl_easy_setopt(slot->easy, CURLOPT_CONNECTTIMEOUT_MS, deadline_connect_ms(cfg->deadline));
+                curl_easy_setopt(slot->easy, CURLOPT_TIMEOUT_MS, deadline_response_ms(cfg->deadline));
+            }
+            curl_multi_add_handle(multi, slot->easy);
+            phase_request(phase);
+            active++;
+        }
+        if(next >= count && !waiting && active == 0) break;
+
+        // Sleep until a transfer needs attention or the next token is due
+        int wait_ms = 1000;
+        if((next < count || waiting) && active < parallel) {
+            double delay = token_bucket_delay_ms(bucket);
+            if(delay < wait_ms) wait_ms = (int)delay + 1;
+        }
+        curl_multi_poll(multi, NULL, 0, wait_ms, NULL);
+
+        int running;
+        curl_multi_perform(multi, &running);
+
+        CURLMsg *msg;
+        int pending;
+        while((msg = curl_multi_info_read(multi, &pending))) {
+            if(msg->msg != CURLMSG_DONE) continue;
+            CURL *easy = msg->easy_handle;
+            CURLcode code = msg->data.result;
+            ProbeSlot *slot = NULL;
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char **)&slot);
+            curl_multi_remove_handle(multi, easy);
+            active--;
+            finish_slot(cfg, slot, code, phase, on_result, userdata);
+        }
+    }
+
+    for(int i = 0; i < parallel; i++) {
+        if(!slots[i].easy) continue;
+        if(slots[i].busy) curl_multi_remove_handle(multi, slots[i].easy);
+        curl_easy_cleanup(slots[i].easy);
+    }
+    free(slots);
+    curl_multi_cleanup(multi);
+    return ok;
+}
@@ -0,0 +1,56 @@
+/*
+ * probe_engine.h - Concurrent HTTPS probes on the curl multi interface
+ * Requests start whenever the token bucket allows and a transfer slot is
+ * free, so a slow host only occupies its own slot while the rest of the
+ * wordlist keeps moving at the configured rate.
+ */
+
+#ifndef PROBE_ENGINE_H
+#define PROBE_ENGINE_H
+
+#include <stddef.h>
+#include <signal.h>
+#include <curl/curl.h>
+#include "rate.h"
+#include "http_client.h"
+#include "metrics.h"
+#include "deadline.h"
+
+// ========== CONFIGURATION ==========
+#define PROBE_DEFAULT_PARALLEL 8     // Transfers in flight
+#define PROBE_MAX_PARALLEL     256
+
+// ========== STRUCTURES ==========
+typedef struct {
+    HttpClient *http;       // Shared context: proxy, user agent, caches
+    long timeout_sec;       // Wall-clock cap per probe (HEAD answers are small)
+    AdaptiveDeadline *deadline;  // Replaces timeout_sec per request when set
+    int max_parallel;
+    volatile sig_atomic_t *stop;  // When set, in-flight probes are abandoned
+    PhaseMetrics *metrics;  // Timing breakdown per probe, NULL = none
+    int certinfo;           // Keep the peer certificate's names for on_result
+} ProbeConfig;
+
+typedef struct {
+    CURLcode code;          // CURLE_OK if an HTTP response arrived
+    long http_status;
+    double latency_ms;
+    curl_off_t content_length;  // -1 when the response did not say
+    char redirect[512];     // Location target, empty if none
+    // Leaf certificate fields as curl prints them, e.g. "DNS:a.example.com, DNS:b..."
+    // and "CN = a.example.com"; NULL unless certinfo is set and a new TLS session
+    // was negotiated. Only valid during the callback.
+    const char *cert_san;
+    const char *cert_subject;
+} ProbeResult;
+
+// Fills `buf` with the host for sequence number `*index` and returns it (or NULL
+// to skip it); may replace `*index` with its own id, which on_result receives
+typedef const char *(*ProbeHostFn)(size_t *index, char *buf, size_t cap, void *userdata);
+typedef void (*ProbeCallback)(size_t index, const char *host, const ProbeResult *result, void *userdata);
+
+// ========== FUNCTION PROTOTYPES ==========
+int probe_run(const ProbeConfig *cfg, TokenBucket *bucket, PhaseStats *phase, size_t count,
+              ProbeHostFn get_host, ProbeCallback on_result, void *userdata);
+
+#endif
@@ -0,0 +1,200 @@
+/*
+ * rank.c - Wordlist prioritization from observed label statistics
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rank.h"
+#include "hash.h"
+
+// ========== COUNT TABLES ==========
+static uint64_t key_hash(const char *s, size_t len) {
+    return hash_bytes(s, len) | 1;  // 0 is the empty marker
+}
+
+static RankCount *table_slot(const RankTable *t, uint64_t h) {
+    size_t i = (size_t)h & t->mask;
+    while(t->slots[i].hash && t->slots[i].hash != h) i = (i + 1) & t->mask;
+    return &t->slots[i];
+}
+
+static int table_grow(RankTable *t) {
+    size_t size = t->slots ? (t->mask + 1) * 2 : 1024;
+    RankCount *slots = calloc(size, sizeof(RankCount));
+    if(!slots) return 0;
+
+    RankTable bigger = { slots, size - 1, t->used };
+    for(size_t i = 0; t->slots && i <= t->mask; i++) {
+        if(t->slots[i].hash) *table_slot(&bigger, t->slots[i].hash) = t->slots[i];
+    }
+    free(t->slots);
+    *t = bigger;
+    return 1;
+}
+
+static void table_add(RankTable *t, const char *s, size_t len, float weight) {
+    if(!t->slots || (t->used + 1) * 2 > t->mask + 1) {
+        if(!table_grow(t)) return;
+    }
+    uint64_t h = key_hash(s, len);
+    RankCount *c = table_slot(t, h);
+    if(!c->hash) {
+        c->hash = h;
+        t->used++;
+    }
+    c->weight += weight;
+}
+
+static float table_get(const RankTable *t, const char *s, size_t len) {
+    if(!t->slots) return 0;
+    const RankCount *c = table_slot(t, key_hash(s, len));
+    return c->hash ? c->weight : 0;
+}
+
+// ========== TOKENS ==========
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Splits a label at '-', '_' and letter/digit boundaries; returns the token count
+static int split_tokens(const char *label, size_t len, size_t starts[], size_t lens[]) {
+    int n = 0;
+    size_t i = 0;
+    while(i < len && n < RANK_MAX_TOKENS) {
+        while(i < len && (label[i] == '-' || label[i] == '_')) i++;
+        if(i >= len) break;
+        size_t start = i;
+        int digits = is_digit(label[i]);
+        while(i < len && label[i] != '-' && label[i] != '_' && is_digit(label[i]) == digits) i++;
+        starts[n] = start;
+        lens[n] = i - start;
+        n++;
+    }
+    return n;
+}
+
+// ========== LEARNING ==========
+// `labels` is the part of a name left of the registered domain, e.g. "api-eu.staging"
+void ranker_learn(Ranker *r, const char *labels, size_t len, float weight) {
+    size_t pos = 0;
+    while(pos < len) {
+        const char *dot = memchr(labels + pos, '.', len - pos);
+        size_t end = dot ? (size_t)(dot - labels) : len;
+        const char *label = labels + pos;
+        size_t label_len = end - pos;
+
+        if(label_len > 0) {
+            size_t starts[RANK_MAX_TOKENS], lens[RANK_MAX_TOKENS];
+            int n = split_tokens(label, label_len, starts, lens);
+            table_add(&r->labels, label, label_len, weight);
+            for(int i = 0; i < n; i++) table_add(&r->tokens, label + starts[i], lens[i], weight);
+            r->learned++;
+        }
+        pos = end + 1;
+    }
+}
+
+// Diminishing returns without libm: 1 -> 0.2, 4 -> 0.5, 36 -> 0.9
+static float damp(float weight) {
+    return weight / (weight + 4.0f);
+}
+
+// An exact label match counts double; shared tokens rank related words next
+static float score_word(const Ranker *r, const char *word, size_t len) {
+    float score = 0;
+    size_t pos = 0;
+    while(pos < len) {
+        const char *dot = memchr(word + pos, '.', len - pos);
+        size_t end = dot ? (size_t)(dot - word) : len;
+        const char *label = word + pos;
+        size_t label_len = end - pos;
+
+        score += 2.0f * damp(table_get(&r->labels, label, label_len));
+        size_t starts[RANK_MAX_TOKENS], lens[RANK_MAX_TOKENS];
+        int n = split_tokens(label, label_len, starts, lens);
+        if(n > 0) {
+            float tokens = 0;
+            for(int i = 0; i < n; i++) tokens += damp(table_get(&r->tokens, label + starts[i], lens[i]));
+            score += tokens / n;
+        }
+        pos = end + 1;
+    }
+    return score;
+}
+
+// ========== HEAP ==========
+// Higher score first; equal scores keep file order
+static int entry_before(const RankEntry *a, const RankEntry *b) {
+    return a->score > b->score || (a->score == b->score && a->index < b->index);
+}
+
+static void sift_down(RankEntry *heap, size_t len, size_t i) {
+    for(;;) {
+        size_t best = i, l = 2 * i + 1, rgt = l + 1;
+        if(l < len && entry_before(&heap[l], &heap[best])) best = l;
+        if(rgt < len && entry_before(&heap[rgt], &heap[best])) best = rgt;
+        if(best == i) return;
+        RankEntry tmp = heap[i];
+        heap[i] = heap[best];
+        heap[best] = tmp;
+        i = best;
+    }
+}
+
+// ========== BUILD / ITERATE ==========
+void ranker_init(Ranker *r) {
+    memset(r, 0, sizeof(*r));
+}
+
+int ranker_build(Ranker *r, const Wordlist *wl) {
+    r->words = wl->count;
+    r->emitted = calloc(r->words / 8 + 1, 1);
+    if(!r->emitted) return 0;
+    if(r->learned == 0) return 1;  // Nothing learned: plain file order
+
+    size_t cap = 0;
+    char buf[WORDLIST_MAX_WORD_LEN + 1];
+    for(size_t i = 0; i < wl->count; i++) {
+        size_t len;
+        const char *word = wordlist_word(wl, i, buf, &len);
+        float score = score_word(r, word, len);
+        if(score <= 0) continue;
+
+        if(r->heap_len == cap) {
+            cap = cap ? cap * 2 : 1024;
+            RankEntry *heap = realloc(r->heap, cap * sizeof(RankEntry));
+            if(!heap) return 0;
+            r->heap = heap;
+        }
+        r->heap[r->heap_len].score = score;
+        r->heap[r->heap_len].index = (uint32_t)i;
+        r->heap_len++;
+    }
+    r->scored = r->heap_len;
+
+    for(size_t i = r->heap_len / 2; i-- > 0;) sift_down(r->heap, r->heap_len, i);
+    return 1;
+}
+
+// Next word index to probe; returns 0 once every word was handed out
+int ranker_next(Ranker *r, size_t *index) {
+    if(r->heap_len > 0) {
+        *index = r->heap[0].index;
+        r->heap[0] = r->heap[--r->heap_len];
+        sift_down(r->heap, r->heap_len, 0);
+        r->emitted[*index / 8] |= (unsigned char)(1 << (*index % 8));
+        return 1;
+    }
+    while(r->cursor < r->words && (r->emitted[r->cursor / 8] & (1 << (r->cursor % 8)))) r->cursor++;
+    if(r->cursor >= r->words) return 0;
+    *index = r->cursor++;
+    return 1;
+}
+
+void ranker_free(Ranker *r) {
+    free(r->labels.slots);
+    free(r->tokens.slots);
+    free(r->heap);
+    free(r->emitted);
+    memset(r, 0, sizeof(*r));
+}
@@ -0,0 +1,59 @@
+/*
+ * rank.h - Wordlist prioritization from observed label statistics
+ * Labels and their tokens ("api-eu" -> api, eu; "staging2" -> staging, 2)
+ * are counted from names already known for the target and from a prior
+ * corpus. Words that score are handed out best first from a heap; the
+ * rest follow in file order, so no reordered copy of the list is built.
+ */
+
+#ifndef RANK_H
+#define RANK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "wordlist.h"
+
+// ========== CONFIGURATION ==========
+#define RANK_WEIGHT_TARGET 1.0f    // Names seen for the scanned domain
+#define RANK_WEIGHT_PRIOR  0.25f   // Names from the prior corpus
+#define RANK_MAX_TOKENS    16
+
+// ========== STRUCTURES ==========
+typedef struct {
+    uint64_t hash;          // 0 marks an empty slot
+    float weight;
+} RankCount;
+
+typedef struct {
+    float score;
+    uint32_t index;
+} RankEntry;
+
+typedef struct {
+    RankCount *slots;
+    size_t mask;            // Table size - 1 (power of two)
+    size_t used;
+} RankTable;
+
+typedef struct {
+    RankTable labels;       // Whole labels
+    RankTable tokens;       // Pieces of labels
+
+    RankEntry *heap;        // Scored words, best on top
+    size_t heap_len;
+    unsigned char *emitted; // Bit per word already handed out from the heap
+    size_t words;
+    size_t cursor;          // File-order position for unscored words
+
+    size_t learned;         // Labels fed to ranker_learn()
+    size_t scored;          // Words with a positive score
+} Ranker;
+
+// ========== FUNCTION PROTOTYPES ==========
+void ranker_init(Ranker *r);
+void ranker_learn(Ranker *r, const char *labels, size_t len, float weight);
+int ranker_build(Ranker *r, const Wordlist *wl);
+int ranker_next(Ranker *r, size_t *index);
+void ranker_free(Ranker *r);
+
+#endif
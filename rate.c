@@ -0,0 +1,128 @@
+/*
+ * rate.c - Request pacing and per-phase rate statistics
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "rate.h"
+
+double monotonic_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// ========== TOKEN BUCKET ==========
+// Spacing is 60000/per_minute ms but never below min_delay_ms; each take
+// adds up to 25% random jitter (bounded by max_delay_ms), which only ever
+// slows requests down, so per_minute stays a hard ceiling.
+void token_bucket_init(TokenBucket *tb, int per_minute, int min_delay_ms, int max_delay_ms) {
+    double interval = per_minute > 0 ? 60000.0 / per_minute : 0;
+    if(interval < min_delay_ms) interval = min_delay_ms;
+
+    double jitter = interval * 0.25;
+    if(max_delay_ms > 0 && interval + jitter > max_delay_ms) jitter = max_delay_ms - interval;
+    if(jitter < 0) jitter = 0;
+
+    memset(tb, 0, sizeof(*tb));
+    tb->capacity = 1;
+    tb->tokens = 1;          // First request may go immediately
+    tb->per_ms = interval > 0 ? 1.0 / interval : 1e9;
+    tb->last_ms = monotonic_ms();
+    tb->jitter_ms = jitter;
+    pthread_mutex_init(&tb->lock, NULL);
+}
+
+void token_bucket_free(TokenBucket *tb) {
+    pthread_mutex_destroy(&tb->lock);
+}
+
+static void refill(TokenBucket *tb, double now) {
+    if(now > tb->last_ms) {
+        tb->tokens += (now - tb->last_ms) * tb->per_ms;
+        if(tb->tokens > tb->capacity) tb->tokens = tb->capacity;
+        tb->last_ms = now;
+    }
+}
+
+static double delay_locked(TokenBucket *tb) {
+    double now = monotonic_ms();
+    refill(tb, now);
+
+    double wait = tb->tokens >= 1 ? 0 : (1 - tb->tokens) / tb->per_ms;
+    if(tb->hold_until_ms > now + wait) wait = tb->hold_until_ms - now;
+    return wait;
+}
+
+// Milliseconds until a request may start (0 = now)
+double token_bucket_delay_ms(TokenBucket *tb) {
+    pthread_mutex_lock(&tb->lock);
+    double wait = delay_locked(tb);
+    pthread_mutex_unlock(&tb->lock);
+    return wait;
+}
+
+// Takes a token if one is available; returns 1 on success. Another thread
+// can take the token between a zero delay and this call, so check the result
+int token_bucket_take(TokenBucket *tb) {
+    pthread_mutex_lock(&tb->lock);
+    int ok = delay_locked(tb) <= 0;
+    if(ok) {
+        tb->tokens -= 1;
+        if(tb->jitter_ms > 0) {
+            // Push the next token back by a random amount past its refill time
+            tb->hold_until_ms = tb->last_ms + (1 - tb->tokens) / tb->per_ms +
+                                tb->jitter_ms * (rand() / (RAND_MAX + 1.0));
+        }
+    }
+    pthread_mutex_unlock(&tb->lock);
+    return ok;
+}
+
+void token_bucket_wait(TokenBucket *tb) {
+    while(!token_bucket_take(tb)) {
+        double wait = token_bucket_delay_ms(tb);
+        usleep((useconds_t)(wait * 1000) + 1);
+    }
+}
+
+// ========== PHASE STATISTICS ==========
+void phase_init(PhaseStats *p, const char *name) {
+    memset(p, 0, sizeof(*p));
+    p->name = name;
+}
+
+void phase_request(PhaseStats *p) {
+    p->last_start_ms = monotonic_ms();
+    if(p->requests == 0) p->first_start_ms = p->last_start_ms;
+    p->requests++;
+}
+
+void phase_done(PhaseStats *p, double latency_ms, int error) {
+    p->completed++;
+    p->latency_ms += latency_ms;
+    if(error) p->errors++;
+    p->last_done_ms = monotonic_ms();
+}
+
+void phase_hit(PhaseStats *p) {
+    if(p->hits++ == 0) {
+        p->first_hit_ms = monotonic_ms();
+        p->requests_at_first_hit = p->requests;
+    }
+}
+
+double phase_elapsed_sec(const PhaseStats *p) {
+    if(p->requests == 0) return 0;
+    double end = p->last_done_ms > p->first_start_ms ? p->last_done_ms : monotonic_ms();
+    return (end - p->first_start_ms) / 1000.0;
+}
+
+// Start rate over the intervals between request starts: this is the
+// number the token bucket bounds, independent of how long responses take
+double phase_rate_per_min(const PhaseStats *p) {
+    double span = p->last_start_ms - p->first_start_ms;
+    return p->requests > 1 && span > 0 ? (p->requests - 1) * 60000.0 / span : 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * rate.h - Request pacing and per-phase rate statistics
+ * A token bucket on the monotonic clock decides when the next request
+ * may start; waiting overlaps with requests already in flight instead of
+ * being added after each one. A bucket may be shared by several threads.
+ */
+
+#ifndef RATE_H
+#define RATE_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+// ========== STRUCTURES ==========
+typedef struct {
+    double tokens;
+    double capacity;        // Largest burst (1 = strictly spaced requests)
+    double per_ms;          // Refill rate
+    double last_ms;         // Time of the last refill
+    double jitter_ms;       // Random extra delay added after each take
+    double hold_until_ms;   // Jitter: no token before this time
+    pthread_mutex_t lock;
+} TokenBucket;
+
+typedef struct {
+    const char *name;
+    size_t requests;        // Started
+    size_t completed;       // Finished with any outcome
+    size_t errors;          // Transport failures (no HTTP response)
+    double first_start_ms;
+    double last_start_ms;
+    double last_done_ms;
+    double latency_ms;      // Sum over completed requests
+    size_t hits;            // Completed requests that found something
+    size_t requests_at_first_hit;
+    double first_hit_ms;
+} PhaseStats;
+
+// ========== FUNCTION PROTOTYPES ==========
+double monotonic_ms();
+void token_bucket_init(TokenBucket *tb, int per_minute, int min_delay_ms, int max_delay_ms);
+void token_bucket_free(TokenBucket *tb);
+double token_bucket_delay_ms(TokenBucket *tb);
+int token_bucket_take(TokenBucket *tb);
+void token_bucket_wait(TokenBucket *tb);
+
+void phase_init(PhaseStats *p, const char *name);
+void phase_request(PhaseStats *p);
+void phase_done(PhaseStats *p, double latency_ms, int error);
+void phase_hit(PhaseStats *p);
+double phase_elapsed_sec(const PhaseStats *p);
+double phase_rate_per_min(const PhaseStats *p);
+
+#endif
@@ -0,0 +1,414 @@
+/*
+ * resolver.c - Batched asynchronous DNS resolution over UDP
+ * One connected, non-blocking UDP socket; every name gets an A and an
+ * AAAA query, matched back by a random 16-bit ID and the echoed question.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/random.h>
+#include "resolver.h"
+
+#define TYPE_A      1
+#define TYPE_CNAME  5
+#define TYPE_AAAA   28
+#define RCODE_NOERROR  0
+#define RCODE_NXDOMAIN 3
+#define MAX_PACKET  1232
+
+// ========== STRUCTURES ==========
+typedef struct {
+    uint16_t id;
+    uint16_t qtype;
+    int active;
+    int done;
+    int rcode;              // -1 = timed out
+    int tries;
+    double deadline;
+    size_t packet_len;
+    uint8_t packet[MAX_PACKET];
+} Query;
+
+typedef struct {
+    int used;
+    size_t index;
+    char name[MAX_NAME_LEN + 1];
+    ResolveResult result;
+} NameSlot;
+
+typedef struct {
+    const ResolverConfig *cfg;
+    int fd;
+    NameSlot *names;        // Name k owns queries 2k (A) and 2k+1 (AAAA)
+    Query *queries;
+    int slots;
+    int *free_slots;
+    int free_count;
+    int32_t *id_map;        // DNS ID -> query + 1
+    uint64_t rng;
+    ResolveStats *stats;
+} Resolver;
+
+// ========== HELPERS ==========
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static uint16_t next_id(Resolver *r) {
+    for(;;) {
+        r->rng ^= r->rng << 13;
+        r->rng ^= r->rng >> 7;
+        r->rng ^= r->rng << 17;
+        uint16_t id = (uint16_t)(r->rng >> 24);
+        if(!r->id_map[id]) return id;
+    }
+}
+
+const char *resolve_status_name(ResolveStatus status) {
+    switch(status) {
+        case RESOLVE_OK:       return "OK";
+        case RESOLVE_NODATA:   return "NODATA";
+        case RESOLVE_NXDOMAIN: return "NXDOMAIN";
+        case RESOLVE_TIMEOUT:  return "TIMEOUT";
+        default:               return "ERROR";
+    }
+}
+
+// ========== CONFIG ==========
+// Accepts "1.2.3.4", "1.2.3.4:5353", "::1" or "[::1]:5353"
+int resolver_config_init(ResolverConfig *cfg, const char *spec) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->max_inflight = RESOLVER_DEFAULT_INFLIGHT;
+    cfg->timeout_ms = RESOLVER_DEFAULT_TIMEOUT;
+    cfg->retries = RESOLVER_DEFAULT_RETRIES;
+
+    char host[64];
+    int port = 53;
+    const char *colon = strrchr(spec, ':');
+
+    if(spec[0] == '[') {
+        const char *close = strchr(spec, ']');
+        if(!close || (size_t)(close - spec - 1) >= sizeof(host)) return 0;
+        memcpy(host, spec + 1, close - spec - 1);
+        host[close - spec - 1] = '\0';
+        if(close[1] == ':') port = atoi(close + 2);
+    } else if(colon && strchr(spec, ':') == colon) {
+        if((size_t)(colon - spec) >= sizeof(host)) return 0;
+        memcpy(host, spec, colon - spec);
+        host[colon - spec] = '\0';
+        port = atoi(colon + 1);
+    } else {
+        snprintf(host, sizeof(host), "%s", spec);
+    }
+    if(port <= 0 || port > 65535) return 0;
+
+    struct sockaddr_in *v4 = (struct sockaddr_in *)&cfg->upstream;
+    struct sockaddr_in6 *v6 = (struct sockaddr_in6 *)&cfg->upstream;
+    if(inet_pton(AF_INET, host, &v4->sin_addr) == 1) {
+        v4->sin_family = AF_INET;
+        v4->sin_port = htons((uint16_t)port);
+        cfg->upstream_len = sizeof(*v4);
+    } else if(inet_pton(AF_INET6, host, &v6->sin6_addr) == 1) {
+        v6->sin6_family = AF_INET6;
+        v6->sin6_port = htons((uint16_t)port);
+        cfg->upstream_len = sizeof(*v6);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// ========== WIRE FORMAT ==========
+static size_t encode_query(uint8_t *out, uint16_t id, const char *name, uint16_t qtype) {
+    uint8_t *p = out;
+    *p++ = id >> 8;
+    *p++ = id & 0xFF;
+    *p++ = 0x01;            // RD
+    *p++ = 0x00;
+    *p++ = 0; *p++ = 1;     // QDCOUNT
+    memset(p, 0, 6);
+    p += 6;
+
+    const char *label = name;
+    while(*label) {
+        const char *dot = strchr(label, '.');
+        size_t len = dot ? (size_t)(dot - label) : strlen(label);
+        if(len == 0 || len > 63 || (p - out) + len + 6 > MAX_PACKET) return 0;
+        *p++ = (uint8_t)len;
+        memcpy(p, label, len);
+        p += len;
+        label += len + (dot ? 1 : 0);
+    }
+    *p++ = 0;
+    *p++ = qtype >> 8;
+    *p++ = qtype & 0xFF;
+    *p++ = 0;
+    *p++ = 1;               // IN
+    return p - out;
+}
+
+// Reads a possibly compressed name at *pos; advances *pos past it
+static int read_name(const uint8_t *pkt, size_t len, size_t *pos, char *out, size_t cap) {
+    size_t p = *pos;
+    size_t o = 0;
+    int jumped = 0;
+    int hops = 0;
+
+    for(;;) {
+        if(p >= len) return 0;
+        uint8_t c = pkt[p];
+        if(c == 0) {
+            if(!jumped) *pos = p + 1;
+            break;
+        }
+        if((c & 0xC0) == 0xC0) {
+            if(p + 1 >= len || ++hops > 32) return 0;
+            if(!jumped) *pos = p + 2;
+            jumped = 1;
+            p = ((size_t)(c & 0x3F) << 8) | pkt[p + 1];
+            continue;
+        }
+        if(c > 63 || p + 1 + c > len || o + c + 2 > cap) return 0;
+        if(o) out[o++] = '.';
+        memcpy(out + o, pkt + p + 1, c);
+        o += c;
+        p += 1 + c;
+    }
+    out[o] = '\0';
+    return 1;
+}
+
+static void handle_reply(Resolver *r, const uint8_t *pkt, size_t len) {
+    if(len < 12 || !(pkt[2] & 0x80)) return;
+
+    uint16_t id = (uint16_t)(pkt[0] << 8 | pkt[1]);
+    int32_t q_index = r->id_map[id] - 1;
+    if(q_index < 0) return;
+
+    Query *q = &r->queries[q_index];
+    NameSlot *slot = &r->names[q_index / 2];
+    if(!q->active || q->done) return;
+
+    // The question must echo what we asked
+    size_t pos = 12;
+    char qname[MAX_NAME_LEN + 2];
+    uint16_t qd = (uint16_t)(pkt[4] << 8 | pkt[5]);
+    uint16_t an = (uint16_t)(pkt[6] << 8 | pkt[7]);
+    if(qd != 1 || !read_name(pkt, len, &pos, qname, sizeof(qname)) || pos + 4 > len) return;
+    if(strcasecmp(qname, slot->name) != 0) return;
+    if((uint16_t)(pkt[pos] << 8 | pkt[pos + 1]) != q->qtype) return;
+    pos += 4;
+
+    q->rcode = pkt[3] & 0x0F;
+    q->done = 1;
+    r->id_map[id] = 0;
+
+    for(uint16_t i = 0; i < an; i++) {
+        char owner[MAX_NAME_LEN + 2];
+        if(!read_name(pkt, len, &pos, owner, sizeof(owner)) || pos + 10 > len) break;
+        uint16_t type = (uint16_t)(pkt[pos] << 8 | pkt[pos + 1]);
+        uint16_t rdlen = (uint16_t)(pkt[pos + 8] << 8 | pkt[pos + 9]);
+        pos += 10;
+        if(pos + rdlen > len) break;
+
+        if(type == TYPE_A && rdlen == 4 && !slot->result.ipv4[0]) {
+            inet_ntop(AF_INET, pkt + pos, slot->result.ipv4, sizeof(slot->result.ipv4));
+        } else if(type == TYPE_AAAA && rdlen == 16 && !slot->result.ipv6[0]) {
+            inet_ntop(AF_INET6, pkt + pos, slot->result.ipv6, sizeof(slot->result.ipv6));
+        } else if(type == TYPE_CNAME && !slot->result.cname[0] && strcasecmp(owner, slot->name) == 0) {
+            char target[MAX_NAME_LEN + 2];
+            size_t rpos = pos;
+            if(read_name(pkt, len, &rpos, target, sizeof(target)) && strlen(target) <= MAX_NAME_LEN) {
+                strcpy(slot->result.cname, target);
+            }
+        }
+        pos += rdlen;
+    }
+}
+
+// ========== SLOTS ==========
+static void send_query(Resolver *r, int q_index) {
+    Query *q = &r->queries[q_index];
+    q->tries++;
+    q->deadline = now_ms() + r->cfg->timeout_ms;
+    r->stats->queries_sent++;
+    // A full socket buffer is treated like a lost packet: the retry timer covers it
+    send(r->fd, q->packet, q->packet_len, 0);
+}
+
+static int start_name(Resolver *r, size_t index, const char *name) {
+    int k = r->free_slots[--r->free_count];
+    NameSlot *slot = &r->names[k];
+    memset(&slot->result, 0, sizeof(slot->result));
+    snprintf(slot->name, sizeof(slot->name), "%s", name);
+    slot->index = index;
+    slot->used = 1;
+
+    for(int t = 0; t < 2; t++) {
+        Query *q = &r->queries[2 * k + t];
+        q->qtype = t == 0 ? TYPE_A : TYPE_AAAA;
+        q->id = next_id(r);
+        q->packet_len = encode_query(q->packet, q->id, slot->name, q->qtype);
+        q->active = 1;
+        q->done = 0;
+        q->rcode = -1;
+        q->tries = 0;
+        if(q->packet_len == 0) {
+            q->done = 1;     // Not a valid DNS name, report as error
+            q->rcode = 2;
+            continue;
+        }
+        r->id_map[q->id] = 2 * k + t + 1;
+        send_query(r, 2 * k + t);
+    }
+    return k;
+}
+
+static void finish_name(Resolver *r, int k, ResolveCallback on_result, void *userdata) {
+    NameSlot *slot = &r->names[k];
+    Query *qa = &r->queries[2 * k];
+    Query *qb = &r->queries[2 * k + 1];
+    ResolveResult *res = &slot->result;
+
+    if(res->ipv4[0] || res->ipv6[0]) {
+        res->status = RESOLVE_OK;
+        r->stats->resolved++;
+    } else if(qa->rcode == RCODE_NXDOMAIN || qb->rcode == RCODE_NXDOMAIN) {
+        res->status = RESOLVE_NXDOMAIN;
+        r->stats->nxdomain++;
+    } else if(qa->rcode == RCODE_NOERROR || qb->rcode == RCODE_NOERROR) {
+        res->status = RESOLVE_NODATA;
+        r->stats->nodata++;
+    } else if(qa->rcode < 0 || qb->rcode < 0) {
+        res->status = RESOLVE_TIMEOUT;
+        r->stats->timeouts++;
+    } else {
+        res->status = RESOLVE_ERROR;
+        r->stats->errors++;
+    }
+
+    on_result(slot->index, slot->name, res, userdata);
+
+    for(int t = 0; t < 2; t++) {
+        Query *q = &r->queries[2 * k + t];
+        if(!q->done && r->id_map[q->id] == 2 * k + t + 1) r->id_map[q->id] = 0;
+        q->active = 0;
+    }
+    slot->used = 0;
+    r->free_slots[r->free_count++] = k;
+}
+
+// ========== BATCH ==========
+int resolve_batch(const ResolverConfig *cfg, size_t count, ResolveNameFn get_name,
+                  ResolveCallback on_result, void *userdata, ResolveStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    double started = now_ms();
+
+    Resolver r;
+    memset(&r, 0, sizeof(r));
+    r.cfg = cfg;
+    r.stats = stats;
+    r.slots = cfg->max_inflight / 2;
+    if(r.slots < 1) r.slots = 1;
+    if(r.slots > RESOLVER_MAX_INFLIGHT / 2) r.slots = RESOLVER_MAX_INFLIGHT / 2;
+    if(getrandom(&r.rng, sizeof(r.rng), 0) != sizeof(r.rng) || r.rng == 0) {
+        r.rng = (uint64_t)time(NULL) * 2654435761ULL | 1;
+    }
+
+    r.fd = socket(cfg->upstream.ss_family, SOCK_DGRAM, 0);
+    if(r.fd < 0) return 0;
+    if(connect(r.fd, (const struct sockaddr *)&cfg->upstream, cfg->upstream_len) != 0) {
+        close(r.fd);
+        return 0;
+    }
+    fcntl(r.fd, F_SETFL, fcntl(r.fd, F_GETFL) | O_NONBLOCK);
+
+    r.names = calloc(r.slots, sizeof(NameSlot));
+    r.queries = calloc(r.slots * 2, sizeof(Query));
+    r.free_slots = malloc(r.slots * sizeof(int));
+    r.id_map = calloc(65536, sizeof(int32_t));
+    if(!r.names || !r.queries || !r.free_slots || !r.id_map) {
+        free(r.names);
+        free(r.queries);
+        free(r.free_slots);
+        free(r.id_map);
+        close(r.fd);
+        return 0;
+    }
+    for(int k = r.slots - 1; k >= 0; k--) r.free_slots[r.free_count++] = k;
+
+    size_t next = 0;
+    int active = 0;
+    uint8_t buf[4096];
+
+    while(next < count || active > 0) {
+        // Top up the window
+        while(next < count && r.free_count > 0) {
+            char name[MAX_NAME_LEN + 1];
+            const char *n = get_name(next, name, sizeof(name), userdata);
+            if(n) {
+                start_name(&r, next, n);
+                stats->names++;
+                active++;
+            }
+            next++;
+        }
+
+        // Wait for replies until the earliest retry deadline
+        double now = now_ms();
+        double earliest = now + 1000;
+        for(int i = 0; i < r.slots * 2; i++) {
+            if(r.queries[i].active && !r.queries[i].done && r.queries[i].deadline < earliest) {
+                earliest = r.queries[i].deadline;
+            }
+        }
+        struct pollfd pfd = { r.fd, POLLIN, 0 };
+        int wait = earliest > now ? (int)(earliest - now) + 1 : 0;
+        if(poll(&pfd, 1, wait) > 0) {
+            ssize_t n;
+            while((n = recv(r.fd, buf, sizeof(buf), 0)) > 0) handle_reply(&r, buf, (size_t)n);
+        }
+
+        // Retransmit or give up on expired queries
+        now = now_ms();
+        for(int i = 0; i < r.slots * 2; i++) {
+            Query *q = &r.queries[i];
+            if(!q->active || q->done || q->deadline > now) continue;
+            if(q->tries <= cfg->retries) {
+                stats->retransmits++;
+                send_query(&r, i);
+            } else {
+                q->done = 1;
+                q->rcode = -1;
+                r.id_map[q->id] = 0;
+            }
+        }
+
+        // Report names whose two queries are both settled
+        for(int k = 0; k < r.slots; k++) {
+            if(r.names[k].used && r.queries[2 * k].done && r.queries[2 * k + 1].done) {
+                finish_name(&r, k, on_result, userdata);
+                active--;
+            }
+        }
+    }
+
+    free(r.names);
+    free(r.queries);
+    free(r.free_slots);
+    free(r.id_map);
+    close(r.fd);
+    stats->seconds = (now_ms() - started) / 1000.0;
+    return 1;
+}
@@ -0,0 +1,67 @@
+/*
+ * resolver.h - Batched asynchronous DNS resolution over UDP
+ * Sends A and AAAA queries for many names at once to one configurable
+ * upstream (a local stub, unbound, or Tor's DNSPort) and reports each
+ * name once both answers are in.
+ */
+
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include "result_store.h"
+
+// ========== CONFIGURATION ==========
+#define RESOLVER_DEFAULT_INFLIGHT 256     // Queries in flight
+#define RESOLVER_DEFAULT_TIMEOUT  2000    // ms before a query is retried
+#define RESOLVER_DEFAULT_RETRIES  2
+#define RESOLVER_MAX_INFLIGHT     8192
+
+// ========== STRUCTURES ==========
+typedef enum {
+    RESOLVE_OK = 0,         // At least one address
+    RESOLVE_NODATA,         // Name exists but has no A/AAAA
+    RESOLVE_NXDOMAIN,       // Name does not exist
+    RESOLVE_TIMEOUT,        // No answer after all retries
+    RESOLVE_ERROR           // SERVFAIL, REFUSED, malformed reply...
+} ResolveStatus;
+
+typedef struct {
+    ResolveStatus status;
+    char ipv4[16];
+    char ipv6[46];
+    char cname[MAX_NAME_LEN + 1];
+} ResolveResult;
+
+typedef struct {
+    struct sockaddr_storage upstream;
+    socklen_t upstream_len;
+    int max_inflight;
+    int timeout_ms;
+    int retries;
+} ResolverConfig;
+
+typedef struct {
+    size_t names;
+    size_t queries_sent;
+    size_t retransmits;
+    size_t resolved;
+    size_t nodata;
+    size_t nxdomain;
+    size_t timeouts;
+    size_t errors;
+    double seconds;
+} ResolveStats;
+
+// Fills `buf` with name `index` and returns it (or NULL to skip the index)
+typedef const char *(*ResolveNameFn)(size_t index, char *buf, size_t cap, void *userdata);
+typedef void (*ResolveCallback)(size_t index, const char *name, const ResolveResult *result, void *userdata);
+
+// ========== FUNCTION PROTOTYPES ==========
+int resolver_config_init(ResolverConfig *cfg, const char *spec);
+int resolve_batch(const ResolverConfig *cfg, size_t count, ResolveNameFn get_name,
+                  ResolveCallback on_result, void *userdata, ResolveStats *stats);
+const char *resolve_status_name(ResolveStatus status);
+
+#endif
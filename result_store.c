@@ -0,0 +1,185 @@
+/*
+ * result_store.c - Deduplicating result store
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "result_store.h"
+#include "hash.h"
+
+#define INITIAL_SLOTS 1024
+
+// ========== NORMALIZATION ==========
+// Lowercases, trims whitespace and a trailing dot and drops a leading "*."
+// Returns the normalized length, or 0 if the name is empty or too long.
+size_t normalize_name(char *dst, size_t cap, const char *src, size_t len) {
+    while(len > 0 && (*src == ' ' || *src == '\t')) { src++; len--; }
+    while(len > 0 && (src[len - 1] == ' ' || src[len - 1] == '\t' ||
+                      src[len - 1] == '\r' || src[len - 1] == '\n')) len--;
+    if(len > 0 && src[len - 1] == '.') len--;
+    if(len >= 2 && src[0] == '*' && src[1] == '.') { src += 2; len -= 2; }
+
+    if(len == 0 || len > MAX_NAME_LEN || len >= cap) return 0;
+
+    for(size_t i = 0; i < len; i++) {
+        char c = src[i];
+        dst[i] = (c >= 'A' && c <= 'Z') ? c + 32 : c;
+    }
+    dst[len] = '\0';
+    return len;
+}
+
+const char *source_names(unsigned int sources, char *buf, size_t cap) {
+    static const struct { unsigned int bit; const char *name; } names[] = {
+        { SOURCE_CT, "ct" },
+        { SOURCE_HTTP, "http" },
+        { SOURCE_IMPORT, "import" },
+        { SOURCE_DNS, "dns" },
+        { SOURCE_INDEX, "index" },
+        { SOURCE_TLS, "tls-san" },
+        { SOURCE_ZONE, "zone" },
+    };
+
+    size_t used = 0;
+    buf[0] = '\0';
+    for(size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if(!(sources & names[i].bit)) continue;
+        int n = snprintf(buf + used, cap - used, "%s%s", used ? "+" : "", names[i].name);
+        if(n < 0 || (size_t)n >= cap - used) break;
+        used += n;
+    }
+    return buf;
+}
+
+// ========== INIT / FREE ==========
+void result_store_init(ResultStore *s) {
+    memset(s, 0, sizeof(*s));
+    arena_init(&s->strings);
+}
+
+void result_store_free(ResultStore *s) {
+    free(s->records);
+    free(s->slots);
+    arena_free(&s->strings);
+    memset(s, 0, sizeof(*s));
+}
+
+size_t result_store_memory(const ResultStore *s) {
+    size_t slots = s->slots ? (s->slot_mask + 1) * sizeof(ResultSlot) : 0;
+    return s->capacity * sizeof(SubdomainResult) + slots + s->strings.bytes_reserved;
+}
+
+// ========== HASH TABLE ==========
+static int grow_slots(ResultStore *s) {
+    size_t size = s->slots ? (s->slot_mask + 1) * 2 : INITIAL_SLOTS;
+    ResultSlot *slots = calloc(size, sizeof(ResultSlot));
+    if(!slots) return 0;
+
+    size_t mask = size - 1;
+    if(s->slots) {
+        for(size_t i = 0; i <= s->slot_mask; i++) {
+            ResultSlot slot = s->slots[i];
+            if(!slot.index) continue;
+            const SubdomainResult *r = &s->records[slot.index - 1];
+            size_t pos = hash_bytes(r->subdomain, r->name_len) & mask;
+            while(slots[pos].index) pos = (pos + 1) & mask;
+            slots[pos] = slot;
+        }
+        free(s->slots);
+    }
+
+    s->slots = slots;
+    s->slot_mask = mask;
+    return 1;
+}
+
+// Returns the slot holding `name`, or the empty slot where it belongs
+static ResultSlot *lookup(const ResultStore *s, const char *name, size_t len, uint64_t h) {
+    uint32_t tag = (uint32_t)(h >> 32);
+    size_t pos = h & s->slot_mask;
+
+    for(;;) {
+        ResultSlot *slot = &s->slots[pos];
+        if(!slot->index) return slot;
+        if(slot->hash == tag) {
+            const SubdomainResult *r = &s->records[slot->index - 1];
+            if(r->name_len == len && memcmp(r->subdomain, name, len) == 0) return slot;
+        }
+        pos = (pos + 1) & s->slot_mask;
+    }
+}
+
+// ========== ADD / FIND ==========
+SubdomainResult *result_store_add(ResultStore *s, const char *name, int found,
+                                  const char *ip, int http_status,
+                                  unsigned int sources, int *is_new) {
+    char key[MAX_NAME_LEN + 1];
+    size_t len = normalize_name(key, sizeof(key), name, strlen(name));
+    if(is_new) *is_new = 0;
+    if(len == 0) return NULL;
+
+    // Keep the table at most half full
+    if(!s->slots || (s->count + 1) * 2 > s->slot_mask + 1) {
+        if(!grow_slots(s)) return NULL;
+    }
+
+    uint64_t h = hash_bytes(key, len);
+    ResultSlot *slot = lookup(s, key, len, h);
+
+    if(slot->index) {
+        // Merge into the existing record
+        SubdomainResult *r = &s->records[slot->index - 1];
+        r->sources |= sources;
+        if(found) r->found = 1;
+        if(http_status > 0 && (found || r->http_status == 0)) r->http_status = http_status;
+        if(ip && !r->ip) r->ip = arena_strndup(&s->strings, ip, strlen(ip));
+        s->duplicates++;
+        return r;
+    }
+
+    if(s->count == s->capacity) {
+        size_t cap = s->capacity ? s->capacity * 2 : 1024;
+        SubdomainResult *records = realloc(s->records, cap * sizeof(SubdomainResult));
+        if(!records) return NULL;
+        s->records = records;
+        s->capacity = cap;
+    }
+
+    SubdomainResult *r = &s->records[s->count];
+    r->subdomain = arena_strndup(&s->strings, key, len);
+    if(!r->subdomain) return NULL;
+    r->ip = ip ? arena_strndup(&s->strings, ip, strlen(ip)) : NULL;
+    r->cname = NULL;
+    r->org = NULL;
+    r->http_status = http_status;
+    r->asn = 0;
+    r->found = found ? 1 : 0;
+    r->sources = (uint8_t)sources;
+    r->name_len = (uint16_t)len;
+
+    s->count++;
+    slot->hash = (uint32_t)(h >> 32);
+    slot->index = (uint32_t)s->count;
+    if(is_new) *is_new = 1;
+    return r;
+}
+
+SubdomainResult *result_store_find(const ResultStore *s, const char *name) {
+    char key[MAX_NAME_LEN + 1];
+    size_t len = normalize_name(key, sizeof(key), name, strlen(name));
+    if(len == 0 || !s->slots) return NULL;
+
+    ResultSlot *slot = lookup(s, key, len, hash_bytes(key, len));
+    return slot->index ? &s->records[slot->index - 1] : NULL;
+}
+
+// Replaces the address and CNAME of an existing record
+void result_store_set_dns(ResultStore *s, SubdomainResult *r, const char *ip, const char *cname) {
+    if(ip && ip[0] && (!r->ip || strcmp(r->ip, ip) != 0)) {
+        r->ip = arena_strndup(&s->strings, ip, strlen(ip));
+    }
+    if(cname && cname[0] && (!r->cname || strcmp(r->cname, cname) != 0)) {
+        r->cname = arena_strndup(&s->strings, cname, strlen(cname));
+    }
+}
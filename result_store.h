@@ -0,0 +1,67 @@
+/*
+ * result_store.h - Deduplicating result store
+ * Names live in an arena; an open-addressing hash table keyed by the
+ * normalized name maps each one to a single compact record.
+ */
+
+#ifndef RESULT_STORE_H
+#define RESULT_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+// ========== SOURCES ==========
+#define SOURCE_CT    0x01  // Certificate Transparency
+#define SOURCE_HTTP  0x02  // Wordlist HTTP probe
+#define SOURCE_IMPORT 0x04 // Offline passive-DNS import
+#define SOURCE_DNS   0x08  // Resolves (DNS stage); alone it does not make a name found
+#define SOURCE_INDEX 0x10  // Seen in an earlier run (name index)
+#define SOURCE_TLS   0x20  // Named in a probed host's certificate
+#define SOURCE_ZONE  0x40  // RFC 1035 zone file
+
+#define SOURCE_NAMES_LEN 48  // Every source name joined with '+'
+
+#define MAX_NAME_LEN 253   // Longest valid DNS name
+
+// ========== STRUCTURES ==========
+typedef struct {
+    const char *subdomain;  // Normalized name (arena)
+    const char *ip;         // Address or NULL when unknown (arena)
+    const char *cname;      // CNAME target or NULL (arena)
+    const char *org;        // Network owner of `ip` or NULL (the ASN database's)
+    int http_status;        // Last HTTP status seen, 0 if never probed
+    uint32_t asn;           // Autonomous system announcing `ip`, 0 if unknown
+    uint8_t found;
+    uint8_t sources;        // SOURCE_* bitmask
+    uint16_t name_len;
+} SubdomainResult;
+
+typedef struct {
+    uint32_t hash;          // Upper hash bits, checked before touching the record
+    uint32_t index;         // Record index + 1, 0 marks an empty slot
+} ResultSlot;
+
+typedef struct {
+    SubdomainResult *records;  // Insertion order
+    size_t count;
+    size_t capacity;
+    ResultSlot *slots;
+    size_t slot_mask;          // Table size - 1 (power of two)
+    Arena strings;
+    size_t duplicates;         // add() calls merged into an existing record
+} ResultStore;
+
+// ========== FUNCTION PROTOTYPES ==========
+void result_store_init(ResultStore *s);
+void result_store_free(ResultStore *s);
+SubdomainResult *result_store_add(ResultStore *s, const char *name, int found,
+                                  const char *ip, int http_status,
+                                  unsigned int sources, int *is_new);
+SubdomainResult *result_store_find(const ResultStore *s, const char *name);
+void result_store_set_dns(ResultStore *s, SubdomainResult *r, const char *ip, const char *cname);
+size_t result_store_memory(const ResultStore *s);
+size_t normalize_name(char *dst, size_t cap, const char *src, size_t len);
+const char *source_names(unsigned int sources, char *buf, size_t cap);
+
+#endif
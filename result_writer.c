@@ -0,0 +1,337 @@
+/*
+ * result_writer.c - Streaming result output in CSV, JSON Lines or binary
+ * A record is written every time a name is first seen or its state
+ * changes, so a later line for the same name supersedes earlier ones.
+ *
+ * Binary layout (all integers little-endian):
+ *   file header: "SSRB" u32 version
+ *   record:      u32 length of the rest, u8 found, u8 sources,
+ *                u16 http status, i64 unix time,
+ *                u16 length + name, u16 length + ip, u16 length + cname,
+ *                u32 asn (0 = unknown), u16 length + org
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "result_writer.h"
+
+// ========== OUTPUT BUFFER ==========
+static int buf_reserve(OutputBuffer *b, size_t extra) {
+    if(b->len + extra <= b->cap) return 1;
+    size_t cap = b->cap ? b->cap * 2 : 16384;
+    while(cap < b->len + extra) cap *= 2;
+    char *data = realloc(b->data, cap);
+    if(!data) return 0;
+    b->data = data;
+    b->cap = cap;
+    return 1;
+}
+
+static void buf_put(OutputBuffer *b, const void *data, size_t len) {
+    if(!buf_reserve(b, len)) return;
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+static void buf_printf(OutputBuffer *b, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void buf_printf(OutputBuffer *b, const char *fmt, ...) {
+    char tmp[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+    va_end(ap);
+    if(n > 0) buf_put(b, tmp, (size_t)n < sizeof(tmp) ? (size_t)n : sizeof(tmp) - 1);
+}
+
+static void buf_le(OutputBuffer *b, uint64_t v, int bytes) {
+    unsigned char out[8];
+    for(int i = 0; i < bytes; i++) out[i] = (unsigned char)(v >> (8 * i));
+    buf_put(b, out, bytes);
+}
+
+static void buf_field16(OutputBuffer *b, const char *s) {
+    size_t len = s ? strlen(s) : 0;
+    if(len > 0xffff) len = 0xffff;
+    buf_le(b, len, 2);
+    buf_put(b, s, len);
+}
+
+// ========== CSV ==========
+static void csv_header(OutputBuffer *b, const char *domain, time_t now) {
+    buf_printf(b, "# Educational DNS Scan Results\n");
+    buf_printf(b, "# Date: %s", ctime(&now));
+    buf_printf(b, "# Domain: %s\n", domain);
+    buf_printf(b, "# For educational purposes only\n\n");
+    buf_printf(b, "SUBDOMAIN,STATUS,HTTP_CODE,IP,SOURCE,CNAME,ASN,ORG\n");
+}
+
+// AS descriptions are free text; quote them when they would split the row
+static void csv_field(OutputBuffer *b, const char *s) {
+    if(!s) return;
+    if(!strpbrk(s, ",\"\r\n")) {
+        buf_put(b, s, strlen(s));
+        return;
+    }
+    buf_put(b, "\"", 1);
+    for(; *s; s++) {
+        if(*s == '"') buf_put(b, "\"", 1);
+        buf_put(b, s, 1);
+    }
+    buf_put(b, "\"", 1);
+}
+
+static void csv_record(OutputBuffer *b, const SubdomainResult *r, time_t now) {
+    char sources[SOURCE_NAMES_LEN];
+    (void)now;
+    buf_printf(b, "%s,%s,%d,%s,%s,%s,",
+               r->subdomain,
+               r->found ? "FOUND" : "NOT_FOUND",
+               r->http_status,
+               r->ip ? r->ip : "N/A",
+               source_names(r->sources, sources, sizeof(sources)),
+               r->cname ? r->cname : "");
+    if(r->asn) buf_printf(b, "%u", (unsigned)r->asn);
+    buf_put(b, ",", 1);
+    csv_field(b, r->org);
+    buf_put(b, "\n", 1);
+}
+
+// ========== JSON LINES ==========
+// Never cuts an escape sequence; the result is always a closed, NUL-terminated literal
+size_t json_quote(char *dst, size_t cap, const char *s) {
+    if(cap < 3) {
+        if(cap) dst[0] = '\0';
+        return 0;
+    }
+    size_t n = 0;
+    dst[n++] = '"';
+    for(; s && *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        char esc[7];
+        size_t len = 1;
+        if(c == '"' || c == '\\') {
+            esc[0] = '\\';
+            esc[1] = (char)c;
+            len = 2;
+        } else if(c < 0x20 || c == 0x7f) {
+            len = (size_t)snprintf(esc, sizeof(esc), "\\u%04x", c);
+        } else {
+            esc[0] = (char)c;
+        }
+        if(n + len + 2 > cap) break;  // Room for the closing quote and NUL
+        memcpy(dst + n, esc, len);
+        n += len;
+    }
+    dst[n++] = '"';
+    dst[n] = '\0';
+    return n;
+}
+
+static void json_string(OutputBuffer *b, const char *s) {
+    size_t cap = JSON_QUOTED_LEN(s ? strlen(s) : 0);
+    if(!buf_reserve(b, cap)) return;
+    b->len += json_quote(b->data + b->len, cap, s);
+}
+
+static void jsonl_record(OutputBuffer *b, const SubdomainResult *r, time_t now) {
+    char sources[SOURCE_NAMES_LEN];
+    buf_printf(b, "{\"name\":");
+    json_string(b, r->subdomain);
+    buf_printf(b, ",\"found\":%s,\"http\":%d,\"ip\":", r->found ? "true" : "false", r->http_status);
+    if(r->ip) json_string(b, r->ip); else buf_printf(b, "null");
+    buf_printf(b, ",\"cname\":");
+    if(r->cname) json_string(b, r->cname); else buf_printf(b, "null");
+    buf_printf(b, ",\"sources\":");
+    json_string(b, source_names(r->sources, sources, sizeof(sources)));
+    buf_printf(b, ",\"asn\":");
+    if(r->asn) buf_printf(b, "%u", (unsigned)r->asn); else buf_printf(b, "null");
+    buf_printf(b, ",\"org\":");
+    if(r->org) json_string(b, r->org); else buf_printf(b, "null");
+    buf_printf(b, ",\"time\":%lld}\n", (long long)now);
+}
+
+// ========== BINARY ==========
+static void binary_header(OutputBuffer *b, const char *domain, time_t now) {
+    (void)domain; (void)now;
+    buf_put(b, RESULT_BINARY_MAGIC, 4);
+    buf_le(b, RESULT_BINARY_VERSION, 4);
+}
+
+static void binary_record(OutputBuffer *b, const SubdomainResult *r, time_t now) {
+    size_t start = b->len;
+    buf_le(b, 0, 4);  // Patched below
+    buf_le(b, r->found, 1);
+    buf_le(b, r->sources, 1);
+    buf_le(b, (uint16_t)r->http_status, 2);
+    buf_le(b, (uint64_t)(int64_t)now, 8);
+    buf_field16(b, r->subdomain);
+    buf_field16(b, r->ip);
+    buf_field16(b, r->cname);
+    buf_le(b, r->asn, 4);
+    buf_field16(b, r->org);
+
+    if(b->len >= start + 4) {
+        uint32_t len = (uint32_t)(b->len - start - 4);
+        for(int i = 0; i < 4; i++) b->data[start + i] = (char)(len >> (8 * i));
+    }
+}
+
+static const OutputFormat formats[] = {
+    { "csv",   "found_subdomains.txt",   csv_header,    csv_record },
+    { "jsonl", "found_subdomains.jsonl", NULL,          jsonl_record },
+    { "bin",   "found_subdomains.bin",   binary_header, binary_record },
+};
+
+const OutputFormat *output_format_find(const char *name) {
+    for(size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        if(strcmp(formats[i].name, name) == 0) return &formats[i];
+    }
+    return NULL;
+}
+
+// ========== WRITER THREAD ==========
+static int write_all(int fd, const char *data, size_t len) {
+    while(len > 0) {
+        ssize_t n = write(fd, data, len);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            return 0;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+static void *writer_main(void *arg) {
+    ResultWriter *w = (ResultWriter *)arg;
+    OutputBuffer out = { NULL, 0, 0 };
+
+    pthread_mutex_lock(&w->lock);
+    for(;;) {
+        // Let small records accumulate for up to one flush interval
+        if(w->pending.len < RESULT_WRITER_FLUSH_BYTES && !w->closing) {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += RESULT_WRITER_FLUSH_MS * 1000000L;
+            until.tv_sec += until.tv_nsec / 1000000000L;
+            until.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&w->wake, &w->lock, &until);
+        }
+
+        // Swap buffers and write outside the lock
+        OutputBuffer swap = w->pending;
+        w->pending = out;
+        w->pending.len = 0;
+        out = swap;
+        int closing = w->closing;
+        pthread_cond_broadcast(&w->drained);
+        pthread_mutex_unlock(&w->lock);
+
+        if(out.len > 0) {
+            int ok = write_all(w->fd, out.data, out.len);
+            int error = errno;
+            pthread_mutex_lock(&w->lock);
+            if(ok) {
+                w->bytes_written += out.len;
+            } else {
+                // The file is already missing records; drop what is queued
+                // and stop buffering instead of growing for the rest of the scan
+                w->failed = 1;
+                w->error = error;
+                w->pending.len = 0;
+                pthread_cond_broadcast(&w->drained);
+            }
+            pthread_mutex_unlock(&w->lock);
+            out.len = 0;
+        }
+
+        pthread_mutex_lock(&w->lock);
+        if(closing && w->pending.len == 0) break;
+    }
+    pthread_mutex_unlock(&w->lock);
+    free(out.data);
+    return NULL;
+}
+
+// ========== OPEN / WRITE / CLOSE ==========
+int result_writer_open(ResultWriter *w, const char *path, const OutputFormat *format,
+                       const char *domain, int append, const char **error) {
+    memset(w, 0, sizeof(*w));
+    w->fd = open(path, O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644);
+    if(w->fd < 0) {
+        *error = strerror(errno);
+        return 0;
+    }
+
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->wake, NULL);
+    pthread_cond_init(&w->drained, NULL);
+
+    // Appending to an existing stream must not repeat the header
+    if(format->header && lseek(w->fd, 0, SEEK_END) == 0) {
+        format->header(&w->pending, domain, time(NULL));
+    }
+
+    if(pthread_create(&w->thread, NULL, writer_main, w) != 0) {
+        close(w->fd);
+        free(w->pending.data);
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->wake);
+        pthread_cond_destroy(&w->drained);
+        memset(w, 0, sizeof(*w));
+        *error = "could not start writer thread";
+        return 0;
+    }
+    w->format = format;  // Marks the writer as open
+    return 1;
+}
+
+// Returns 0 once a write has failed; the record is not kept and w->error says why
+int result_writer_write(ResultWriter *w, const SubdomainResult *r) {
+    if(!w->format) return 1;
+    pthread_mutex_lock(&w->lock);
+    while(w->pending.len >= RESULT_WRITER_MAX_PENDING && !w->failed) {
+        pthread_cond_signal(&w->wake);
+        pthread_cond_wait(&w->drained, &w->lock);
+    }
+    int ok = !w->failed;
+    if(ok) {
+        w->format->record(&w->pending, r, time(NULL));
+        w->records++;
+        if(w->pending.len >= RESULT_WRITER_FLUSH_BYTES) pthread_cond_signal(&w->wake);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return ok;
+}
+
+// Drains everything and fsyncs; returns 0 if any write failed
+int result_writer_close(ResultWriter *w) {
+    if(!w->format) return 1;
+
+    pthread_mutex_lock(&w->lock);
+    w->closing = 1;
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    int ok = !w->failed && fsync(w->fd) == 0;
+    ok = (close(w->fd) == 0) && ok;
+    int error = w->failed ? w->error : ok ? 0 : errno;
+    free(w->pending.data);
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->wake);
+    pthread_cond_destroy(&w->drained);
+
+    size_t records = w->records, bytes = w->bytes_written;
+    memset(w, 0, sizeof(*w));
+    w->records = records;
+    w->bytes_written = bytes;
+    w->error = error;
+    return ok;
+}
@@ -0,0 +1,63 @@
+/*
+ * result_writer.h - Streaming result output in CSV, JSON Lines or binary
+ * Records are encoded on the calling thread into a memory buffer and a
+ * background thread writes the buffer out, so the scan never waits on
+ * the disk and the file can be tailed while the scan runs.
+ */
+
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "result_store.h"
+
+// ========== CONFIGURATION ==========
+#define RESULT_WRITER_FLUSH_MS    250               // Longest a record waits in memory
+#define RESULT_WRITER_FLUSH_BYTES (64 * 1024)       // Wake the writer early past this
+#define RESULT_WRITER_MAX_PENDING (8 * 1024 * 1024) // Producers block past this
+#define RESULT_BINARY_MAGIC       "SSRB"
+#define RESULT_BINARY_VERSION     2
+#define JSON_QUOTED_LEN(n)        ((n) * 6 + 3)     // json_quote() room for n bytes: \u00XX each, quotes, NUL
+
+// ========== STRUCTURES ==========
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} OutputBuffer;
+
+// One output format: an optional file header and a record encoder
+typedef struct {
+    const char *name;
+    const char *default_path;
+    void (*header)(OutputBuffer *b, const char *domain, time_t now);
+    void (*record)(OutputBuffer *b, const SubdomainResult *r, time_t now);
+} OutputFormat;
+
+typedef struct {
+    const OutputFormat *format;
+    int fd;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;        // Writer: data or shutdown
+    pthread_cond_t drained;     // Producers: pending buffer has room again
+    OutputBuffer pending;
+    int closing;
+    int failed;                 // Latched on the first write error; nothing is buffered after it
+    int error;                  // errno of that write
+    size_t records;
+    size_t bytes_written;
+} ResultWriter;
+
+// ========== FUNCTION PROTOTYPES ==========
+const OutputFormat *output_format_find(const char *name);
+int result_writer_open(ResultWriter *w, const char *path, const OutputFormat *format,
+                       const char *domain, int append, const char **error);
+int result_writer_write(ResultWriter *w, const SubdomainResult *r);
+int result_writer_close(ResultWriter *w);
+size_t json_quote(char *dst, size_t cap, const char *s);
+
+#endif
@@ -0,0 +1,808 @@
+/*
+ * scan.c - Reentrant scan engine behind the command-line tool (libshadowscan)
+ * Phase functions report through the context's callbacks; all per-scan
+ * state lives in the ScanContext, so scans never see each other's results.
+ * What the engine shares locks itself: the token bucket, the deadlines,
+ * the metrics and curl's share handle (DNS and TLS sessions only).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <time.h>
+#include "scan.h"
+#include "name_index.h"
+
+// ========== EVENTS ==========
+static void emit(ScanContext *ctx, ScanEvent *ev) {
+    if(ctx->config.on_event) ctx->config.on_event(ctx, ev, ctx->config.userdata);
+}
+
+static void phase_event(ScanContext *ctx, ScanEventKind kind, ScanPhase phase, int ok) {
+    ScanEvent ev = { .kind = kind, .phase = phase, .ok = ok };
+    emit(ctx, &ev);
+}
+
+static void warn(ScanContext *ctx, ScanPhase phase, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+static void warn(ScanContext *ctx, ScanPhase phase, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(ctx->text, sizeof(ctx->text), fmt, ap);
+    va_end(ap);
+    ScanEvent ev = { .kind = SCAN_EVENT_WARNING, .phase = phase, .message = ctx->text };
+    emit(ctx, &ev);
+}
+
+// Records why `phase` failed and ends it; always returns 0
+static int fail(ScanContext *ctx, ScanPhase phase, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+static int fail(ScanContext *ctx, ScanPhase phase, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(ctx->text, sizeof(ctx->text), fmt, ap);
+    va_end(ap);
+    ctx->error = ctx->text;
+    phase_event(ctx, SCAN_EVENT_PHASE_END, phase, 0);
+    return 0;
+}
+
+// ========== RESULTS ==========
+static void publish(ScanContext *ctx, const SubdomainResult *r) {
+    if(ctx->config.on_result) ctx->config.on_result(ctx, r, ctx->config.userdata);
+}
+
+// Returns 1 if the name was not in the store yet
+static int add_result(ScanContext *ctx, const char *subdomain, int found, const char *ip,
+                      int http_status, unsigned int source) {
+    SubdomainResult before = { 0 };
+    const SubdomainResult *old = result_store_find(&ctx->results, subdomain);
+    if(old) before = *old;
+
+    int is_new = 0;
+    SubdomainResult *r = result_store_add(&ctx->results, subdomain, found, ip, http_status, source, &is_new);
+
+    // Deliver the record whenever it is new or something about it changed
+    if(r && (is_new || r->found != before.found || r->http_status != before.http_status ||
+             r->sources != before.sources || r->ip != before.ip)) {
+        publish(ctx, r);
+    }
+    return is_new;
+}
+
+// Stores a DNS answer and, with an ASN database, the network its address is in
+static void set_dns(ScanContext *ctx, SubdomainResult *r, const ResolveResult *res) {
+    result_store_set_dns(&ctx->results, r, res->ipv4[0] ? res->ipv4 : res->ipv6, res->cname);
+    if(!ctx->config.asn || !r->ip) return;
+
+    const AsnNetwork *net = asn_lookup(ctx->config.asn, r->ip);
+    r->asn = net ? net->asn : 0;
+    r->org = net ? asn_org(ctx->config.asn, net) : NULL;
+}
+
+// ========== ENGINE ==========
+int scan_engine_init(ScanEngine *e, const char *proxy, const char *user_agent,
+                     int per_minute, int min_delay_ms, int max_delay_ms) {
+    memset(e, 0, sizeof(*e));
+    curl_global_init(CURL_GLOBAL_DEFAULT);  // Before any source thread uses curl
+    if(!http_client_init(&e->http, proxy, user_agent)) {
+        curl_global_cleanup();
+        return 0;
+    }
+    srand(time(NULL));  // Wildcard calibration labels
+    token_bucket_init(&e->bucket, per_minute, min_delay_ms, max_delay_ms);
+    e->requests_per_minute = per_minute;
+    deadline_init(&e->deadline, SCAN_TIMEOUT_FLOOR_MS, SCAN_TIMEOUT_INITIAL_MS, SCAN_TIMEOUT_CEILING_MS);
+    metrics_init(&e->metrics);
+    pthread_mutex_init(&e->lock, NULL);
+    return 1;
+}
+
+void scan_engine_free(ScanEngine *e) {
+    metrics_free(&e->metrics);  // Also stops an export thread
+    http_client_free(&e->http);
+    token_bucket_free(&e->bucket);
+    deadline_free(&e->deadline);
+    pthread_mutex_destroy(&e->lock);
+    curl_global_cleanup();
+    memset(e, 0, sizeof(*e));
+}
+
+// ========== CONTEXT ==========
+void scan_config_init(ScanConfig *cfg, const char *domain) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->domain = domain;
+    cfg->index_file = SCAN_DEFAULT_INDEX;
+    cfg->ct_cache_dir = SCAN_DEFAULT_CACHE_DIR;
+    cfg->ct_ttl = SCAN_DEFAULT_CT_TTL;
+    cfg->probe_ttl = SCAN_DEFAULT_PROBE_TTL;
+    cfg->negative_ttl = SCAN_DEFAULT_NEGATIVE_TTL;
+    cfg->dns_inflight = RESOLVER_DEFAULT_INFLIGHT;
+    cfg->parallel = PROBE_DEFAULT_PARALLEL;
+}
+
+// Returns 0 with ctx->error set when the domain or resolver is unusable
+int scan_init(ScanContext *ctx, ScanEngine *engine, const ScanConfig *cfg) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->engine = engine;
+    ctx->config = *cfg;
+
+    if(!cfg->domain || !domain_matcher_init(&ctx->target, cfg->domain)) {
+        snprintf(ctx->text, sizeof(ctx->text), "Invalid domain: %s", cfg->domain ? cfg->domain : "(none)");
+        ctx->error = ctx->text;
+        return 0;
+    }
+    if(cfg->resolver) {
+        if(!resolver_config_init(&ctx->resolver, cfg->resolver)) {
+            snprintf(ctx->text, sizeof(ctx->text), "Invalid resolver address: %s", cfg->resolver);
+            ctx->error = ctx->text;
+            return 0;
+        }
+        if(cfg->dns_inflight > 0) ctx->resolver.max_inflight = cfg->dns_inflight;
+    }
+    const char *too_many = cfg->ct_file_count > PASSIVE_MAX_FILES ? "CT answer" :
+                           cfg->ct_log_count > PASSIVE_MAX_FILES ? "CT log" :
+                           cfg->ingest_count > PASSIVE_MAX_FILES ? "passive-DNS" :
+                           cfg->zone_count > PASSIVE_MAX_FILES ? "zone" : NULL;
+    if(too_many) {
+        snprintf(ctx->text, sizeof(ctx->text), "Too many %s files (at most %d)", too_many, PASSIVE_MAX_FILES);
+        ctx->error = ctx->text;
+        return 0;
+    }
+
+    result_store_init(&ctx->results);
+    phase_init(&ctx->ct_phase, "crt.sh:");
+    phase_init(&ctx->probe_phase, "Wordlist probes:");
+    phase_init(&ctx->calibration_phase, "Calibration:");
+    ctx->started_ms = monotonic_ms();
+    return 1;
+}
+
+// Async-signal-safe: in-flight probes are abandoned and the journal kept
+void scan_stop(ScanContext *ctx) {
+    ctx->stop = 1;
+}
+
+void scan_free(ScanContext *ctx) {
+    result_store_free(&ctx->results);
+    ranker_free(&ctx->ranker);
+    probe_cache_free(&ctx->probe_cache);
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+// ========== TOR CHECK ==========
+typedef struct {
+    char *data;
+    size_t size;
+} ResponseBuffer;
+
+static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    ResponseBuffer *buf = (ResponseBuffer *)userp;
+
+    char *ptr = realloc(buf->data, buf->size + realsize + 1);
+    if(!ptr) return 0;
+
+    buf->data = ptr;
+    memcpy(&(buf->data[buf->size]), contents, realsize);
+    buf->size += realsize;
+    buf->data[buf->size] = 0;
+
+    return realsize;
+}
+
+// One request through the proxy; returns 1 if it left through Tor
+static int tor_check_once(ScanEngine *e, const char **error) {
+    CURL *curl = http_client_handle(&e->http);
+    if(!curl) {
+        *error = "curl_easy_init failed";
+        return 0;
+    }
+
+    ResponseBuffer response = {0};
+
+    curl_easy_setopt(curl, CURLOPT_URL, SCAN_TOR_CHECK_URL);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+
+    CURLcode res = curl_easy_perform(curl);
+    metrics_record(metrics_phase(&e->metrics, "tor_check"), curl, res);
+
+    int tor_active = 0;
+    if(res != CURLE_OK) {
+        *error = curl_easy_strerror(res);
+    } else if(response.data && strstr(response.data, "true") != NULL) {
+        tor_active = 1;
+    } else {
+        *error = "proxy answered, but traffic is not leaving through Tor";
+    }
+
+    free(response.data);
+    curl_easy_cleanup(curl);
+    return tor_active;
+}
+
+// Retries with exponential backoff so a Tor daemon that is still
+// bootstrapping gets a chance; never tries to start the service itself.
+// A proxy the engine already verified is not checked again. Only one
+// check request is in flight at a time; the backoff sleeps without the
+// lock, so another scan can check (and verify for both) meanwhile.
+int scan_check_tor(ScanContext *ctx) {
+    ScanEngine *e = ctx->engine;
+    phase_event(ctx, SCAN_EVENT_PHASE_START, SCAN_PHASE_TOR_CHECK, 1);
+
+    long backoff_ms = SCAN_TOR_BACKOFF_MS;
+    int verified = 0;
+    for(int attempt = 1; attempt <= SCAN_TOR_CHECK_ATTEMPTS && !ctx->stop; attempt++) {
+        const char *error = NULL;
+        pthread_mutex_lock(&e->lock);
+        if(!e->tor_verified && tor_check_once(e, &error)) e->tor_verified = 1;
+        verified = e->tor_verified;
+        pthread_mutex_unlock(&e->lock);
+        if(verified) break;
+
+        int last = attempt == SCAN_TOR_CHECK_ATTEMPTS;
+        ScanEvent ev = { .kind = SCAN_EVENT_TOR_RETRY, .phase = SCAN_PHASE_TOR_CHECK, .attempt = attempt,
+                         .backoff_ms = last ? 0 : backoff_ms, .message = error };
+        emit(ctx, &ev);
+        if(last) break;
+
+        usleep((useconds_t)backoff_ms * 1000);
+        backoff_ms *= 2;
+        if(backoff_ms > SCAN_TOR_BACKOFF_MAX_MS) backoff_ms = SCAN_TOR_BACKOFF_MAX_MS;
+    }
+
+    if(!verified) return fail(ctx, SCAN_PHASE_TOR_CHECK, "Tor not available");
+    phase_event(ctx, SCAN_EVENT_PHASE_END, SCAN_PHASE_TOR_CHECK, 1);
+    return 1;
+}
+
+// ========== PASSIVE SOURCES ==========
+// Drains every source's names into the result store, on the calling thread.
+// Delta mode only decides what is reported: known names are stored too, so
+// the wordlist phase, the ranker and the name index still see them
+static void on_passive_name(const PassiveName *name, void *userdata) {
+    ScanContext *ctx = (ScanContext *)userdata;
+    if(!add_result(ctx, name->name, 1, NULL, 0, name->sources)) {
+        ctx->passive_merged++;
+        return;
+    }
+    if(name->known) return;
+    ctx->passive_unique++;
+
+    ScanEvent ev = { .kind = SCAN_EVENT_NAME, .phase = SCAN_PHASE_PASSIVE, .ok = 1,
+                     .name = name->name, .passive = name };
+    emit(ctx, &ev);
+}
+
+// Runs crt.sh (unless offline), CT dumps and log mirrors, passive-DNS files and the name index at once
+int scan_passive(ScanContext *ctx) {
+    const ScanConfig *cfg = &ctx->config;
+    ScanEngine *e = ctx->engine;
+    PassiveSource *sources = ctx->sources;
+    int count = 0;
+
+    ctx->online = !cfg->offline;
+    if(ctx->online) {
+        PassiveSource *s = &sources[count++];
+        passive_crtsh(s, &ctx->target, CRTSH_URL, &e->http, cfg->ct_cache_dir, cfg->ct_ttl, cfg->delta);
+        s->bucket = &e->bucket;
+        s->phase = &ctx->ct_phase;
+        s->metrics = metrics_phase(&e->metrics, "crtsh");
+    }
+    for(int i = 0; i < cfg->ct_file_count; i++) {
+        passive_ct_file(&sources[count++], &ctx->target, cfg->ct_files[i]);
+    }
+    for(int i = 0; i < cfg->ct_log_count; i++) {
+        passive_ct_log(&sources[count++], &ctx->target, cfg->ct_log_files[i], cfg->threads);
+    }
+    for(int i = 0; i < cfg->ingest_count; i++) {
+        passive_dns_file(&sources[count++], &ctx->target, cfg->ingest_files[i], cfg->threads);
+    }
+    for(int i = 0; i < cfg->zone_count; i++) {
+        passive_zone_file(&sources[count++], &ctx->target, cfg->zone_files[i], cfg->threads);
+    }
+    if(cfg->from_index && cfg->index_file) {
+        passive_index(&sources[count++], &ctx->target, cfg->index_file);
+    }
+    ctx->source_count = count;
+    if(count == 0) return 1;
+
+    phase_event(ctx, SCAN_EVENT_PHASE_START, SCAN_PHASE_PASSIVE, 1);
+    double started = monotonic_ms();
+    if(!passive_run(sources, count, on_passive_name, ctx)) {
+        return fail(ctx, SCAN_PHASE_PASSIVE, "Could not start the passive sources");
+    }
+    ctx->passive_seconds = (monotonic_ms() - started) / 1000.0;
+    phase_event(ctx, SCAN_EVENT_PHASE_END, SCAN_PHASE_PASSIVE, 1);
+    return 1;
+}
+
+// ========== DNS RESOLUTION ==========
+static const char *ct_record_name(size_t index, char *buf, size_t cap, void *userdata) {
+    (void)buf; (void)cap;
+    const SubdomainResult *r = &((ScanContext *)userdata)->results.records[index];
+    return (r->sources & SOURCE_CT) ? r->subdomain : NULL;
+}
+
+static void on_ct_resolved(size_t index, const char *name, const ResolveResult *res, void *userdata) {
+    (void)name;
+    ScanContext *ctx = (ScanContext *)userdata;
+    if(res->status != RESOLVE_OK && !res->cname[0]) return;
+
+    SubdomainResult *r = &ctx->results.records[index];
+    set_dns(ctx, r, res);
+    r->sources |= SOURCE_DNS;
+    publish(ctx, r);
+}
+
+// Fills in addresses and CNAMEs for everything crt.sh returned
+int scan_resolve(ScanContext *ctx) {
+    if(!ctx->config.resolver) return 1;
+    phase_event(ctx, SCAN_EVENT_PHASE_START, SCAN_PHASE_RESOLVE, 1);
+    if(!resolve_batch(&ctx->resolver, ctx->results.count, ct_record_name, on_ct_resolved, ctx, &ctx->dns_stats)) {
+        return fail(ctx, SCAN_PHASE_RESOLVE, "DNS resolution failed to start");
+    }
+    phase_event(ctx, SCAN_EVENT_PHASE_END, SCAN_PHASE_RESOLVE, 1);
+    return 1;
+}
+
+typedef struct {
+    ScanContext *ctx;
+    unsigned char *skip;           // Bit per wordlist entry: NXDOMAIN or wildcard, do not probe
+} PrefilterState;
+
+static const char *wordlist_candidate(size_t index, char *buf, size_t cap, void *userdata) {
+    ScanContext *ctx = ((PrefilterState *)userdata)->ctx;
+    if(journal_is_done(&ctx->journal, index)) return NULL;
+    char word_buf[WORDLIST_MAX_WORD_LEN + 1];
+    size_t word_len;
+    const char *word = wordlist_word(ctx->wordlist, index, word_buf, &word_len);
+
+    int n = snprintf(buf, cap, "%.*s.%s", (int)word_len, word, ctx->target.domain);
+    return (n > 0 && (size_t)n < cap) ? buf : NULL;
+}
+
+static void on_candidate_resolved(size_t index, const char *name, const ResolveResult *res, void *userdata) {
+    PrefilterState *state = (PrefilterState *)userdata;
+    ScanContext *ctx = state->ctx;
+
+    if(res->status == RESOLVE_NXDOMAIN) {
+        state->skip[index / 8] |= (unsigned char)(1 << (index % 8));
+        return;
+    }
+    if(res->status != RESOLVE_OK && !res->cname[0]) return;
+
+    // Answered by the wildcard record: says nothing about this name
+    if(wildcard_match_dns(&ctx->wildcard, res)) {
+        state->skip[index / 8] |= (unsigned char)(1 << (index % 8));
+        ctx->wildcard.dns_filtered++;
+        return;
+    }
+
+    // The name resolves (SOURCE_DNS and its address say so); it only counts
+    // as found once the HTTP probe succeeds
+    SubdomainResult *r = result_store_add(&ctx->results, name, 0, NULL, 0, SOURCE_DNS, NULL);
+    if(r) {
+        set_dns(ctx, r, res);
+        publish(ctx, r);
+    }
+}
+
+// Returns a bitmap of candidates that do not exist, or NULL if nothing is skipped
+static unsigned char *prefilter_wordlist(ScanContext *ctx) {
+    phase_event(ctx, SCAN_EVENT_PHASE_START, SCAN_PHASE_PREFILTER, 1);
+
+    size_t words = ctx->wordlist->count;
+    PrefilterState state = { ctx, calloc((words + 7) / 8 + 1, 1) };
+    if(!state.skip) {
+        fail(ctx, SCAN_PHASE_PREFILTER, "Out of memory");
+        return NULL;
+    }
+    if(!resolve_batch(&ctx->resolver, words, wordlist_candidate, on_candidate_resolved, &state, &ctx->dns_stats)) {
+        free(state.skip);
+        fail(ctx, SCAN_PHASE_PREFILTER, "DNS resolution failed to start");
+        return NULL;
+    }
+    phase_event(ctx, SCAN_EVENT_PHASE_END, SCAN_PHASE_PREFILTER, 1);
+    return state.skip;
+}
+
+// ========== WILDCARD CALIBRATION ==========
+static const char *calibration_label(size_t index, char *buf, size_t cap, void *userdata) {
+    ScanContext *ctx = (ScanContext *)userdata;
+    int n = snprintf(buf, cap, "%s.%s", ctx->wildcard.labels[index], ctx->target.domain);
+    return (n > 0 && (size_t)n < cap) ? buf : NULL;
+}
+
+static const char *calibration_host(size_t *index, char *buf, size_t cap, void *userdata) {
+    return calibration_label(*index, buf, cap, userdata);
+}
+
+static void on_calibration_resolved(size_t index, const char *name, const ResolveResult *res, void *userdata) {
+    (void)index; (void)name;
+    wildcard_learn_dns(&((ScanContext *)userdata)->wildcard, res);
+}
+
+static void on_calibration_probed(size_t index, const char *host, const ProbeResult *res, void *userdata) {
+    (void)index;
+    wildcard_learn_http(&((ScanContext *)userdata)->wildcard, host, res);
+}
+
+// Resolves and probes random labels that cannot exist
+static void calibrate_wildcards(ScanContext *ctx) {
+    ScanEngine *e = ctx->engine;
+    phase_event(ctx, SCAN_EVENT_PHASE_START, SCAN_PHASE_CALIBRATION, 1);
+    wildcard_init(&ctx->wildcard);
+
+    ResolveStats stats;
+    int resolved = ctx->config.resolver &&
+                   resolve_batch(&ctx->resolver, WILDCARD_SAMPLES, calibration_label,
+                                 on_calibration_resolved, ctx, &stats);
+
+    // With a resolver, NXDOMAIN for every label rules out a catch-all without spending requests
+    if(!resolved || ctx->wildcard.dns_answered > 0) {
+        ProbeConfig cfg = {
+            .http = &e->http,
+            .deadline = &e->deadline,
+            .max_parallel = WILDCARD_SAMPLES,
+            .stop = &ctx->stop,
+            .metrics = metrics_phase(&e->metrics, "calibration"),
+        };
+        probe_run(&cfg, &e->bucket, &ctx->calibration_phase, WILDCARD_SAMPLES,
+                  calibration_host, on_calibration_probed, ctx);
+    }
+    wildcard_finish(&ctx->wildcard);
+    phase_event(ctx, SCAN_EVENT_PHASE_END, SCAN_PHASE_CALIBRATION, 1);
+}
+
+// ========== WORDLIST RANKING ==========
+// Feeds the labels left of the registered domain: the target for in-scope
+// names, otherwise everything but the last two labels
+static void learn_name(ScanContext *ctx, const char *name, size_t len, float weight) {
+    if(domain_match(&ctx->target, name, len)) {
+        if(len > ctx->target.len + 1) ranker_learn(&ctx->ranker, name, len - ctx->target.len - 1, weight);
+        return;
+    }
+    size_t end = len, dots = 0;
+    while(end > 0 && dots < 2) {
+        if(name[--end] == '.') dots++;
+    }
+    if(dots == 2 && end > 0) ranker_learn(&ctx->ranker, name, end, weight);
+}
+
+static size_t learn_prior_file(ScanContext *ctx, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if(!fp) {
+        warn(ctx, SCAN_PHASE_RANK, "Cannot read prior corpus %s", path);
+        return 0;
+    }
+    char line[512], name[MAX_NAME_LEN + 1];
+    size_t names = 0;
+    while(fgets(line, sizeof(line), fp)) {
+        size_t len = normalize_name(name, sizeof(name), line, strcspn(line, ",\r\n"));
+        if(!len) continue;
+        // A bare label is a label; a dotted name is split like any other
+        if(memchr(name, '.', len)) learn_name(ctx, name, len, RANK_WEIGHT_PRIOR);
+        else ranker_learn(&ctx->ranker, name, len, RANK_WEIGHT_PRIOR);
+        names++;
+    }
+    fclose(fp);
+    return names;
+}
+
+// Orders the wordlist by what names under this domain (and elsewhere) look like
+static void rank_wordlist(ScanContext *ctx) {
+    const ScanConfig *cfg = &ctx->config;
+    ranker_init(&ctx->ranker);
+    if(cfg->no_rank) {
+        ranker_build(&ctx->ranker, ctx->wordlist);
+        return;
+    }
+    phase_event(ctx, SCAN_EVENT_PHASE_START, SCAN_PHASE_RANK, 1);
+
+    for(size_t i = 0; i < ctx->results.count; i++) {
+        const SubdomainResult *r = &ctx->results.records[i];
+        if(!r->found) continue;
+        learn_name(ctx, r->subdomain, r->name_len, RANK_WEIGHT_TARGET);
+        ctx->words.rank_known++;
+    }
+
+    if(cfg->index_file) {
+        NameIndex ix;
+        const char *error = NULL;
+        if(name_index_open(&ix, cfg->index_file, &error)) {
+            for(size_t i = 0; i < ix.count; i++) {
+                char name[MAX_NAME_LEN + 1];
+                const NameIndexRecord *rec = &ix.records[i];
+                const char *key = name_index_key(&ix, rec);
+                size_t len = key ? reverse_labels(name, sizeof(name), key, rec->key_len) : 0;
+                if(len) learn_name(ctx, name, len, RANK_WEIGHT_PRIOR);
+            }
+            ctx->words.rank_prior += ix.count;
+            name_index_close(&ix);
+        }
+    }
+    if(cfg->prior_file) ctx->words.rank_prior += learn_prior_file(ctx, cfg->prior_file);
+
+    if(!ranker_build(&ctx->ranker, ctx->wordlist)) {
+        warn(ctx, SCAN_PHASE_RANK, "Out of memory while ranking, probing in file order");
+        ranker_free(&ctx->ranker);
+        ranker_init(&ctx->ranker);
+        ranker_build(&ctx->ranker, ctx->wordlist);
+        phase_event(ctx, SCAN_EVENT_PHASE_END, SCAN_PHASE_RANK, 0);
+        return;
+    }
+    phase_event(ctx, SCAN_EVENT_PHASE_END, SCAN_PHASE_RANK, 1);
+}
+
+// ========== WORDLIST SCAN ==========
+typedef struct {
+    ScanContext *ctx;
+    const unsigned char *skip;
+    const char *probed;            // Host whose certificate is being read
+} ProbeState;
+
+// Hands out words in ranked order; *index becomes the word index
+static const char *probe_candidate(size_t *index, char *buf, size_t cap, void *userdata) {
+    ProbeState *state = (ProbeState *)userdata;
+    ScanContext *ctx = state->ctx;
+    size_t word_index;
+    if(!ranker_next(&ctx->ranker, &word_index)) return NULL;
+    *index = word_index;
+
+    if(journal_is_done(&ctx->journal, word_index)) return NULL;
+    if(state->skip && (state->skip[word_index / 8] & (1 << (word_index % 8)))) return NULL;
+
+    char word_buf[WORDLIST_MAX_WORD_LEN + 1];
+    size_t word_len;
+    const char *word = wordlist_word(ctx->wordlist, word_index, word_buf, &word_len);
+
+    int n = snprintf(buf, cap, "%.*s.%s", (int)word_len, word, ctx->target.domain);
+    if(n <= 0 || (size_t)n >= cap) return NULL;
+
+    // Certificate Transparency (or a certificate seen while probing) already vouches for this name
+    const SubdomainResult *r = result_store_find(&ctx->results, buf);
+    if(r && (r->sources & (SOURCE_CT | SOURCE_TLS))) {
+        ctx->words.known++;
+        return NULL;
+    }
+
+    // An earlier run's answer that has not expired yet
+    const ProbeCacheEntry *e = probe_cache_get(&ctx->probe_cache, buf, time(NULL));
+    if(e && (e->found ? ctx->config.probe_ttl : ctx->config.negative_ttl) > 0) {
+        add_result(ctx, buf, e->found, NULL, e->http_status, SOURCE_HTTP);
+        ctx->words.cached++;
+        ctx->words.cached_found += e->found;
+        return NULL;
+    }
+    return buf;
+}
+
+static void on_certificate_name(const char *text, size_t len, void *userdata) {
+    ProbeState *state = (ProbeState *)userdata;
+    ScanContext *ctx = state->ctx;
+    char name[MAX_NAME_LEN + 1];
+    if(normalize_name(name, sizeof(name), text, len) == 0) return;
+    if(strcmp(name, state->probed) == 0) return;  // The probe itself decides about this one
+
+    if(add_result(ctx, name, 1, NULL, 0, SOURCE_TLS)) {
+        ctx->words.san_names++;
+        ScanEvent ev = { .kind = SCAN_EVENT_CERT_NAME, .phase = SCAN_PHASE_PROBE, .ok = 1,
+                         .name = name, .host = state->probed };
+        emit(ctx, &ev);
+    }
+}
+
+// Siblings named in the certificate come with the handshake we already paid for
+static void harvest_certificate(ProbeState *state, const char *host, const ProbeResult *res) {
+    ScanContext *ctx = state->ctx;
+    if(!res->cert_san && !res->cert_subject) return;
+    ctx->words.certificates++;
+    state->probed = host;
+    if(res->cert_san) domain_scan(&ctx->target, res->cert_san, strlen(res->cert_san), on_certificate_name, state);
+    if(res->cert_subject) domain_scan(&ctx->target, res->cert_subject, strlen(res->cert_subject), on_certificate_name, state);
+}
+
+static void on_probe_done(size_t index, const char *host, const ProbeResult *res, void *userdata) {
+    ProbeState *state = (ProbeState *)userdata;
+    ScanContext *ctx = state->ctx;
+    int catch_all = wildcard_match_http(&ctx->wildcard, host, res);
+    int found = res->code == CURLE_OK && res->http_status < 400 && !catch_all;
+    ctx->words.tested++;
+
+    if(!journal_probe(&ctx->journal, index, host, found, (int)res->http_status)) {
+        warn(ctx, SCAN_PHASE_PROBE, "Could not write to the scan journal");
+    }
+
+    if(catch_all) {
+        add_result(ctx, host, 0, NULL, res->http_status, SOURCE_HTTP);
+        ctx->wildcard.http_filtered++;
+    } else if(res->code == CURLE_OK) {
+        add_result(ctx, host, found, NULL, res->http_status, SOURCE_HTTP);
+        if(found) {
+            phase_hit(&ctx->probe_phase);
+            ctx->words.found++;
+        }
+    } else {
+        add_result(ctx, host, 0, NULL, 0, SOURCE_HTTP);
+    }
+
+    ScanEvent ev = { .kind = SCAN_EVENT_PROBE, .phase = SCAN_PHASE_PROBE, .ok = 1, .name = host,
+                     .probe = res, .found = found, .catch_all = catch_all };
+    emit(ctx, &ev);
+    harvest_certificate(state, host, res);
+
+    // Transport errors and catch-all answers say nothing lasting about the name
+    long ttl = found ? ctx->config.probe_ttl : ctx->config.negative_ttl;
+    if(res->code == CURLE_OK && !catch_all && ttl > 0) {
+        probe_cache_put(&ctx->probe_cache, host, found, (int)res->http_status, time(NULL) + ttl);
+    }
+}
+
+static void on_probe_replayed(size_t index, const char *name, int found, int http_status, void *userdata) {
+    ScanContext *ctx = (ScanContext *)userdata;
+    (void)index;
+    add_result(ctx, name, found, NULL, http_status, SOURCE_HTTP);
+    ctx->words.replayed_found += found;
+}
+
+// Opens (or resumes) the journal; returns 0 if the scan must not start
+static int open_journal(ScanContext *ctx) {
+    const ScanConfig *cfg = &ctx->config;
+    if(cfg->journal_file) {
+        snprintf(ctx->journal_path, sizeof(ctx->journal_path), "%s", cfg->journal_file);
+    } else {
+        snprintf(ctx->journal_path, sizeof(ctx->journal_path), "%s%s", ctx->target.domain, SCAN_JOURNAL_SUFFIX);
+    }
+
+    const char *error = NULL;
+    if(!journal_open(&ctx->journal, ctx->journal_path, ctx->target.domain, ctx->wordlist->count,
+                     wordlist_fingerprint(ctx->wordlist), cfg->resume, on_probe_replayed, ctx, &error)) {
+        return fail(ctx, SCAN_PHASE_WORDLIST, "Journal %s: %s", ctx->journal_path, error);
+    }
+    return 1;
+}
+
+int scan_wordlist(ScanContext *ctx, const Wordlist *wordlist) {
+    const ScanConfig *cfg = &ctx->config;
+    ScanEngine *e = ctx->engine;
+    memset(&ctx->words, 0, sizeof(ctx->words));
+    ctx->wordlist = wordlist;
+    phase_event(ctx, SCAN_EVENT_PHASE_START, SCAN_PHASE_WORDLIST, 1);
+
+    calibrate_wildcards(ctx);
+
+    // Without DNS to tell names apart, a catch-all makes every probe look the same
+    if(ctx->wildcard.http && !cfg->resolver && !cfg->wildcard_probe) {
+        ctx->words.catch_all_skip = 1;
+        return fail(ctx, SCAN_PHASE_WORDLIST, "Every name would hit the catch-all");
+    }
+
+    if(!open_journal(ctx)) return 0;
+
+    unsigned char *skip = cfg->resolver ? prefilter_wordlist(ctx) : NULL;
+    ProbeState state = { ctx, skip, NULL };
+    for(size_t i = 0; i < wordlist->count; i++) {
+        if(journal_is_done(&ctx->journal, i)) continue;
+        if(!skip || !(skip[i / 8] & (1 << (i % 8)))) ctx->words.candidates++;
+    }
+    rank_wordlist(ctx);
+
+    if(cfg->ct_cache_dir && !probe_cache_load(&ctx->probe_cache, cfg->ct_cache_dir, ctx->target.domain,
+                                              ctx->words.candidates, time(NULL))) {
+        warn(ctx, SCAN_PHASE_PROBE, "Could not set up the probe cache, probing every candidate");
+    }
+
+    phase_event(ctx, SCAN_EVENT_PHASE_START, SCAN_PHASE_PROBE, 1);
+    ProbeConfig probe = {
+        .http = &e->http,
+        .deadline = &e->deadline,
+        .max_parallel = cfg->parallel,
+        .stop = &ctx->stop,
+        .metrics = metrics_phase(&e->metrics, "probe"),
+        .certinfo = 1,
+    };
+    int ok = probe_run(&probe, &e->bucket, &ctx->probe_phase, wordlist->count,
+                       probe_candidate, on_probe_done, &state);
+    if(ok) {
+        phase_event(ctx, SCAN_EVENT_PHASE_END, SCAN_PHASE_PROBE, 1);
+    } else {
+        fail(ctx, SCAN_PHASE_PROBE, "Could not start the probe engine");
+    }
+    free(skip);
+    ranker_free(&ctx->ranker);
+
+    // Nothing was probed if the engine never started, so there is nothing to save
+    if(ok && cfg->ct_cache_dir && ctx->probe_cache.slots &&
+       !probe_cache_save(&ctx->probe_cache, cfg->ct_cache_dir, ctx->target.domain, time(NULL))) {
+        warn(ctx, SCAN_PHASE_WORDLIST, "Could not save the probe cache in %s", cfg->ct_cache_dir);
+    }
+    probe_cache_free(&ctx->probe_cache);
+
+    ctx->words.completed = ctx->journal.completed;
+    ctx->words.interrupted = ctx->stop != 0;
+    journal_close(&ctx->journal);
+    phase_event(ctx, SCAN_EVENT_PHASE_END, SCAN_PHASE_WORDLIST, ok);
+    return ok;
+}
+
+// ========== NAME INDEX ==========
+int scan_update_index(ScanContext *ctx) {
+    const char *path = ctx->config.index_file;
+    if(!path) return 1;
+    phase_event(ctx, SCAN_EVENT_PHASE_START, SCAN_PHASE_INDEX, 1);
+
+    const char *error = NULL;
+    if(!name_index_merge(path, &ctx->results, time(NULL), &ctx->index_added, &error)) {
+        return fail(ctx, SCAN_PHASE_INDEX, "Could not update index %s: %s", path, error);
+    }
+    phase_event(ctx, SCAN_EVENT_PHASE_END, SCAN_PHASE_INDEX, 1);
+    return 1;
+}
+
+// ========== NETWORKS ==========
+static int compare_network_key(const void *a, const void *b) {
+    const ScanNetwork *x = (const ScanNetwork *)a, *y = (const ScanNetwork *)b;
+    if(x->asn != y->asn) return x->asn < y->asn ? -1 : 1;
+    uintptr_t p = (uintptr_t)x->org, q = (uintptr_t)y->org;  // One string per network in the database
+    return (p > q) - (p < q);
+}
+
+static int compare_network_size(const void *a, const void *b) {
+    const ScanNetwork *x = (const ScanNetwork *)a, *y = (const ScanNetwork *)b;
+    if(x->found != y->found) return x->found > y->found ? -1 : 1;
+    if(x->names != y->names) return x->names > y->names ? -1 : 1;
+    return (x->asn > y->asn) - (x->asn < y->asn);
+}
+
+// Groups every record with a known network, most live names first; the
+// caller frees *networks. Returns the number of groups.
+size_t scan_networks(const ScanContext *ctx, ScanNetwork **networks) {
+    const ResultStore *results = &ctx->results;
+    size_t count = 0;
+    *networks = NULL;
+
+    for(size_t i = 0; i < results->count; i++) {
+        if(results->records[i].asn) count++;
+    }
+    if(count == 0) return 0;
+
+    ScanNetwork *groups = malloc(count * sizeof(ScanNetwork));
+    if(!groups) return 0;
+    count = 0;
+    for(size_t i = 0; i < results->count; i++) {
+        const SubdomainResult *r = &results->records[i];
+        if(r->asn) groups[count++] = (ScanNetwork){ r->asn, r->org, 1, r->found };
+    }
+
+    qsort(groups, count, sizeof(ScanNetwork), compare_network_key);
+    size_t out = 0;
+    for(size_t i = 0; i < count; i++) {
+        if(out && compare_network_key(&groups[out - 1], &groups[i]) == 0) {
+            groups[out - 1].names++;
+            groups[out - 1].found += groups[i].found;
+        } else {
+            groups[out++] = groups[i];
+        }
+    }
+    qsort(groups, out, sizeof(ScanNetwork), compare_network_size);
+
+    *networks = groups;
+    return out;
+}
+
+// Every configured phase in order, without asking anyone; stops early only
+// when the Tor check fails, since nothing may then be sent
+int scan_run(ScanContext *ctx) {
+    const ScanConfig *cfg = &ctx->config;
+    if(!cfg->offline && !scan_check_tor(ctx)) return 0;
+
+    int ok = scan_passive(ctx);
+    if(!cfg->offline) {
+        ok = scan_resolve(ctx) && ok;
+        if(cfg->wordlist && !ctx->stop) ok = scan_wordlist(ctx, cfg->wordlist) && ok;
+    }
+    return scan_update_index(ctx) && ok;
+}
@@ -0,0 +1,226 @@
+/*
+ * scan.h - Reentrant scan engine behind the command-line tool (libshadowscan)
+ * A ScanContext holds everything one scan of one domain needs; a ScanEngine
+ * holds what is worth keeping between scans: curl's DNS and TLS session
+ * caches, the request budget, the learned probe deadlines, latency
+ * metrics and the outcome of the Tor check. Several scans in one process
+ * can reuse one engine and skip those cold-start costs. Phases are chosen
+ * by the caller instead of prompted for, and every record and phase
+ * transition is reported through callbacks; nothing here prints.
+ */
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stddef.h>
+#include <signal.h>
+#include <pthread.h>
+#include "result_store.h"
+#include "domain_match.h"
+#include "resolver.h"
+#include "rate.h"
+#include "http_client.h"
+#include "metrics.h"
+#include "deadline.h"
+#include "passive.h"
+#include "probe_engine.h"
+#include "wildcard.h"
+#include "rank.h"
+#include "journal.h"
+#include "probe_cache.h"
+#include "wordlist.h"
+#include "asn.h"
+
+// ========== CONFIGURATION ==========
+#define SCAN_DEFAULT_INDEX        "shadowscan.idx"
+#define SCAN_DEFAULT_CACHE_DIR    ".shadowscan-cache"
+#define SCAN_DEFAULT_CT_TTL       (12 * 3600)       // Reuse crt.sh answers for 12 hours
+#define SCAN_DEFAULT_PROBE_TTL    (24 * 3600)       // Live probe outcomes are trusted for a day
+#define SCAN_DEFAULT_NEGATIVE_TTL (7 * 24 * 3600)   // Dead ones for a week
+#define SCAN_JOURNAL_SUFFIX       ".journal"        // Default journal: <domain>.journal
+#define SCAN_TIMEOUT_FLOOR_MS     2000   // Adaptive probe deadlines never go below...
+#define SCAN_TIMEOUT_INITIAL_MS   8000   // ...start here until enough answers are seen...
+#define SCAN_TIMEOUT_CEILING_MS   20000  // ...and never exceed this
+#define SCAN_TOR_CHECK_URL        "https://check.torproject.org/api/ip"
+#define SCAN_TOR_CHECK_ATTEMPTS   5
+#define SCAN_TOR_BACKOFF_MS       1000   // First retry delay, doubled after each failure
+#define SCAN_TOR_BACKOFF_MAX_MS   8000
+#define SCAN_TEXT_LEN             320    // Formatted warnings and errors
+
+// ========== STRUCTURES ==========
+// Shared by every scan that runs through it. Scans on different threads
+// run their phases at the same time and split one request budget; only
+// the Tor check is serialized, so the proxy is verified once
+typedef struct {
+    HttpClient http;               // DNS and TLS session caches (connections are per phase)
+    TokenBucket bucket;            // Paces every request sent through the proxy
+    int requests_per_minute;
+    AdaptiveDeadline deadline;     // Probe deadlines learned so far
+    Metrics metrics;               // Request timing, cumulative across scans
+    pthread_mutex_t lock;          // Held around each Tor check request, never while backing off
+    int tor_verified;              // The proxy already passed the Tor check
+} ScanEngine;
+
+typedef enum {
+    SCAN_PHASE_TOR_CHECK,
+    SCAN_PHASE_PASSIVE,            // crt.sh and every local source at once
+    SCAN_PHASE_RESOLVE,            // Addresses for certificate names
+    SCAN_PHASE_WORDLIST,           // Encloses the four phases below
+    SCAN_PHASE_CALIBRATION,        // Wildcard DNS and catch-all detection
+    SCAN_PHASE_PREFILTER,          // DNS pruning of wordlist candidates
+    SCAN_PHASE_RANK,
+    SCAN_PHASE_PROBE,
+    SCAN_PHASE_INDEX               // Merge into the persistent name index
+} ScanPhase;
+
+typedef enum {
+    SCAN_EVENT_PHASE_START,
+    SCAN_EVENT_PHASE_END,          // `ok`: the phase did its work
+    SCAN_EVENT_TOR_RETRY,          // A Tor check attempt failed
+    SCAN_EVENT_NAME,               // A passive source reported a new name
+    SCAN_EVENT_PROBE,              // A wordlist probe finished
+    SCAN_EVENT_CERT_NAME,          // A probed host's certificate named a new sibling
+    SCAN_EVENT_WARNING             // Something went wrong but the scan goes on
+} ScanEventKind;
+
+typedef struct {
+    ScanEventKind kind;
+    ScanPhase phase;
+    int ok;
+    const char *name;              // NAME, PROBE, CERT_NAME
+    const char *host;              // CERT_NAME: the host whose certificate it was
+    const PassiveName *passive;    // NAME: sources and certificate validity
+    const ProbeResult *probe;      // PROBE
+    int found;                     // PROBE: counts as a live subdomain
+    int catch_all;                 // PROBE: answered like the wildcard calibration
+    int attempt;                   // TOR_RETRY: 1-based
+    long backoff_ms;               // TOR_RETRY: wait before the next attempt, 0 = none left
+    const char *message;           // TOR_RETRY, WARNING
+} ScanEvent;
+
+typedef struct ScanContext ScanContext;
+
+// Both run on the thread that called the phase function
+typedef void (*ScanResultFn)(ScanContext *ctx, const SubdomainResult *r, void *userdata);
+typedef void (*ScanEventFn)(ScanContext *ctx, const ScanEvent *ev, void *userdata);
+
+typedef struct {
+    const char *domain;
+    const Wordlist *wordlist;      // scan_run's wordlist phase; NULL = skip it
+    int offline;                   // Skip Tor, crt.sh, DNS and probing
+    const char *const *ingest_files;    // Passive-DNS dumps
+    int ingest_count;
+    const char *const *ct_files;   // Saved crt.sh JSON answers
+    int ct_file_count;
+    const char *const *ct_log_files;    // Mirrored CT log get-entries batches
+    int ct_log_count;
+    const char *const *zone_files;  // RFC 1035 master files
+    int zone_count;
+    int from_index;                // Seed results with names from earlier runs
+    int threads;                   // Ingest, CT log and zone parse threads, 0 = one per CPU
+    const char *index_file;        // Persistent name index, NULL = disabled
+    const char *ct_cache_dir;      // crt.sh snapshot and probe cache directory, NULL = disabled
+    long ct_ttl;                   // Seconds a snapshot stays fresh, 0 = always refetch
+    long probe_ttl;                // Seconds a live probe outcome is reused, 0 = never
+    long negative_ttl;             // Same for names that did not answer with < 400
+    int delta;                     // Only report CT names missing from the last snapshot (all are stored)
+    const char *resolver;          // DNS upstream "host[:port]", NULL = no DNS stage
+    int dns_inflight;              // Concurrent DNS queries
+    int parallel;                  // Concurrent HTTPS probes
+    const char *journal_file;      // Checkpoint journal, NULL = <domain>.journal
+    int resume;                    // Continue the scan recorded in the journal
+    int wildcard_probe;            // Probe even when a catch-all answers every name
+    int no_rank;                   // Probe in wordlist file order
+    const char *prior_file;        // Extra names/labels to learn label statistics from
+    const AsnDb *asn;              // Tags resolved addresses with their network, NULL = off;
+                                   // records point into it, so it must outlive the scan
+    ScanResultFn on_result;        // Every new or changed record
+    ScanEventFn on_event;
+    void *userdata;
+} ScanConfig;
+
+typedef struct {
+    size_t candidates;             // Words left after the journal and DNS
+    size_t tested;
+    size_t found;
+    size_t known;                  // Skipped: already known from CT
+    size_t cached;                 // Answered from the probe cache
+    size_t cached_found;
+    size_t certificates;           // Leaf certificates read during probes
+    size_t san_names;              // New names they contributed
+    size_t replayed_found;         // Found by the journalled part of a resumed scan
+    size_t completed;              // Words the journal records as done, earlier runs included
+    size_t rank_known;             // Names the ranker learned from this scan...
+    size_t rank_prior;             // ...and from the index and prior corpus
+    int catch_all_skip;            // Not probed: every name would hit the catch-all
+    int interrupted;               // scan_stop() ended the probes early
+} WordlistStats;
+
+// Records grouped by the network their address belongs to (scan_networks)
+typedef struct {
+    uint32_t asn;
+    const char *org;
+    size_t names;                  // Records with an address in this network
+    size_t found;                  // ...of which are live
+} ScanNetwork;
+
+struct ScanContext {
+    ScanEngine *engine;
+    ScanConfig config;
+    DomainMatcher target;
+    ResolverConfig resolver;
+    ResultStore results;
+    double started_ms;             // Monotonic, for the summary duration
+    volatile sig_atomic_t stop;
+    const char *error;             // Why the last phase failed
+    char text[SCAN_TEXT_LEN];      // Backs `error` and warning messages
+
+    // Per-phase request statistics
+    PhaseStats ct_phase;
+    PhaseStats calibration_phase;
+    PhaseStats probe_phase;
+
+    // Passive phase
+    PassiveSource sources[PASSIVE_MAX_SOURCES];
+    int source_count;
+    int online;                    // crt.sh is among the sources
+    size_t passive_unique;         // Names new to this scan (in delta mode, not known from the snapshot)
+    size_t passive_merged;         // Seen before, from another source or an earlier phase
+    double passive_seconds;
+
+    // DNS stages: certificate names, then wordlist candidates
+    ResolveStats dns_stats;
+
+    // Wordlist phase
+    const Wordlist *wordlist;
+    WildcardProfile wildcard;
+    Ranker ranker;
+    Journal journal;
+    char journal_path[300];
+    ProbeCache probe_cache;        // Probe outcomes of earlier runs
+    WordlistStats words;
+
+    size_t index_added;            // New names merged into the index
+};
+
+// ========== FUNCTION PROTOTYPES ==========
+int scan_engine_init(ScanEngine *e, const char *proxy, const char *user_agent,
+                     int per_minute, int min_delay_ms, int max_delay_ms);
+void scan_engine_free(ScanEngine *e);
+
+void scan_config_init(ScanConfig *cfg, const char *domain);
+int scan_init(ScanContext *ctx, ScanEngine *engine, const ScanConfig *cfg);
+
+// A context is driven by one thread at a time; a phase that is not configured
+// (no resolver, no index, no sources) returns 1 without events
+int scan_check_tor(ScanContext *ctx);
+int scan_passive(ScanContext *ctx);
+int scan_resolve(ScanContext *ctx);
+int scan_wordlist(ScanContext *ctx, const Wordlist *wordlist);
+int scan_update_index(ScanContext *ctx);
+int scan_run(ScanContext *ctx);
+void scan_stop(ScanContext *ctx);
+size_t scan_networks(const ScanContext *ctx, ScanNetwork **networks);
+void scan_free(ScanContext *ctx);
+
+#endif
@@ -1,7 +1,9 @@
 /*
- * EDUCATIONAL-DNS-WORDLIST.c - With Wordlist Support
- * Features: Wordlist input, rate limiting, Tor, color output
- * Compile: gcc educational_dns_wordlist.c -o learn_dns -lcurl
+ * shadowscan.c - With Wordlist Support
+ * Features: Wordlist input, rate limiting, Tor, color output, streaming CT parsing
+ * Command-line front end of the scan engine in scan.c: parses options,
+ * loads the wordlist, asks before probing and renders the engine's events.
+ * Compile: gcc *.c -o subdomainscanner -lcurl -lpthread -lz
  */
 
 #include <stdio.h>
@@ -10,16 +12,25 @@
 #include <curl/curl.h>
 #include <unistd.h>
 #include <time.h>
+#include <getopt.h>
+#include <signal.h>
+#include <pthread.h>
+#include "scan.h"
+#include "name_index.h"
+#include "result_writer.h"
+#include "console.h"
 
 // ========== CONFIGURATION ==========
 #define TOR_PROXY "socks5://127.0.0.1:9050"
 #define USER_AGENT "EducationalDNS/1.0"
-#define RESULTS_FILE "found_subdomains.txt"
+#define DEFAULT_OUTPUT_FORMAT "csv"  // Writes found_subdomains.txt
 #define REQUESTS_PER_MINUTE 12     // Conservative rate limit
 #define MIN_DELAY_MS 4000          // 4 seconds minimum
 #define MAX_DELAY_MS 8000          // 8 seconds maximum
 #define MAX_WORDLIST_SIZE 100000   // Max 100K words
 #define DEFAULT_WORDLIST "common_subdomains.txt"
+#define MAX_INGEST_FILES PASSIVE_MAX_FILES  // --ingest / --ct-file / --ct-log / --zone may each be given this many times
+#define SUMMARY_NETWORKS 10        // Networks listed in the summary with --asn
 
 // ========== COLOR CODES ==========
 #define COLOR_RESET   "\033[0m"
@@ -33,37 +44,62 @@
 
 // ========== STRUCTURES ==========
 typedef struct {
-    char *data;
-    size_t size;
-} ResponseBuffer;
+    const char *requested;         // Path given on the command line
+    const char *filename;          // Path actually loaded
+    Wordlist *wordlist;
+    size_t max_words;
+    int missing;                   // Requested file could not be opened
+    int created_default;           // DEFAULT_WORDLIST was written instead
+    int ok;
+    pthread_t thread;
+    int started;                   // Loading on `thread`, not joined yet
+} WordlistLoad;
 
+// Everything the command line adds on top of the engine
 typedef struct {
-    char subdomain[256];
-    int found;
-    char ip[46];
-    int http_status;
-} SubdomainResult;
-
-// ========== GLOBAL VARIABLES ==========
-SubdomainResult *results = NULL;
-int result_count = 0;
-int total_requests_made = 0;
-time_t scan_start_time;
-char **wordlist = NULL;
-int wordlist_size = 0;
+    size_t max_words;              // 0 = no limit
+    const char *compile_wordlist;  // Write a compiled wordlist here and exit
+    const char *ingest_files[MAX_INGEST_FILES];
+    const char *ct_files[MAX_INGEST_FILES];
+    const char *ct_log_files[MAX_INGEST_FILES];
+    const char *zone_files[MAX_INGEST_FILES];
+    const char *query;             // Print indexed names under this suffix and exit
+    const char *output_file;       // NULL = the format's default file name
+    const char *output_format;     // csv, jsonl or bin
+    int keep_negatives;            // Also stream names that were not found
+    const char *metrics_file;      // Prometheus text file, rewritten while scanning
+    const char *metrics_json;      // JSON latency summary written at exit
+    int quiet;                     // No per-result lines or progress on the terminal
+    const char *json_log;          // One JSON event per name and probe
+    int yes;                       // Start the wordlist scan without asking
+    const char *asn_file;          // IP-to-ASN dataset (iptoasn TSV/CSV or compiled)
+    const char *compile_asn;       // Write a compiled ASN database here and exit
+    
+    Wordlist wordlist;
+    AsnDb asn;
+    Console console;               // Hot-path output, rendered on its own thread
+    FILE *event_log;
+    ResultWriter writer;
+    const char *output_path;
+    int output_failed;             // The write error has been reported
+    struct sigaction old_sigint;   // Restored when the probes end
+} Cli;
+
+// The scan a first Ctrl+C stops; the handler cannot be given it any other way
+static ScanContext *interrupt_target;
 
 // ========== FUNCTION PROTOTYPES ==========
 void print_banner();
-int load_wordlist(const char *filename);
-void rate_limit(int request_num);
-size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp);
-void add_result(const char *subdomain, int found, const char *ip, int http_status);
-void save_results();
-int check_tor_connection();
-void query_certificate_transparency(const char *domain);
-void scan_with_wordlist(const char *domain);
-void print_summary();
-void free_resources();
+int load_wordlist(Cli *cli, const char *filename);
+void start_wordlist_load(Cli *cli, WordlistLoad *load, const char *filename);
+int finish_wordlist_load(WordlistLoad *load, int report);
+int load_asn(Cli *cli, const char *filename);
+int open_output(Cli *cli, const char *domain, int resume);
+void close_output(Cli *cli);
+void print_summary(Cli *cli, const ScanContext *scan);
+void finish_metrics(Cli *cli, ScanEngine *engine, const char *domain);
+int query_index(const char *path, const char *suffix);
+void free_cli(Cli *cli);
 
 // ========== PRINT BANNER ==========
 void print_banner() {
@@ -77,484 +113,900 @@ void print_banner() {
 }
 
 // ========== LOAD WORDLIST ==========
-int load_wordlist(const char *filename) {
-    printf("%s[*] Loading wordlist: %s%s\n", COLOR_YELLOW, filename, COLOR_RESET);
+// Common subdomains, written out when the requested wordlist is missing
+static const char *default_words[] = {
+    "www", "mail", "webmail", "smtp", "pop", "imap", "ftp",
+    "api", "dev", "test", "staging", "prod", "beta", "alpha",
+    "admin", "dashboard", "portal", "login", "secure", "auth",
+    "blog", "news", "forum", "community", "support", "help",
+    "shop", "store", "cart", "payment", "checkout",
+    "app", "mobile", "m", "cdn", "static", "assets", "media",
+    "docs", "wiki", "status", "monitor", "metrics", "stats",
+    "git", "svn", "jenkins", "ci", "build", "deploy",
+    "db", "sql", "mysql", "postgres", "mongo", "redis",
+    "vpn", "remote", "proxy", "cache", "loadbalancer",
+    "internal", "intranet", "private", "local", "home",
+    "mail2", "web", "ns1", "ns2", "dns", "mx", "mx1",
+    "old", "new", "legacy", "archive", "backup",
+    "cloud", "aws", "azure", "google", "digitalocean",
+    "test1", "test2", "demo", "stage", "preprod",
+    "secure2", "admin2", "portal2", "web2", "app2",
+    NULL
+};
+
+// Opens (creating the default list if needed) and maps the wordlist
+// without printing, so it can run on its own thread during startup
+static void *prepare_wordlist(void *arg) {
+    WordlistLoad *load = (WordlistLoad *)arg;
+    load->ok = 0;
     
-    FILE *file = fopen(filename, "r");
+    FILE *file = fopen(load->filename, "r");
     if(!file) {
-        printf(COLOR_RED "[!] Cannot open wordlist: %s\n" COLOR_RESET, filename);
-        
-        // Try to create default wordlist
-        printf("%s[*] Creating default wordlist...%s\n", COLOR_YELLOW, COLOR_RESET);
+        load->missing = 1;
         file = fopen(DEFAULT_WORDLIST, "w");
-        if(file) {
-            // Common subdomains
-            const char *default_words[] = {
-                "www", "mail", "webmail", "smtp", "pop", "imap", "ftp",
-                "api", "dev", "test", "staging", "prod", "beta", "alpha",
-                "admin", "dashboard", "portal", "login", "secure", "auth",
-                "blog", "news", "forum", "community", "support", "help",
-                "shop", "store", "cart", "payment", "checkout",
-                "app", "mobile", "m", "cdn", "static", "assets", "media",
-                "docs", "wiki", "status", "monitor", "metrics", "stats",
-                "git", "svn", "jenkins", "ci", "build", "deploy",
-                "db", "sql", "mysql", "postgres", "mongo", "redis",
-                "vpn", "remote", "proxy", "cache", "loadbalancer",
-                "internal", "intranet", "private", "local", "home",
-                "mail2", "web", "ns1", "ns2", "dns", "mx", "mx1",
-                "old", "new", "legacy", "archive", "backup",
-                "cloud", "aws", "azure", "google", "digitalocean",
-                "test1", "test2", "demo", "stage", "preprod",
-                "secure2", "admin2", "portal2", "web2", "app2",
-                NULL
-            };
-            
-            for(int i = 0; default_words[i] != NULL; i++) {
-                fprintf(file, "%s\n", default_words[i]);
-            }
-            fclose(file);
-            
-            printf(COLOR_GREEN "[✓] Created default wordlist: %s\n" COLOR_RESET, DEFAULT_WORDLIST);
-            printf("%s[*] Contains %d common subdomain patterns%s\n", 
-                   COLOR_BLUE, sizeof(default_words)/sizeof(default_words[0]) - 1, COLOR_RESET);
-            
-            // Now open it
-            file = fopen(DEFAULT_WORDLIST, "r");
-        }
-        
-        if(!file) {
-            printf(COLOR_RED "[!] Could not create or open wordlist\n" COLOR_RESET);
-            return 0;
+        if(!file) return NULL;
+        for(int i = 0; default_words[i] != NULL; i++) {
+            fprintf(file, "%s\n", default_words[i]);
         }
+        fclose(file);
+        load->created_default = 1;
+        load->filename = DEFAULT_WORDLIST;
+        file = fopen(load->filename, "r");
+        if(!file) return NULL;
     }
+    fclose(file);
     
-    // Count lines
-    char buffer[256];
-    int count = 0;
-    while(fgets(buffer, sizeof(buffer), file)) {
-        count++;
+    // Map the file and keep views into it; compiled wordlists are used as-is
+    load->ok = wordlist_load(load->wordlist, load->filename, load->max_words);
+    return NULL;
+}
+
+// Prints what prepare_wordlist did, in the order it happened
+static int report_wordlist(const WordlistLoad *load) {
+    const Wordlist *wl = load->wordlist;
+    printf("%s[*] Loading wordlist: %s%s\n", COLOR_YELLOW, load->requested, COLOR_RESET);
+    if(load->missing) {
+        printf(COLOR_RED "[!] Cannot open wordlist: %s\n" COLOR_RESET, load->requested);
+        printf("%s[*] Creating default wordlist...%s\n", COLOR_YELLOW, COLOR_RESET);
     }
-    
-    if(count == 0) {
-        printf(COLOR_RED "[!] Wordlist is empty\n" COLOR_RESET);
-        fclose(file);
+    if(load->created_default) {
+        printf(COLOR_GREEN "[✓] Created default wordlist: %s\n" COLOR_RESET, DEFAULT_WORDLIST);
+        printf("%s[*] Contains %d common subdomain patterns%s\n",
+               COLOR_BLUE, (int)(sizeof(default_words)/sizeof(default_words[0]) - 1), COLOR_RESET);
+    } else if(load->missing) {
+        printf(COLOR_RED "[!] Could not create or open wordlist\n" COLOR_RESET);
         return 0;
     }
-    
-    // Allocate memory
-    wordlist = malloc(count * sizeof(char*));
-    if(!wordlist) {
-        printf(COLOR_RED "[!] Memory allocation failed\n" COLOR_RESET);
-        fclose(file);
+    if(!load->ok) {
+        printf(COLOR_RED "[!] Cannot load wordlist %s: %s\n" COLOR_RESET, load->filename, wl->error);
         return 0;
     }
     
-    // Read words
-    rewind(file);
-    int i = 0;
-    while(fgets(buffer, sizeof(buffer), file) && i < count) {
-        // Remove newline
-        buffer[strcspn(buffer, "\n")] = 0;
-        
-        // Skip empty lines and comments
-        if(strlen(buffer) == 0 || buffer[0] == '#') {
-            continue;
-        }
-        
-        wordlist[i] = strdup(buffer);
-        if(!wordlist[i]) {
-            printf(COLOR_RED "[!] Failed to duplicate string\n" COLOR_RESET);
-            fclose(file);
-            return 0;
-        }
-        i++;
+    if(wl->binary) {
+        printf(COLOR_GREEN "[✓] Loaded %zu words from compiled wordlist\n" COLOR_RESET, wl->count);
+    } else {
+        printf(COLOR_GREEN "[✓] Loaded %zu words from wordlist (%zu lines)\n" COLOR_RESET,
+               wl->count, wl->lines);
+    }
+    if(wl->duplicates > 0 || wl->invalid > 0) {
+        printf("%s[*] Skipped %zu duplicates and %zu invalid entries%s\n",
+               COLOR_BLUE, wl->duplicates, wl->invalid, COLOR_RESET);
+    }
+    if(wl->truncated > 0) {
+        printf(COLOR_YELLOW "[!] Word limit %zu reached, %zu entries ignored (use --max-words 0)\n" COLOR_RESET,
+               load->max_words, wl->truncated);
     }
-    
-    wordlist_size = i;
-    fclose(file);
-    
-    printf(COLOR_GREEN "[✓] Loaded %d words from wordlist\n" COLOR_RESET, wordlist_size);
     return 1;
 }
 
-// ========== RATE LIMITING ==========
-void rate_limit(int request_num) {
-    total_requests_made++;
-    
-    // Calculate base delay
-    int base_delay_ms = (60 * 1000) / REQUESTS_PER_MINUTE;
-    
-    // Add jitter (±25%)
-    int jitter = (base_delay_ms * 25) / 100;
-    int actual_delay_ms = base_delay_ms + (rand() % (2 * jitter)) - jitter;
-    
-    // Clamp values
-    if(actual_delay_ms < MIN_DELAY_MS) actual_delay_ms = MIN_DELAY_MS;
-    if(actual_delay_ms > MAX_DELAY_MS) actual_delay_ms = MAX_DELAY_MS;
-    
-    // Show delay
-    printf("%s[~] Rate limit: %d.%d sec (req #%d)%s\n", 
-           COLOR_BLUE, 
-           actual_delay_ms / 1000,
-           (actual_delay_ms % 1000) / 100,
-           request_num,
-           COLOR_RESET);
-    
-    // Calculate current rate
-    time_t now = time(NULL);
-    int elapsed = (int)difftime(now, scan_start_time);
-    if(elapsed > 0) {
-        float current_rate = (total_requests_made * 60.0) / elapsed;
-        printf("%s[*] Current rate: %.1f reqs/min%s\n", 
-               COLOR_YELLOW, current_rate, COLOR_RESET);
+int load_wordlist(Cli *cli, const char *filename) {
+    WordlistLoad load = { .requested = filename, .filename = filename,
+                          .wordlist = &cli->wordlist, .max_words = cli->max_words };
+    prepare_wordlist(&load);
+    return report_wordlist(&load);
+}
+
+// Starts loading on a background thread (or inline if no thread can be made)
+void start_wordlist_load(Cli *cli, WordlistLoad *load, const char *filename) {
+    memset(load, 0, sizeof(*load));
+    load->requested = filename;
+    load->filename = filename;
+    load->wordlist = &cli->wordlist;
+    load->max_words = cli->max_words;
+    load->started = pthread_create(&load->thread, NULL, prepare_wordlist, load) == 0;
+    if(!load->started) prepare_wordlist(load);
+}
+
+// Waits for the load to finish; with `report` set, prints its outcome
+int finish_wordlist_load(WordlistLoad *load, int report) {
+    if(load->started) {
+        pthread_join(load->thread, NULL);
+        load->started = 0;
     }
-    
-    // Sleep
-    usleep(actual_delay_ms * 1000);
+    return report ? report_wordlist(load) : load->ok;
 }
 
-// ========== WRITE CALLBACK ==========
-size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    ResponseBuffer *buf = (ResponseBuffer *)userp;
-    
-    char *ptr = realloc(buf->data, buf->size + realsize + 1);
-    if(!ptr) return 0;
-    
-    buf->data = ptr;
-    memcpy(&(buf->data[buf->size]), contents, realsize);
-    buf->size += realsize;
-    buf->data[buf->size] = 0;
+// ========== LOAD ASN DATABASE ==========
+int load_asn(Cli *cli, const char *filename) {
+    AsnDb *db = &cli->asn;
+    double started = monotonic_ms();
     
-    return realsize;
+    if(!asn_load(db, filename)) {
+        printf(COLOR_RED "[!] Cannot load ASN dataset %s: %s\n" COLOR_RESET, filename, db->error);
+        return 0;
+    }
+    printf(COLOR_GREEN "[✓] Loaded %zu IPv4 and %zu IPv6 ranges of %zu networks from %s%s (%.0f ms)\n" COLOR_RESET,
+           db->v4_count, db->v6_count, db->network_count, db->mapped ? "compiled " : "", filename,
+           monotonic_ms() - started);
+    if(db->invalid > 0) {
+        printf("%s[*] Skipped %zu invalid or overlapping rows%s\n", COLOR_BLUE, db->invalid, COLOR_RESET);
+    }
+    return 1;
 }
 
-// ========== ADD RESULT ==========
-void add_result(const char *subdomain, int found, const char *ip, int http_status) {
-    results = realloc(results, (result_count + 1) * sizeof(SubdomainResult));
-    strncpy(results[result_count].subdomain, subdomain, 255);
-    results[result_count].subdomain[255] = '\0';
-    results[result_count].found = found;
-    
-    if(ip) {
-        strncpy(results[result_count].ip, ip, 45);
-        results[result_count].ip[45] = '\0';
-    } else {
-        results[result_count].ip[0] = '\0';
+// ========== RESULT OUTPUT ==========
+int open_output(Cli *cli, const char *domain, int resume) {
+    const OutputFormat *format = output_format_find(cli->output_format);
+    if(!format) {
+        printf(COLOR_RED "[!] Unknown output format: %s (use csv, jsonl or bin)\n" COLOR_RESET,
+               cli->output_format);
+        return 0;
     }
+    cli->output_path = cli->output_file ? cli->output_file : format->default_path;
     
-    results[result_count].http_status = http_status;
-    result_count++;
+    // A resumed scan keeps adding to the stream it started
+    const char *error = NULL;
+    if(!result_writer_open(&cli->writer, cli->output_path, format, domain, resume, &error)) {
+        printf(COLOR_RED "[!] Cannot open %s: %s\n" COLOR_RESET, cli->output_path, error);
+        return 0;
+    }
+    printf("%s[*] Streaming %s results to %s%s\n" COLOR_RESET, COLOR_WHITE, format->name,
+           cli->output_path, cli->keep_negatives ? " (including negatives)" : "");
+    return 1;
 }
 
-// ========== SAVE RESULTS ==========
-void save_results() {
-    FILE *fp = fopen(RESULTS_FILE, "w");
-    if(!fp) {
-        printf(COLOR_RED "[!] Could not save results to file\n" COLOR_RESET);
-        return;
+// Every new or changed record the engine delivers
+static void on_scan_result(ScanContext *scan, const SubdomainResult *r, void *userdata) {
+    Cli *cli = (Cli *)userdata;
+    (void)scan;
+    if(!(r->found || cli->keep_negatives) || result_writer_write(&cli->writer, r)) return;
+    
+    // The writer has stopped taking records; say so now rather than at the end of the scan
+    if(!cli->output_failed) {
+        cli->output_failed = 1;
+        console_printf(&cli->console, CONSOLE_TEXT,
+                       COLOR_RED "[!] Stopped streaming to %s: %s (results are still kept in the summary and index)\n" COLOR_RESET,
+                       cli->output_path, strerror(cli->writer.error));
     }
-    
-    fprintf(fp, "# Educational DNS Scan Results\n");
-    fprintf(fp, "# Date: %s", ctime(&(time_t){time(NULL)}));
-    fprintf(fp, "# Domain: From scan\n");
-    fprintf(fp, "# Wordlist size: %d words\n", wordlist_size);
-    fprintf(fp, "# Rate limit: %d requests/minute\n", REQUESTS_PER_MINUTE);
-    fprintf(fp, "# For educational purposes only\n\n");
-    
-    fprintf(fp, "SUBDOMAIN,STATUS,HTTP_CODE,IP\n");
-    
-    int saved = 0;
-    for(int i = 0; i < result_count; i++) {
-        if(results[i].found) {
-            fprintf(fp, "%s,FOUND,%d,%s\n", 
-                    results[i].subdomain, 
-                    results[i].http_status,
-                    results[i].ip[0] ? results[i].ip : "N/A");
-            saved++;
+}
+
+void close_output(Cli *cli) {
+    if(!result_writer_close(&cli->writer)) {
+        printf(COLOR_RED "[!] Could not write all results to %s: %s\n" COLOR_RESET, cli->output_path,
+               strerror(cli->writer.error));
+    } else if(cli->writer.records > 0) {
+        printf(COLOR_GREEN "\n[✓] Streamed %zu records (%.1f KB) to: %s\n" COLOR_RESET,
+               cli->writer.records, cli->writer.bytes_written / 1024.0, cli->output_path);
+    }
+}
+
+// ========== PER-NAME OUTPUT ==========
+// These run inside the scan's hot paths, so they only hand lines to the console thread
+static void show_passive_name(Cli *cli, const ScanContext *scan, const PassiveName *name) {
+    if(cli->console.events) {
+        char sources[SOURCE_NAMES_LEN];
+        char name_json[JSON_QUOTED_LEN(MAX_NAME_LEN)], sources_json[JSON_QUOTED_LEN(SOURCE_NAMES_LEN)];
+        char before_json[JSON_QUOTED_LEN(PASSIVE_DATE_LEN)], after_json[JSON_QUOTED_LEN(PASSIVE_DATE_LEN)];
+        json_quote(name_json, sizeof(name_json), name->name);
+        json_quote(sources_json, sizeof(sources_json), source_names(name->sources, sources, sizeof(sources)));
+        json_quote(before_json, sizeof(before_json), name->not_before);
+        json_quote(after_json, sizeof(after_json), name->not_after);
+        console_printf(&cli->console, CONSOLE_EVENT,
+                       "{\"event\":\"name\",\"name\":%s,\"sources\":%s,\"not_before\":%s,\"not_after\":%s}\n",
+                       name_json, sources_json, before_json, after_json);
+    }
+    console_progress(&cli->console, "%s[*] Passive: %zu unique names, %zu duplicates merged%s",
+                     COLOR_YELLOW, scan->passive_unique, scan->passive_merged, COLOR_RESET);
+    
+    // Passive-DNS dumps can hold millions of names; only certificate names are listed
+    if(!(name->sources & SOURCE_CT)) return;
+    if(name->not_after[0]) {
+        console_printf(&cli->console, CONSOLE_DETAIL, COLOR_GREEN "  ✓ %s" COLOR_RESET " (valid %s → %s)\n",
+                       name->name, name->not_before[0] ? name->not_before : "?", name->not_after);
+    } else {
+        console_printf(&cli->console, CONSOLE_DETAIL, COLOR_GREEN "  ✓ %s\n" COLOR_RESET, name->name);
+    }
+}
+
+static void show_probe(Cli *cli, const ScanContext *scan, const ScanEvent *ev) {
+    const ProbeResult *res = ev->probe;
+    const char *host = ev->name;
+    int label_len = (int)(strlen(host) - scan->target.len - 1);
+    
+    if(cli->console.events) {
+        char host_json[JSON_QUOTED_LEN(MAX_NAME_LEN)], error_json[JSON_QUOTED_LEN(16)];
+        json_quote(host_json, sizeof(host_json), host);
+        if(res->code == CURLE_OK) {
+            strcpy(error_json, "null");
+        } else {
+            json_quote(error_json, sizeof(error_json), "transport");
         }
+        console_printf(&cli->console, CONSOLE_EVENT,
+                       "{\"event\":\"probe\",\"name\":%s,\"found\":%s,\"http\":%ld,\"ms\":%.0f,\"error\":%s,\"wildcard\":%s}\n",
+                       host_json, ev->found ? "true" : "false", res->http_status, res->latency_ms,
+                       error_json, ev->catch_all ? "true" : "false");
     }
     
-    fclose(fp);
+    if(ev->catch_all) {
+        console_printf(&cli->console, CONSOLE_DETAIL, COLOR_BLUE "  ~ %-25.*s -> HTTP %ld (wildcard response)\n" COLOR_RESET,
+                       label_len, host, res->http_status);
+    } else if(ev->found) {
+        console_printf(&cli->console, CONSOLE_DETAIL, COLOR_GREEN "  ✓ %-25.*s -> HTTP %ld (%.0f ms)\n" COLOR_RESET,
+                       label_len, host, res->http_status, res->latency_ms);
+    } else if(res->code == CURLE_OK) {
+        console_printf(&cli->console, CONSOLE_DETAIL, COLOR_RED "  ✗ %-25.*s -> HTTP %ld\n" COLOR_RESET,
+                       label_len, host, res->http_status);
+    } else {
+        console_printf(&cli->console, CONSOLE_DETAIL, COLOR_RED "  ✗ %-25.*s -> No response\n" COLOR_RESET, label_len, host);
+    }
     
-    if(saved > 0) {
-        printf(COLOR_GREEN "\n[✓] Saved %d subdomains to: %s\n" COLOR_RESET, 
-               saved, RESULTS_FILE);
+    // Redrawn in place by the console thread at a fixed rate
+    const WordlistStats *w = &scan->words;
+    console_progress(&cli->console, "%s[*] Progress: %zu/%zu (%zu%%) | Found: %zu | Rate: %.1f reqs/min | Time: %.0f sec" COLOR_RESET,
+                     COLOR_YELLOW, w->tested, w->candidates,
+                     w->tested * 100 / (w->candidates ? w->candidates : 1),
+                     w->found, phase_rate_per_min(&scan->probe_phase), phase_elapsed_sec(&scan->probe_phase));
+}
+
+static void show_certificate_name(Cli *cli, const ScanEvent *ev) {
+    console_printf(&cli->console, CONSOLE_DETAIL, COLOR_GREEN "  + %s (certificate of %s)\n" COLOR_RESET, ev->name, ev->host);
+    if(cli->console.events) {
+        char name_json[JSON_QUOTED_LEN(MAX_NAME_LEN)], host_json[JSON_QUOTED_LEN(MAX_NAME_LEN)];
+        json_quote(name_json, sizeof(name_json), ev->name);
+        json_quote(host_json, sizeof(host_json), ev->host);
+        console_printf(&cli->console, CONSOLE_EVENT, "{\"event\":\"tls_san\",\"name\":%s,\"host\":%s}\n",
+                       name_json, host_json);
     }
 }
 
-// ========== CHECK TOR ==========
-int check_tor_connection() {
-    printf("%s[*] Verifying Tor connection...%s\n", COLOR_YELLOW, COLOR_RESET);
-    
-    CURL *curl = curl_easy_init();
-    if(!curl) return 0;
-    
-    ResponseBuffer response = {0};
-    
-    curl_easy_setopt(curl, CURLOPT_URL, "https://check.torproject.org/api/ip");
-    curl_easy_setopt(curl, CURLOPT_PROXY, TOR_PROXY);
-    curl_easy_setopt(curl, CURLOPT_PROXYTYPE, CURLPROXY_SOCKS5);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
-    
-    CURLcode res = curl_easy_perform(curl);
-    
-    int tor_active = 0;
-    if(res == CURLE_OK && response.data) {
-        if(strstr(response.data, "true") != NULL) {
-            printf(COLOR_GREEN "[✓] Tor connection: ACTIVE\n" COLOR_RESET);
-            tor_active = 1;
-        }
+// ========== PHASE OUTPUT ==========
+static void on_interrupt(int sig) {
+    (void)sig;
+    if(interrupt_target) scan_stop(interrupt_target);
+}
+
+static void print_source(const PassiveSource *s) {
+    if(s->ok) {
+        printf(COLOR_GREEN "[✓] %-12s %zu names in %.2f sec" COLOR_RESET "%s%s%s%s%s\n",
+               s->name, s->names, s->seconds,
+               s->path ? " from " : "", s->path ? s->path : "",
+               s->note[0] ? " (" : "", s->note, s->note[0] ? ")" : "");
     } else {
-        printf(COLOR_RED "[!] Tor error: %s\n" COLOR_RESET, curl_easy_strerror(res));
+        printf(COLOR_RED "[✗] %-12s failed after %.2f sec: %s%s%s (%zu names kept)\n" COLOR_RESET,
+               s->name, s->seconds, s->error ? s->error : "unknown error",
+               s->path ? " in " : "", s->path ? s->path : "", s->names);
     }
-    
-    free(response.data);
-    curl_easy_cleanup(curl);
-    
-    if(!tor_active) {
-        printf(COLOR_RED "[!] Tor not available\n" COLOR_RESET);
-        printf("%s[*] Starting Tor service...%s\n", COLOR_YELLOW, COLOR_RESET);
-        system("sudo systemctl start tor 2>/dev/null");
-        sleep(3);
-        return check_tor_connection();
+    if(s->delta) {
+        printf("%s[*] Delta mode: %zu names already seen in the last snapshot%s\n",
+               COLOR_BLUE, s->known, COLOR_RESET);
     }
-    
-    return tor_active;
 }
 
-// ========== CERTIFICATE TRANSPARENCY ==========
-void query_certificate_transparency(const char *domain) {
-    printf("\n%s[1] Certificate Transparency Scan%s\n", COLOR_YELLOW, COLOR_RESET);
-    printf("%s[*] Querying crt.sh database...%s\n", COLOR_BLUE, COLOR_RESET);
-    
-    CURL *curl = curl_easy_init();
-    if(!curl) return;
-    
-    ResponseBuffer response = {0};
-    char url[512];
-    snprintf(url, sizeof(url), "https://crt.sh/?q=%s&output=json", domain);
-    
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_PROXY, TOR_PROXY);
-    curl_easy_setopt(curl, CURLOPT_PROXYTYPE, CURLPROXY_SOCKS5);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 15L);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    
-    printf("%s[*] Sending request through Tor...%s\n", COLOR_BLUE, COLOR_RESET);
-    
-    CURLcode res = curl_easy_perform(curl);
-    
-    if(res == CURLE_OK && response.data) {
-        printf(COLOR_GREEN "[✓] Received response (%zu bytes)\n" COLOR_RESET, response.size);
-        
-        char *ptr = response.data;
-        int found = 0;
-        
-        printf("%s\n%sCertificate Transparency Results:%s\n", COLOR_WHITE,
-               "════════════════════════════════════════", COLOR_RESET);
-        
-        while((ptr = strstr(ptr, "name_value")) != NULL) {
-            ptr += 10;
-            char *start = strchr(ptr, '"');
-            if(!start) break;
-            start++;
-            
-            char *end = strchr(start, '"');
-            if(!end) break;
-            
-            char subdomain[512];
-            int len = end - start;
-            if(len > 0 && len < 500) {
-                strncpy(subdomain, start, len);
-                subdomain[len] = '\0';
-                
-                if(strstr(subdomain, domain)) {
-                    printf(COLOR_GREEN "  ✓ %s\n" COLOR_RESET, subdomain);
-                    add_result(subdomain, 1, "N/A (from cert)", 0);
-                    found++;
-                }
+static void print_dns_stats(const ResolveStats *stats) {
+    printf(COLOR_GREEN "[✓] Resolved %zu names in %.1f sec: %zu with addresses, %zu no data, "
+           "%zu NXDOMAIN, %zu timeouts, %zu errors\n" COLOR_RESET,
+           stats->names, stats->seconds, stats->resolved, stats->nodata,
+           stats->nxdomain, stats->timeouts, stats->errors);
+}
+
+static void print_phase_start(Cli *cli, ScanContext *scan, ScanPhase phase) {
+    const ScanConfig *cfg = &scan->config;
+    const WordlistStats *w = &scan->words;
+    switch(phase) {
+        case SCAN_PHASE_TOR_CHECK:
+            printf("%s[*] Verifying Tor connection...%s\n", COLOR_YELLOW, COLOR_RESET);
+            break;
+        case SCAN_PHASE_PASSIVE:
+            printf("\n%s[1] Passive Sources (%d running concurrently)%s\n", COLOR_YELLOW, scan->source_count, COLOR_RESET);
+            if(scan->online) {
+                printf("%s[*] Querying crt.sh through Tor; names are listed as they stream in%s\n",
+                       COLOR_BLUE, COLOR_RESET);
             }
-            ptr = end;
-        }
-        
-        if(found > 0) {
-            printf(COLOR_GREEN "\n[✓] Found %d subdomains in certificates\n" COLOR_RESET, found);
-        } else {
-            printf(COLOR_RED "\n[✗] No subdomains found in certificates\n" COLOR_RESET);
+            printf("%s\n%sPassive Results:%s\n", COLOR_WHITE,
+                   "════════════════════════════════════════", COLOR_RESET);
+            break;
+        case SCAN_PHASE_RESOLVE:
+            printf("\n%s[*] Resolving certificate names via %s...%s\n", COLOR_BLUE, cfg->resolver, COLOR_RESET);
+            break;
+        case SCAN_PHASE_WORDLIST:
+            printf("\n%s[2] Wordlist-based Scan%s\n", COLOR_YELLOW, COLOR_RESET);
+            printf("%s[*] Using %zu words from wordlist%s\n", COLOR_BLUE, scan->wordlist->count, COLOR_RESET);
+            break;
+        case SCAN_PHASE_CALIBRATION:
+            printf("%s[*] Calibrating with %d random labels...%s\n", COLOR_BLUE, WILDCARD_SAMPLES, COLOR_RESET);
+            break;
+        case SCAN_PHASE_PREFILTER:
+            printf("%s[*] Resolving %zu candidates via %s before probing...%s\n",
+                   COLOR_BLUE, scan->wordlist->count, cfg->resolver, COLOR_RESET);
+            break;
+        case SCAN_PHASE_PROBE: {
+            if(cfg->resume) {
+                printf("%s[*] Resuming from %s: %zu probes done (%zu found), continuing at word %zu%s\n",
+                       COLOR_BLUE, scan->journal_path, scan->journal.completed, w->replayed_found,
+                       scan->journal.position, COLOR_RESET);
+            } else {
+                printf("%s[*] Checkpointing to %s (continue with --resume)%s\n", COLOR_BLUE, scan->journal_path, COLOR_RESET);
+            }
+            if(scan->probe_cache.loaded > 0) {
+                printf("%s[*] Probe cache: %zu outcomes from earlier runs (live kept %ld h, dead %ld h)%s\n",
+                       COLOR_BLUE, scan->probe_cache.loaded, cfg->probe_ttl / 3600, cfg->negative_ttl / 3600, COLOR_RESET);
+            }
+            int estimated_seconds = (int)(w->candidates * 60 / scan->engine->requests_per_minute);
+            printf("%s[*] Rate limit: %d requests/minute, up to %d probes in flight%s\n",
+                   COLOR_BLUE, scan->engine->requests_per_minute, cfg->parallel, COLOR_RESET);
+            printf("%s[*] Estimated time: %d min %d sec for %zu tests%s\n",
+                   COLOR_BLUE, estimated_seconds / 60, estimated_seconds % 60, w->candidates, COLOR_RESET);
+            printf("%s[*] Press Ctrl+C to stop early (progress is kept in the journal)\n%s", COLOR_YELLOW, COLOR_RESET);
+    
+            // First Ctrl+C stops the scan cleanly, a second one kills the process
+            struct sigaction sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_handler = on_interrupt;
+            sa.sa_flags = SA_RESETHAND;
+            interrupt_target = scan;
+            sigaction(SIGINT, &sa, &cli->old_sigint);
+            break;
         }
-    } else {
-        printf(COLOR_RED "[✗] Certificate query failed: %s\n" COLOR_RESET, 
-               curl_easy_strerror(res));
+        case SCAN_PHASE_RANK:
+        case SCAN_PHASE_INDEX:
+            break;
     }
-    
-    free(response.data);
-    curl_easy_cleanup(curl);
-    
-    // Rate limit after this
-    rate_limit(1);
 }
 
-// ========== SCAN WITH WORDLIST ==========
-void scan_with_wordlist(const char *domain) {
-    printf("\n%s[2] Wordlist-based Scan%s\n", COLOR_YELLOW, COLOR_RESET);
-    printf("%s[*] Using %d words from wordlist%s\n", COLOR_BLUE, wordlist_size, COLOR_RESET);
-    printf("%s[*] Rate limit: %d requests/minute%s\n", COLOR_BLUE, REQUESTS_PER_MINUTE, COLOR_RESET);
-    
-    int total_tests = wordlist_size;
-    int estimated_seconds = (total_tests * 60) / REQUESTS_PER_MINUTE;
-    int estimated_minutes = estimated_seconds / 60;
-    
-    printf("%s[*] Estimated time: %d min %d sec for %d tests%s\n", 
-           COLOR_BLUE, estimated_minutes, estimated_seconds % 60, total_tests, COLOR_RESET);
-    printf("%s[*] Press Ctrl+C to stop early\n%s", COLOR_YELLOW, COLOR_RESET);
-    
-    CURL *curl = curl_easy_init();
-    if(!curl) return;
+static void print_wordlist_end(const ScanContext *scan) {
+    const WordlistStats *w = &scan->words;
+    if(w->interrupted) {
+        printf(COLOR_YELLOW "\n[!] Interrupted after %zu of %zu words; run again with --resume to continue\n" COLOR_RESET,
+               w->completed, scan->wordlist->count);
+    }
+    if(w->known > 0) {
+        printf("%s[*] Skipped %zu words already known from Certificate Transparency%s\n",
+               COLOR_BLUE, w->known, COLOR_RESET);
+    }
+    if(w->cached > 0) {
+        printf("%s[*] Answered %zu words from the probe cache (%zu live) without a request%s\n",
+               COLOR_BLUE, w->cached, w->cached_found, COLOR_RESET);
+    }
     
-    // Configure curl
-    curl_easy_setopt(curl, CURLOPT_PROXY, TOR_PROXY);
-    curl_easy_setopt(curl, CURLOPT_PROXYTYPE, CURLPROXY_SOCKS5);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 8L);
-    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);  // HEAD request
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
+    printf("\n%s[*] Wordlist scan completed: %zu/%zu tests%s\n",
+           COLOR_YELLOW, w->tested, w->candidates, COLOR_RESET);
     
-    int found = 0;
-    int tested = 0;
-    
-    for(int i = 0; i < wordlist_size; i++) {
-        tested++;
-        
-        char subdomain[512];
-        snprintf(subdomain, sizeof(subdomain), "%s.%s", wordlist[i], domain);
-        
-        char url[1024];
-        snprintf(url, sizeof(url), "https://%s", subdomain);
-        
-        curl_easy_setopt(curl, CURLOPT_URL, url);
-        CURLcode res = curl_easy_perform(curl);
-        
-        if(res == CURLE_OK) {
-            long http_code = 0;
-            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-            
-            if(http_code < 400) {
-                printf(COLOR_GREEN "  ✓ %-25s -> HTTP %ld\n" COLOR_RESET, 
-                       wordlist[i], http_code);
-                add_result(subdomain, 1, "N/A", http_code);
-                found++;
+    if(w->found + w->cached_found > 0) {
+        printf(COLOR_GREEN "[✓] Found %zu active subdomains via wordlist\n" COLOR_RESET, w->found + w->cached_found);
+    } else {
+        printf(COLOR_RED "[✗] No subdomains found via wordlist\n" COLOR_RESET);
+    }
+    if(w->certificates > 0) {
+        printf("%s[*] %zu new names from %zu certificates seen while probing%s\n",
+               w->san_names > 0 ? COLOR_GREEN : COLOR_BLUE, w->san_names, w->certificates, COLOR_RESET);
+    }
+}
+
+static void print_phase_end(ScanContext *scan, ScanPhase phase) {
+    const ScanConfig *cfg = &scan->config;
+    switch(phase) {
+        case SCAN_PHASE_TOR_CHECK:
+            printf(COLOR_GREEN "[✓] Tor connection: ACTIVE\n" COLOR_RESET);
+            break;
+        case SCAN_PHASE_PASSIVE: {
+            printf("\n");
+            double slowest = 0;
+            for(int i = 0; i < scan->source_count; i++) {
+                print_source(&scan->sources[i]);
+                if(scan->sources[i].seconds > slowest) slowest = scan->sources[i].seconds;
+            }
+            if(scan->passive_unique > 0) {
+                printf(COLOR_GREEN "[✓] %zu %snames from passive sources in %.2f sec (slowest source %.2f sec), "
+                       "%zu duplicates merged\n" COLOR_RESET,
+                       scan->passive_unique, cfg->delta ? "new " : "unique ", scan->passive_seconds,
+                       slowest, scan->passive_merged);
             } else {
-                printf(COLOR_RED "  ✗ %-25s -> HTTP %ld\n" COLOR_RESET, 
-                       wordlist[i], http_code);
-                add_result(subdomain, 0, "N/A", http_code);
+                printf(COLOR_RED "[✗] No %ssubdomains found by passive sources\n" COLOR_RESET,
+                       cfg->delta ? "new " : "");
             }
-        } else {
-            printf(COLOR_RED "  ✗ %-25s -> No response\n" COLOR_RESET, wordlist[i]);
-            add_result(subdomain, 0, "N/A", 0);
-        }
-        
-        // Rate limit (except after last one)
-        if(i < wordlist_size - 1) {
-            rate_limit(tested + 1);  // +1 for crt.sh query
+            break;
         }
-        
-        // Progress every 10 tests
-        if(tested % 10 == 0) {
-            time_t now = time(NULL);
-            int elapsed = (int)difftime(now, scan_start_time);
-            int percent = (tested * 100) / wordlist_size;
-            
-            printf("%s[*] Progress: %d/%d (%d%%) | Found: %d | Time: %d sec\n" COLOR_RESET,
-                   COLOR_YELLOW, tested, wordlist_size, percent, found, elapsed);
+        case SCAN_PHASE_RESOLVE:
+            print_dns_stats(&scan->dns_stats);
+            break;
+        case SCAN_PHASE_CALIBRATION: {
+            const WildcardProfile *wildcard = &scan->wildcard;
+            if(wildcard->dns) {
+                printf(COLOR_YELLOW "[!] Wildcard DNS: random labels resolve to %d address(es), e.g. %s\n" COLOR_RESET,
+                       wildcard->addr_count, wildcard->addrs[0]);
+            }
+            if(wildcard->http) {
+                printf(COLOR_YELLOW "[!] Catch-all HTTP: random labels answer %ld, length %lld%s%s\n" COLOR_RESET,
+                       wildcard->http_status, (long long)wildcard->content_length,
+                       wildcard->redirect[0] ? ", redirect " : "", wildcard->redirect);
+            }
+            if(!wildcard->dns && !wildcard->http) {
+                printf(COLOR_GREEN "[✓] No wildcard detected\n" COLOR_RESET);
+            }
+            break;
         }
+        case SCAN_PHASE_PREFILTER:
+            print_dns_stats(&scan->dns_stats);
+            printf("%s[*] Skipping %zu NXDOMAIN candidates%s\n", COLOR_BLUE, scan->dns_stats.nxdomain, COLOR_RESET);
+            if(scan->wildcard.dns_filtered > 0) {
+                printf("%s[*] Skipping %zu candidates that only match the wildcard record%s\n",
+                       COLOR_BLUE, scan->wildcard.dns_filtered, COLOR_RESET);
+            }
+            break;
+        case SCAN_PHASE_RANK:
+            printf("%s[*] Ranked wordlist from %zu known and %zu prior names: %zu words moved to the front%s\n",
+                   COLOR_BLUE, scan->words.rank_known, scan->words.rank_prior, scan->ranker.scored, COLOR_RESET);
+            break;
+        case SCAN_PHASE_PROBE:
+            break;
+        case SCAN_PHASE_WORDLIST:
+            print_wordlist_end(scan);
+            break;
+        case SCAN_PHASE_INDEX:
+            printf(COLOR_GREEN "[✓] Index %s updated: %zu new names\n" COLOR_RESET, cfg->index_file, scan->index_added);
+            break;
     }
-    
-    curl_easy_cleanup(curl);
-    
-    printf("\n%s[*] Wordlist scan completed: %d/%d tests%s\n", 
-           COLOR_YELLOW, tested, wordlist_size, COLOR_RESET);
-    
-    if(found > 0) {
-        printf(COLOR_GREEN "[✓] Found %d active subdomains via wordlist\n" COLOR_RESET, found);
-    } else {
-        printf(COLOR_RED "[✗] No subdomains found via wordlist\n" COLOR_RESET);
+}
+
+static void print_phase_failure(ScanContext *scan, ScanPhase phase) {
+    switch(phase) {
+        case SCAN_PHASE_TOR_CHECK:
+            printf(COLOR_RED "[!] Tor not available (start it first, e.g. sudo systemctl start tor)\n" COLOR_RESET);
+            break;
+        case SCAN_PHASE_PREFILTER:
+            printf(COLOR_RED "[✗] %s, probing everything\n" COLOR_RESET, scan->error);
+            break;
+        case SCAN_PHASE_WORDLIST:
+            if(scan->words.catch_all_skip) {
+                printf(COLOR_YELLOW "[!] Skipping the wordlist scan: every name would hit the catch-all.\n"
+                       "    Use --resolver to prune by DNS, or --wildcard-probe to probe anyway\n" COLOR_RESET);
+            } else {
+                printf(COLOR_RED "[!] %s\n" COLOR_RESET, scan->error);
+            }
+            break;
+        case SCAN_PHASE_INDEX:
+            printf(COLOR_RED "[!] %s\n" COLOR_RESET, scan->error);
+            break;
+        case SCAN_PHASE_RANK:
+            break;  // Its warning already said what happened
+        case SCAN_PHASE_PROBE:
+            break;  // The wordlist phase ends with the same error
+        default:
+            printf(COLOR_RED "[✗] %s\n" COLOR_RESET, scan->error);
+            break;
+    }
+}
+
+static void on_scan_event(ScanContext *scan, const ScanEvent *ev, void *userdata) {
+    Cli *cli = (Cli *)userdata;
+    switch(ev->kind) {
+        case SCAN_EVENT_PHASE_START:
+            console_flush(&cli->console);
+            print_phase_start(cli, scan, ev->phase);
+            break;
+        case SCAN_EVENT_PHASE_END:
+            console_flush(&cli->console);
+            if(ev->phase == SCAN_PHASE_PROBE) {
+                sigaction(SIGINT, &cli->old_sigint, NULL);
+                interrupt_target = NULL;
+            }
+            if(ev->ok) print_phase_end(scan, ev->phase);
+            else print_phase_failure(scan, ev->phase);
+            break;
+        case SCAN_EVENT_TOR_RETRY:
+            printf(COLOR_RED "[!] Tor check %d/%d: %s\n" COLOR_RESET, ev->attempt, SCAN_TOR_CHECK_ATTEMPTS, ev->message);
+            if(ev->backoff_ms > 0) {
+                printf("%s[*] Retrying in %.0f sec...%s\n", COLOR_YELLOW, ev->backoff_ms / 1000.0, COLOR_RESET);
+            }
+            break;
+        case SCAN_EVENT_NAME:
+            show_passive_name(cli, scan, ev->passive);
+            break;
+        case SCAN_EVENT_PROBE:
+            show_probe(cli, scan, ev);
+            break;
+        case SCAN_EVENT_CERT_NAME:
+            show_certificate_name(cli, ev);
+            break;
+        case SCAN_EVENT_WARNING:
+            console_printf(&cli->console, CONSOLE_TEXT, COLOR_YELLOW "[!] %s\n" COLOR_RESET, ev->message);
+            break;
     }
 }
 
 // ========== PRINT SUMMARY ==========
-void print_summary() {
+static void print_percentiles(const char *stage, const LatencyHistogram *h) {
+    if(h->count == 0) return;
+    printf("%s    %-18s %-9s p50 %6.0f ms   p90 %6.0f ms   p99 %6.0f ms   max %6.0f ms\n" COLOR_RESET,
+           COLOR_WHITE, "", stage, histogram_percentile(h, 50) / 1e3, histogram_percentile(h, 90) / 1e3,
+           histogram_percentile(h, 99) / 1e3, h->max_us / 1e3);
+}
+
+static void print_phase(const PhaseStats *p, Metrics *metrics, const char *metrics_name) {
+    if(p->requests == 0) return;
+    printf("%s[*] %-18s %zu requests in %.1f sec = %.2f reqs/min, avg latency %.0f ms, %zu errors\n" COLOR_RESET,
+           COLOR_WHITE, p->name, p->requests, phase_elapsed_sec(p), phase_rate_per_min(p),
+           p->completed ? p->latency_ms / p->completed : 0, p->errors);
+    
+    // Handshake is Tor stream setup + TLS; TTFB is the target's own response time plus one circuit round trip
+    const PhaseMetrics *m = metrics_phase(metrics, metrics_name);
+    if(m && m->requests > 0) {
+        printf("%s    %-18s %llu timeouts, %llu 2xx, %llu 3xx, %llu 4xx, %llu 5xx\n" COLOR_RESET,
+               COLOR_WHITE, "", (unsigned long long)m->timeouts, (unsigned long long)m->status[2],
+               (unsigned long long)m->status[3], (unsigned long long)m->status[4], 
+               (unsigned long long)m->status[5]);
+        print_percentiles("handshake", &m->stages[STAGE_HANDSHAKE]);
+        print_percentiles("ttfb", &m->stages[STAGE_TTFB]);
+        print_percentiles("total", &m->stages[STAGE_TOTAL]);
+    }
+    if(p->hits > 0) {
+        printf("%s    %-18s first hit after %.1f sec (request #%zu), %.1f hits per 100 requests\n" COLOR_RESET,
+               COLOR_WHITE, "", (p->first_hit_ms - p->first_start_ms) / 1000.0, 
+               p->requests_at_first_hit, p->hits * 100.0 / p->requests);
+    }
+}
+
+static void print_deadlines(AdaptiveDeadline *d) {
+    if(d->answered == 0 && d->timeouts == 0) return;
+    printf("%s[*] %-18s connect %ld ms (p99 %.0f ms), response %ld ms (p99 %.0f ms), %.0f-%.0f ms bounds\n" COLOR_RESET,
+           COLOR_WHITE, "Probe deadlines:", deadline_connect_ms(d), d->connect.p99_ms, 
+           deadline_response_ms(d), d->response.p99_ms, d->floor_ms, d->ceiling_ms);
+    if(d->timeouts > 0) {
+        printf("%s    %-18s %zu timeouts cost %.1f sec (%.1f sec at the initial %.0f ms), widened %zu times\n" COLOR_RESET,
+               COLOR_WHITE, "", d->timeouts, d->timeout_ms / 1000.0, 
+               d->timeouts * d->initial_ms / 1000.0, d->initial_ms, d->widened);
+    }
+}
+
+// Where the resolved names are hosted, biggest networks first
+static void print_networks(const ScanContext *scan) {
+    ScanNetwork *networks;
+    size_t count = scan_networks(scan, &networks);
+    if(count == 0) return;
+    
+    printf("%s[*] Networks:         %zu (names with an address, live)\n" COLOR_RESET, COLOR_WHITE, count);
+    for(size_t i = 0; i < count && i < SUMMARY_NETWORKS; i++) {
+        printf("%s    AS%-10u %-32.32s %6zu %6zu\n" COLOR_RESET, COLOR_WHITE,
+               (unsigned)networks[i].asn, networks[i].org, networks[i].names, networks[i].found);
+    }
+    if(count > SUMMARY_NETWORKS) {
+        printf("%s    ... %zu more\n" COLOR_RESET, COLOR_WHITE, count - SUMMARY_NETWORKS);
+    }
+    free(networks);
+}
+
+void print_summary(Cli *cli, const ScanContext *scan) {
+    const ResultStore *results = &scan->results;
+    ScanEngine *engine = scan->engine;
     printf("\n%s%sSCAN SUMMARY%s\n", COLOR_CYAN,
            "════════════════════════════════════════", COLOR_RESET);
     
     int found = 0;
-    for(int i = 0; i < result_count; i++) {
-        if(results[i].found) found++;
+    for(size_t i = 0; i < results->count; i++) {
+        if(results->records[i].found) found++;
     }
     
-    time_t end_time = time(NULL);
-    int total_seconds = (int)difftime(end_time, scan_start_time);
-    int minutes = total_seconds / 60;
-    int seconds = total_seconds % 60;
-    
-    float actual_rate = total_seconds > 0 ? (total_requests_made * 60.0) / total_seconds : 0;
-    
-    printf("%s[*] Total Duration:   %d min %d sec\n" COLOR_RESET, 
-           COLOR_WHITE, minutes, seconds);
-    printf("%s[*] Total Requests:   %d\n" COLOR_RESET, COLOR_WHITE, total_requests_made);
-    printf("%s[*] Actual Rate:      %.1f reqs/min\n" COLOR_RESET, COLOR_WHITE, actual_rate);
-    printf("%s[*] Target Rate:      %d reqs/min\n" COLOR_RESET, COLOR_WHITE, REQUESTS_PER_MINUTE);
-    printf("%s[*] Wordlist Size:    %d words\n" COLOR_RESET, COLOR_WHITE, wordlist_size);
-    printf("%s[*] Subdomains Found: %d/%d\n" COLOR_RESET, COLOR_WHITE, found, result_count);
-    
-    if(found > 0) {
+    double total_seconds = (monotonic_ms() - scan->started_ms) / 1000.0;
+    int minutes = (int)(total_seconds / 60);
+    size_t requests = scan->ct_phase.requests + scan->calibration_phase.requests + scan->probe_phase.requests;
+    
+    printf("%s[*] Total Duration:   %d min %.1f sec\n" COLOR_RESET, 
+           COLOR_WHITE, minutes, total_seconds - minutes * 60);
+    printf("%s[*] Total Requests:   %zu\n" COLOR_RESET, COLOR_WHITE, requests);
+    print_phase(&scan->ct_phase, &engine->metrics, "crtsh");
+    print_phase(&scan->calibration_phase, &engine->metrics, "calibration");
+    print_phase(&scan->probe_phase, &engine->metrics, "probe");
+    print_deadlines(&engine->deadline);
+    printf("%s[*] Target Rate:      %d reqs/min\n" COLOR_RESET, COLOR_WHITE, engine->requests_per_minute);
+    printf("%s[*] Wordlist Size:    %zu words\n" COLOR_RESET, COLOR_WHITE, cli->wordlist.count);
+    printf("%s[*] Subdomains Found: %d/%zu\n" COLOR_RESET, COLOR_WHITE, found, results->count);
+    printf("%s[*] Duplicates Merged: %zu\n" COLOR_RESET, COLOR_WHITE, results->duplicates);
+    if(scan->wildcard.dns_filtered || scan->wildcard.http_filtered) {
+        printf("%s[*] Wildcard Filtered: %zu by DNS (not probed), %zu by HTTP fingerprint\n" COLOR_RESET, 
+               COLOR_WHITE, scan->wildcard.dns_filtered, scan->wildcard.http_filtered);
+    }
+    printf("%s[*] Result Memory:    %.1f KB\n" COLOR_RESET, COLOR_WHITE, 
+           result_store_memory(results) / 1024.0);
+    print_networks(scan);
+    console_printf(&cli->console, CONSOLE_EVENT, 
+                   "{\"event\":\"summary\",\"found\":%d,\"names\":%zu,\"requests\":%zu,\"duration_sec\":%.1f}\n",
+                   found, results->count, requests, total_seconds);
+    
+    if(found > 0 && cli->quiet) {
+        printf(COLOR_GREEN "[✓] %d discoveries listed in %s\n" COLOR_RESET, found, cli->output_path);
+    } else if(found > 0) {
         printf("\n%s%sSUCCESSFUL DISCOVERIES:%s\n", COLOR_GREEN,
                "════════════════════════════════════════", COLOR_RESET);
         
-        for(int i = 0; i < result_count; i++) {
-            if(results[i].found) {
-                if(results[i].http_status > 0) {
-                    printf(COLOR_GREEN "  • %s (HTTP %d)\n" COLOR_RESET, 
-                           results[i].subdomain, results[i].http_status);
-                } else {
-                    printf(COLOR_GREEN "  • %s (from certificate)\n" COLOR_RESET, 
-                           results[i].subdomain);
-                }
-            }
+        for(size_t i = 0; i < results->count; i++) {
+            const SubdomainResult *r = &results->records[i];
+            if(!r->found) continue;
+            
+            char sources[SOURCE_NAMES_LEN];
+            char http[24] = "";
+            if(r->http_status > 0) snprintf(http, sizeof(http), "HTTP %d, ", r->http_status);
+            
+            char network[64] = "";
+            if(r->asn) snprintf(network, sizeof(network), ", AS%u %.40s", (unsigned)r->asn, r->org);
+            
+            printf(COLOR_GREEN "  • %s (%s%s%s%s%s)\n" COLOR_RESET, 
+                   r->subdomain, http, source_names(r->sources, sources, sizeof(sources)),
+                   r->ip ? ", " : "", r->ip ? r->ip : "", network);
         }
     }
 }
 
-// ========== FREE RESOURCES ==========
-void free_resources() {
-    if(results) {
-        free(results);
-        results = NULL;
+// ========== NAME INDEX ==========
+static void print_indexed_name(const char *name, const NameIndexRecord *record, void *userdata) {
+    (void)userdata;
+    char sources[SOURCE_NAMES_LEN], first[16], last[16];
+    time_t first_seen = (time_t)record->first_seen;
+    time_t last_seen = (time_t)record->last_seen;
+    
+    strftime(first, sizeof(first), "%Y-%m-%d", localtime(&first_seen));
+    strftime(last, sizeof(last), "%Y-%m-%d", localtime(&last_seen));
+    printf(COLOR_GREEN "  • %-40s" COLOR_RESET " %-16s first %s  last %s\n", 
+           name, source_names(record->sources, sources, sizeof(sources)), first, last);
+}
+
+int query_index(const char *path, const char *suffix) {
+    NameIndex index;
+    const char *error = NULL;
+    
+    // Timed from the open: mapping the file is part of what a query costs
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if(!name_index_open(&index, path, &error)) {
+        printf(COLOR_RED "[!] Cannot open index %s: %s\n" COLOR_RESET, path, error);
+        return 0;
     }
-    
-    if(wordlist) {
-        for(int i = 0; i < wordlist_size; i++) {
-            free(wordlist[i]);
-        }
-        free(wordlist);
-        wordlist = NULL;
-        wordlist_size = 0;
+    size_t matches = name_index_query(&index, suffix, print_indexed_name, NULL, &error);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    
+    if(error) printf(COLOR_RED "[!] Index %s is damaged: %s\n" COLOR_RESET, path, error);
+    printf("\n%s[*] %zu of %zu indexed names under %s (%.3f ms)%s\n", 
+           COLOR_BLUE, matches, index.count, suffix, ms, COLOR_RESET);
+    name_index_close(&index);
+    return error == NULL;
+}
+
+// ========== METRICS ==========
+// Final Prometheus rewrite and the JSON summary
+void finish_metrics(Cli *cli, ScanEngine *engine, const char *domain) {
+    metrics_stop_export(&engine->metrics);
+    if(cli->metrics_file) {
+        printf(COLOR_GREEN "[✓] Metrics written to: %s\n" COLOR_RESET, cli->metrics_file);
+    }
+    if(!cli->metrics_json) return;
+    if(metrics_write_json(&engine->metrics, cli->metrics_json, domain)) {
+        printf(COLOR_GREEN "[✓] Latency summary written to: %s\n" COLOR_RESET, cli->metrics_json);
+    } else {
+        printf(COLOR_RED "[!] Could not write %s\n" COLOR_RESET, cli->metrics_json);
     }
 }
 
+// ========== OPTIONS ==========
+// Appends one --ingest/--ct-file/--ct-log/--zone path; past the limit the
+// run is refused rather than scanning without some of the sources
+static int add_source_file(const char **files, int *count, const char *flag, const char *path) {
+    if(*count >= MAX_INGEST_FILES) {
+        printf(COLOR_RED "[!] Too many %s files: at most %d are read per run\n" COLOR_RESET, flag, MAX_INGEST_FILES);
+        return 0;
+    }
+    files[(*count)++] = path;
+    return 1;
+}
+
+// ========== FREE RESOURCES ==========
+void free_cli(Cli *cli) {
+    result_writer_close(&cli->writer);  // No-op once close_output() ran
+    wordlist_free(&cli->wordlist);
+    asn_free(&cli->asn);
+    console_stop(&cli->console);
+    if(cli->event_log) fclose(cli->event_log);
+    cli->event_log = NULL;
+}
+
 // ========== MAIN FUNCTION ==========
 int main(int argc, char *argv[]) {
     print_banner();
     
-    if(argc < 2 || argc > 3) {
-        printf("%sUsage: %s <domain> [wordlist.txt]\n" COLOR_RESET, COLOR_YELLOW, argv[0]);
+    static const struct option long_options[] = {
+        { "max-words",        required_argument, NULL, 'm' },
+        { "compile-wordlist", required_argument, NULL, 'c' },
+        { "ingest",           required_argument, NULL, 'i' },
+        { "threads",          required_argument, NULL, 't' },
+        { "offline",          no_argument,       NULL, 'o' },
+        { "index",            required_argument, NULL, 'x' },
+        { "no-index",         no_argument,       NULL, 'X' },
+        { "query",            required_argument, NULL, 'q' },
+        { "ct-ttl",           required_argument, NULL, 'T' },
+        { "cache-dir",        required_argument, NULL, 'C' },
+        { "no-cache",         no_argument,       NULL, 'N' },
+        { "delta",            no_argument,       NULL, 'd' },
+        { "resolver",         required_argument, NULL, 'r' },
+        { "dns-inflight",     required_argument, NULL, 'Q' },
+        { "parallel",         required_argument, NULL, 'P' },
+        { "journal",          required_argument, NULL, 'J' },
+        { "resume",           no_argument,       NULL, 'R' },
+        { "output",           required_argument, NULL, 'O' },
+        { "format",           required_argument, NULL, 'F' },
+        { "keep-negatives",   no_argument,       NULL, 'k' },
+        { "wildcard-probe",   no_argument,       NULL, 'W' },
+        { "no-rank",          no_argument,       NULL, 'U' },
+        { "prior",            required_argument, NULL, 'p' },
+        { "ct-file",          required_argument, NULL, 'L' },
+        { "from-index",       no_argument,       NULL, 'I' },
+        { "ct-log",           required_argument, NULL, 'E' },
+        { "probe-ttl",        required_argument, NULL, 'Y' },
+        { "negative-ttl",     required_argument, NULL, 'Z' },
+        { "metrics",          required_argument, NULL, 'M' },
+        { "metrics-json",     required_argument, NULL, 'j' },
+        { "quiet",            no_argument,       NULL, 's' },
+        { "json-log",         required_argument, NULL, 'l' },
+        { "yes",              no_argument,       NULL, 'y' },
+        { "asn",              required_argument, NULL, 'a' },
+        { "compile-asn",      required_argument, NULL, 'A' },
+        { "zone",             required_argument, NULL, 'z' },
+        { NULL, 0, NULL, 0 }
+    };
+    
+    Cli cli = {
+        .max_words = MAX_WORDLIST_SIZE,
+        .output_format = DEFAULT_OUTPUT_FORMAT,
+    };
+    ScanConfig config;
+    scan_config_init(&config, NULL);
+    config.ingest_files = cli.ingest_files;
+    config.ct_files = cli.ct_files;
+    config.ct_log_files = cli.ct_log_files;
+    config.zone_files = cli.zone_files;
+    config.on_result = on_scan_result;
+    config.on_event = on_scan_event;
+    config.userdata = &cli;
+    
+    int opt;
+    while((opt = getopt_long(argc, argv, "m:c:i:t:ox:Xq:T:C:Ndr:Q:P:J:RO:F:kWUp:L:IE:Y:Z:M:j:sl:ya:A:z:", long_options, NULL)) != -1) {
+        switch(opt) {
+            case 'm': cli.max_words = strtoul(optarg, NULL, 10); break;
+            case 'c': cli.compile_wordlist = optarg; break;
+            case 'i':
+                if(!add_source_file(cli.ingest_files, &config.ingest_count, "--ingest", optarg)) return 1;
+                break;
+            case 't': config.threads = atoi(optarg); break;
+            case 'o': config.offline = 1; break;
+            case 'x': config.index_file = optarg; break;
+            case 'X': config.index_file = NULL; break;
+            case 'q': cli.query = optarg; break;
+            case 'T': config.ct_ttl = atol(optarg); break;
+            case 'C': config.ct_cache_dir = optarg; break;
+            case 'N': config.ct_cache_dir = NULL; break;
+            case 'd': config.delta = 1; break;
+            case 'r': config.resolver = optarg; break;
+            case 'Q': config.dns_inflight = atoi(optarg); break;
+            case 'P': config.parallel = atoi(optarg); break;
+            case 'J': config.journal_file = optarg; break;
+            case 'R': config.resume = 1; break;
+            case 'O': cli.output_file = optarg; break;
+            case 'F': cli.output_format = optarg; break;
+            case 'k': cli.keep_negatives = 1; break;
+            case 'W': config.wildcard_probe = 1; break;
+            case 'U': config.no_rank = 1; break;
+            case 'p': config.prior_file = optarg; break;
+            case 'L':
+                if(!add_source_file(cli.ct_files, &config.ct_file_count, "--ct-file", optarg)) return 1;
+                break;
+            case 'I': config.from_index = 1; break;
+            case 'E':
+                if(!add_source_file(cli.ct_log_files, &config.ct_log_count, "--ct-log", optarg)) return 1;
+                break;
+            case 'z':
+                if(!add_source_file(cli.zone_files, &config.zone_count, "--zone", optarg)) return 1;
+                break;
+            case 'Y': config.probe_ttl = atol(optarg); break;
+            case 'Z': config.negative_ttl = atol(optarg); break;
+            case 'M': cli.metrics_file = optarg; break;
+            case 'j': cli.metrics_json = optarg; break;
+            case 's': cli.quiet = 1; break;
+            case 'l': cli.json_log = optarg; break;
+            case 'y': cli.yes = 1; break;
+            case 'a': cli.asn_file = optarg; break;
+            case 'A': cli.compile_asn = optarg; break;
+            default:  argc = 0; break;  // Force usage
+        }
+    }
+    
+    int positional = argc - optind;
+    
+    // Query mode: answer from the index only, no scan
+    if(cli.query && positional == 0) {
+        return query_index(config.index_file ? config.index_file : SCAN_DEFAULT_INDEX, cli.query) ? 0 : 1;
+    }
+    
+    // Compile mode: <wordlist.txt> only, no scan
+    if(cli.compile_wordlist && positional == 1) {
+        if(!load_wordlist(&cli, argv[optind])) return 1;
+        if(!wordlist_compile(&cli.wordlist, cli.compile_wordlist)) {
+            printf(COLOR_RED "[!] Could not write compiled wordlist: %s\n" COLOR_RESET, 
+                   cli.compile_wordlist);
+            free_cli(&cli);
+            return 1;
+        }
+        printf(COLOR_GREEN "[✓] Compiled %zu words to %s\n" COLOR_RESET, 
+               cli.wordlist.count, cli.compile_wordlist);
+        free_cli(&cli);
+        return 0;
+    }
+    
+    // Compile mode: <ip2asn.tsv> only, no scan
+    if(cli.compile_asn && !cli.compile_wordlist && positional == 1) {
+        if(!load_asn(&cli, argv[optind])) return 1;
+        if(!asn_compile(&cli.asn, cli.compile_asn)) {
+            printf(COLOR_RED "[!] Could not write compiled ASN database: %s\n" COLOR_RESET, cli.compile_asn);
+            free_cli(&cli);
+            return 1;
+        }
+        printf(COLOR_GREEN "[✓] Compiled %zu ranges to %s\n" COLOR_RESET,
+               cli.asn.v4_count + cli.asn.v6_count, cli.compile_asn);
+        free_cli(&cli);
+        return 0;
+    }
+    
+    if(cli.compile_wordlist || cli.compile_asn || cli.query || positional < 1 || positional > 2) {
+        printf("%sUsage: %s [options] <domain> [wordlist.txt|wordlist.sswl]\n" COLOR_RESET, COLOR_YELLOW, argv[0]);
+        printf("%s       %s --compile-wordlist out.sswl <wordlist.txt>\n" COLOR_RESET, COLOR_YELLOW, argv[0]);
+        printf("%s       %s --compile-asn out.ssas <ip2asn.tsv>\n" COLOR_RESET, COLOR_YELLOW, argv[0]);
+        printf("%sOptions:\n" COLOR_RESET, COLOR_BLUE);
+        printf("  -m, --max-words N          Stop loading after N unique words (0 = no limit, default %d)\n", MAX_WORDLIST_SIZE);
+        printf("  -c, --compile-wordlist F   Compile the wordlist into binary file F and exit\n");
+        printf("  -i, --ingest FILE          Import names from a passive-DNS dump (JSONL/CSV, .gz ok)\n");
+        printf("  -t, --threads N            Ingest, CT log and zone parse threads (default: one per CPU)\n");
+        printf("  -o, --offline              Only run offline sources (no Tor, crt.sh or probes)\n");
+        printf("  -x, --index FILE           Persistent name index (default %s)\n", SCAN_DEFAULT_INDEX);
+        printf("  -X, --no-index             Do not update the name index\n");
+        printf("  -q, --query SUFFIX         List indexed names under SUFFIX and exit\n");
+        printf("  -T, --ct-ttl SECONDS       Reuse cached crt.sh results this long (default %d, 0 = refetch)\n", SCAN_DEFAULT_CT_TTL);
+        printf("  -C, --cache-dir DIR        crt.sh and probe cache directory (default %s)\n", SCAN_DEFAULT_CACHE_DIR);
+        printf("  -N, --no-cache             Neither read nor write the crt.sh or probe cache\n");
+        printf("  -d, --delta                Only print CT names new since the last snapshot (all are still stored)\n");
+        printf("  -r, --resolver HOST[:PORT] Resolve names over UDP and skip NXDOMAIN candidates\n");
+        printf("                             (DNS bypasses Tor; use Tor's DNSPort, e.g. 127.0.0.1:5353)\n");
+        printf("  -Q, --dns-inflight N       Concurrent DNS queries (default %d)\n", RESOLVER_DEFAULT_INFLIGHT);
+        printf("  -P, --parallel N           HTTPS probes in flight, still capped at %d/min (default %d)\n", 
+               REQUESTS_PER_MINUTE, PROBE_DEFAULT_PARALLEL);
+        printf("  -J, --journal FILE         Checkpoint journal (default <domain>%s)\n", SCAN_JOURNAL_SUFFIX);
+        printf("  -R, --resume               Continue an interrupted wordlist scan from its journal\n");
+        printf("  -O, --output FILE          Stream results to FILE (default found_subdomains.txt/.jsonl/.bin)\n");
+        printf("  -F, --format FMT           csv, jsonl or bin (default %s)\n", DEFAULT_OUTPUT_FORMAT);
+        printf("  -k, --keep-negatives       Also write names that were probed but not found\n");
+        printf("  -W, --wildcard-probe       Probe the wordlist even when a catch-all vhost answers everything\n");
+        printf("  -U, --no-rank              Probe in wordlist file order instead of ranking by known labels\n");
+        printf("  -p, --prior FILE           Extra hostnames or labels to learn label statistics from\n");
+        printf("  -L, --ct-file FILE         Import a saved crt.sh JSON answer (runs with the other sources)\n");
+        printf("  -I, --from-index           Seed results with names already in the index\n");
+        printf("  -E, --ct-log FILE          Import names from mirrored CT log get-entries batches (.gz ok)\n");
+        printf("  -z, --zone FILE            Import owner names and CNAME/NS targets from a zone file\n");
+        printf("  -Y, --probe-ttl SECONDS    Reuse live probe outcomes this long (default %d, 0 = reprobe)\n", SCAN_DEFAULT_PROBE_TTL);
+        printf("  -Z, --negative-ttl SECONDS Reuse dead probe outcomes this long (default %d, 0 = reprobe)\n", SCAN_DEFAULT_NEGATIVE_TTL);
+        printf("  -M, --metrics FILE         Prometheus metrics, rewritten every %d sec while scanning\n", METRICS_INTERVAL_SEC);
+        printf("  -j, --metrics-json FILE    Write per-phase latency percentiles and counters at exit\n");
+        printf("  -s, --quiet                No per-name lines or progress line, only phases and the summary\n");
+        printf("  -l, --json-log FILE        Log every name and probe as a JSON line\n");
+        printf("  -y, --yes                  Start the wordlist scan without asking (for unattended runs)\n");
+        printf("  -a, --asn FILE             Tag resolved addresses with ASN and owner from an iptoasn\n");
+        printf("                             dataset (TSV/CSV, .gz ok) or a compiled one; no lookups leave the host\n");
+        printf("  -A, --compile-asn F        Compile the ASN dataset into binary file F and exit\n");
         printf("%sExamples:\n" COLOR_RESET, COLOR_BLUE);
         printf("  %s example.com\n", argv[0]);
         printf("  %s example.com subdomains.txt\n", argv[0]);
@@ -564,8 +1016,22 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
-    const char *domain = argv[1];
-    const char *wordlist_file = (argc == 3) ? argv[2] : DEFAULT_WORDLIST;
+    config.domain = argv[optind];
+    if(cli.asn_file) {
+        if(!load_asn(&cli, cli.asn_file)) return 1;
+        config.asn = &cli.asn;
+    }
+    const char *wordlist_file = (positional == 2) ? argv[optind + 1] : DEFAULT_WORDLIST;
+    
+    // Checks the domain and resolver; the engine is only attached, not used yet
+    ScanEngine engine;
+    ScanContext scan;
+    if(!scan_init(&scan, &engine, &config)) {
+        printf(COLOR_RED "[!] %s\n" COLOR_RESET, scan.error);
+        asn_free(&cli.asn);
+        return 1;
+    }
+    const char *domain = scan.target.domain;
     
     printf("%s[*] Target Domain:   %s\n" COLOR_RESET, COLOR_WHITE, domain);
     printf("%s[*] Wordlist:        %s\n" COLOR_RESET, COLOR_WHITE, wordlist_file);
@@ -575,45 +1041,73 @@ int main(int argc, char *argv[]) {
            COLOR_WHITE, REQUESTS_PER_MINUTE);
     
     // Initialize
-    srand(time(NULL));
-    scan_start_time = time(NULL);
-    result_count = 0;
-    total_requests_made = 0;
-    
-    // Load wordlist
-    if(!load_wordlist(wordlist_file)) {
-        printf(COLOR_RED "[!] Failed to load wordlist. Exiting.\n" COLOR_RESET);
+    if(!scan_engine_init(&engine, TOR_PROXY, USER_AGENT, REQUESTS_PER_MINUTE, MIN_DELAY_MS, MAX_DELAY_MS)) {
+        printf(COLOR_RED "[!] Could not set up the shared curl context\n" COLOR_RESET);
+        scan_free(&scan);
         return 1;
     }
+    int status = 1;
+    if(cli.json_log && !(cli.event_log = fopen(cli.json_log, "w"))) {
+        printf(COLOR_RED "[!] Cannot write event log %s\n" COLOR_RESET, cli.json_log);
+        goto done;
+    }
+    if(!console_start(&cli.console, cli.event_log, cli.quiet)) {
+        cli.console.events = cli.event_log;  // Still usable: prints synchronously
+        cli.console.quiet = cli.quiet;
+    }
+    if(cli.metrics_file) {
+        const char *error = NULL;
+        if(!metrics_start_export(&engine.metrics, cli.metrics_file, &error)) {
+            printf(COLOR_RED "[!] Metrics file %s: %s\n" COLOR_RESET, cli.metrics_file, error);
+            goto done;
+        }
+    }
+    if(!open_output(&cli, domain, config.resume)) goto done;
+    
+    if(config.offline) {
+        scan_passive(&scan);
+        print_summary(&cli, &scan);
+        close_output(&cli);
+        scan_update_index(&scan);
+        finish_metrics(&cli, &engine, domain);
+        status = 0;
+        goto done;
+    }
     
-    // Check Tor
-    if(!check_tor_connection()) {
+    // Startup: the wordlist loads while the proxy is checked
+    WordlistLoad load;
+    start_wordlist_load(&cli, &load, wordlist_file);
+    if(!scan_check_tor(&scan)) {
         printf(COLOR_RED "[!] Tor connection failed. Exiting.\n" COLOR_RESET);
-        free_resources();
-        return 1;
+        finish_wordlist_load(&load, 0);
+        goto done;
     }
     
-    // Initial delay
-    printf("%s[*] Initializing scan...\n" COLOR_RESET, COLOR_BLUE);
-    sleep(2);
-    
-    // Phase 1: Certificate Transparency
-    query_certificate_transparency(domain);
-    
-    // Phase 2: Wordlist scan
-    printf("\n%sStart wordlist scan? (y/n): " COLOR_RESET, COLOR_YELLOW);
-    char response[10];
-    scanf("%9s", response);
+    // Phase 1: crt.sh and every local source, started as soon as Tor answers
+    scan_passive(&scan);
+    scan_resolve(&scan);
+    
+    // Phase 2: Wordlist scan (a resumed scan was already confirmed)
+    char response[10] = "y";
+    if(!finish_wordlist_load(&load, 1)) {
+        printf(COLOR_RED "[!] Failed to load wordlist, skipping the wordlist scan\n" COLOR_RESET);
+        response[0] = 'n';
+    } else if(!config.resume && !cli.yes) {
+        printf("\n%sStart wordlist scan? (y/n): " COLOR_RESET, COLOR_YELLOW);
+        if(scanf("%9s", response) != 1) response[0] = 'n';
+    }
     
     if(response[0] == 'y' || response[0] == 'Y') {
-        scan_with_wordlist(domain);
+        scan_wordlist(&scan, &cli.wordlist);
     } else {
         printf("%s[*] Skipping wordlist scan\n" COLOR_RESET, COLOR_YELLOW);
     }
     
     // Results
-    print_summary();
-    save_results();
+    print_summary(&cli, &scan);
+    close_output(&cli);
+    scan_update_index(&scan);
+    finish_metrics(&cli, &engine, domain);
     
     // Final message
     printf("\n%s%sEDUCATIONAL SCAN COMPLETE%s\n", COLOR_CYAN,
@@ -624,9 +1118,12 @@ int main(int argc, char *argv[]) {
     printf("%s• Rate limits respected to avoid detection\n" COLOR_RESET, COLOR_WHITE);
     printf("%s• Results saved for learning reference\n" COLOR_RESET, COLOR_WHITE);
     printf("%s• Use knowledge responsibly and ethically\n" COLOR_RESET, COLOR_WHITE);
+    status = 0;
     
+done:
     // Cleanup
-    free_resources();
-    
-    return 0;
+    free_cli(&cli);
+    scan_free(&scan);
+    scan_engine_free(&engine);
+    return status;
 }
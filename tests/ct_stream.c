@@ -0,0 +1,85 @@
+/*
+ * ct_stream.c - Oversized crt.sh fields are dropped whole
+ * A name_value just over CT_MAX_VALUE_LEN must not produce any name (a
+ * cut-off list would end in a cut-off name) and must not disturb the
+ * entries around it; one exactly at the limit is still read in full.
+ *
+ * Usage: ct_stream   (exit status 0 = pass)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../ct_stream.h"
+
+static int failures = 0;
+
+typedef struct {
+    size_t names;
+    size_t filler;          // Names made of the padding character
+    int saw_before;
+    int saw_after;
+} Seen;
+
+static void check(const char *what, int ok) {
+    if(ok) return;
+    printf("FAIL %s\n", what);
+    failures++;
+}
+
+static void on_name(const char *name, size_t len, const CtEntryInfo *info, void *userdata) {
+    Seen *seen = (Seen *)userdata;
+    (void)info;
+    seen->names++;
+    if(len > 0 && name[0] == 'x') seen->filler++;
+    if(strcmp(name, "before.example.com") == 0) seen->saw_before = 1;
+    if(strcmp(name, "after.example.com") == 0) seen->saw_after = 1;
+}
+
+// [{"name_value":"before.example.com"},{"name_value":"www.example.com\n<pad>"},
+//  {"name_value":"after.example.com"}] fed in small chunks
+static void run(size_t value_len, Seen *seen, CtStreamParser *p) {
+    const char *head = "[{\"name_value\":\"before.example.com\"},{\"name_value\":\"www.example.com\\n";
+    const char *tail = "\"},{\"name_value\":\"after.example.com\"}]";
+    size_t prefix = strlen("www.example.com\n");
+    size_t pad = value_len - prefix;
+
+    size_t total = strlen(head) + pad + strlen(tail);
+    char *doc = malloc(total);
+    memcpy(doc, head, strlen(head));
+    memset(doc + strlen(head), 'x', pad);
+    memcpy(doc + strlen(head) + pad, tail, strlen(tail));
+
+    memset(seen, 0, sizeof(*seen));
+    ct_stream_init(p, on_name, seen);
+    for(size_t off = 0; off < total; off += 4093) {
+        size_t n = total - off < 4093 ? total - off : 4093;
+        check("feed", ct_stream_feed(p, doc + off, n));
+    }
+    check("complete document", ct_stream_finish(p));
+    ct_stream_free(p);
+    free(doc);
+}
+
+// ========== VALUE LIMIT ==========
+static void test_value_limit(void) {
+    CtStreamParser p;
+    Seen seen;
+
+    run(CT_MAX_VALUE_LEN, &seen, &p);
+    check("value at the limit is kept", seen.names == 4 && seen.filler == 1);
+    check("value at the limit is not counted", p.truncated_values == 0);
+
+    run(CT_MAX_VALUE_LEN + 1, &seen, &p);
+    check("value over the limit yields no names", seen.names == 2 && seen.filler == 0);
+    check("value over the limit is counted", p.truncated_values == 1);
+    check("entries around it are intact", seen.saw_before && seen.saw_after);
+    check("three entries", p.entries == 3);
+}
+
+// ========== MAIN ==========
+int main(void) {
+    test_value_limit();
+    printf("%s\n", failures ? "ct_stream: FAILED" : "ct_stream: ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * event_log.c - --json-log lines stay valid JSON whatever a name holds
+ * Names with quotes, backslashes and control bytes are quoted the way the
+ * CLI does it and sent through a running Console; every line that comes
+ * out must match the expected text exactly, including events longer than
+ * a console slot.
+ *
+ * Usage: event_log   (exit status 0 = pass)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../console.h"
+#include "../result_store.h"
+#include "../result_writer.h"
+
+static int failures = 0;
+
+static void expect(const char *what, const char *got, const char *want) {
+    if(strcmp(got, want) == 0) return;
+    printf("FAIL %s\n  got:  %s\n  want: %s\n", what, got, want);
+    failures++;
+}
+
+// ========== QUOTING ==========
+static void test_quote(void) {
+    char out[JSON_QUOTED_LEN(MAX_NAME_LEN)];
+
+    json_quote(out, sizeof(out), "a\"b\\c.example.com");
+    expect("quote and backslash", out, "\"a\\\"b\\\\c.example.com\"");
+    json_quote(out, sizeof(out), "tab\there\x01.example.com");
+    expect("control bytes", out, "\"tab\\u0009here\\u0001.example.com\"");
+    json_quote(out, sizeof(out), NULL);
+    expect("null string", out, "\"\"");
+
+    // Too small a buffer cuts between escapes, never inside one
+    char small[8];
+    json_quote(small, sizeof(small), "ab\"cd");
+    expect("cut before an escape", small, "\"ab\\\"c\"");
+    json_quote(small, sizeof(small), "abcd\"");
+    expect("cut instead of half an escape", small, "\"abcd\"");
+
+    // The worst case fits: every byte of a maximum-length name escaped
+    char worst[MAX_NAME_LEN + 1];
+    memset(worst, 0x01, MAX_NAME_LEN);
+    worst[MAX_NAME_LEN] = '\0';
+    size_t len = json_quote(out, sizeof(out), worst);
+    if(len != MAX_NAME_LEN * 6 + 2 || out[len - 1] != '"') {
+        printf("FAIL worst case: %zu bytes\n", len);
+        failures++;
+    }
+}
+
+// ========== CONSOLE ==========
+static void test_console(void) {
+    FILE *events = tmpfile();
+    Console console;
+    if(!events || !console_start(&console, events, 1)) {
+        printf("FAIL cannot start console\n");
+        failures++;
+        return;
+    }
+
+    // Longer than a slot: must arrive whole, not cut at CONSOLE_LINE_MAX
+    char long_name[MAX_NAME_LEN + 1];
+    memset(long_name, '"', MAX_NAME_LEN);
+    long_name[MAX_NAME_LEN] = '\0';
+
+    const char *names[] = { "we\"ird\\.example.com", long_name };
+    char want[2][JSON_QUOTED_LEN(MAX_NAME_LEN) + 64];
+    for(int i = 0; i < 2; i++) {
+        char name_json[JSON_QUOTED_LEN(MAX_NAME_LEN)];
+        json_quote(name_json, sizeof(name_json), names[i]);
+        console_printf(&console, CONSOLE_EVENT, "{\"event\":\"name\",\"name\":%s}\n", name_json);
+        snprintf(want[i], sizeof(want[i]), "{\"event\":\"name\",\"name\":%s}\n", name_json);
+    }
+    console_stop(&console);
+
+    rewind(events);
+    char line[8192];
+    for(int i = 0; i < 2; i++) {
+        if(!fgets(line, sizeof(line), events)) {
+            printf("FAIL event %d missing\n", i);
+            failures++;
+            break;
+        }
+        expect(i == 0 ? "short event" : "event longer than a slot", line, want[i]);
+    }
+    if(fgets(line, sizeof(line), events)) {
+        printf("FAIL unexpected extra line: %s", line);
+        failures++;
+    }
+    fclose(events);
+}
+
+// ========== MAIN ==========
+int main(void) {
+    test_quote();
+    test_console();
+    printf("%s\n", failures ? "event_log: FAILED" : "event_log: ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * result_writer.c - A failed write stops the stream instead of buffering
+ * The writer streams to /dev/full, where every write fails with ENOSPC.
+ * After the first flush, appends must report the failure, the pending
+ * buffer must stay empty and close must return the same error.
+ *
+ * Usage: result_writer   (exit status 0 = pass)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "../result_store.h"
+#include "../result_writer.h"
+
+static int failures = 0;
+
+static void check(const char *what, int ok) {
+    if(ok) return;
+    printf("FAIL %s\n", what);
+    failures++;
+}
+
+// ========== WRITE ERROR ==========
+static void test_write_error(void) {
+    const char *error = NULL;
+    ResultWriter w;
+    if(!result_writer_open(&w, "/dev/full", output_format_find("jsonl"), "example.com", 0, &error)) {
+        printf("skip write error: cannot open /dev/full: %s\n", error);
+        return;
+    }
+
+    SubdomainResult r;
+    memset(&r, 0, sizeof(r));
+    r.subdomain = "www.example.com";
+    r.name_len = strlen(r.subdomain);
+    r.found = 1;
+
+    // Enough records to wake the writer early, then give it time to fail
+    int accepted = 1;
+    for(int i = 0; i < 2000 && accepted; i++) accepted = result_writer_write(&w, &r);
+    usleep(2 * RESULT_WRITER_FLUSH_MS * 1000);
+
+    check("append reports the failed write", !result_writer_write(&w, &r));
+    pthread_mutex_lock(&w.lock);
+    check("error is latched", w.failed && w.error == ENOSPC);
+    check("nothing is buffered after the error", w.pending.len == 0);
+    pthread_mutex_unlock(&w.lock);
+
+    for(int i = 0; i < 100000; i++) result_writer_write(&w, &r);
+    pthread_mutex_lock(&w.lock);
+    check("buffer does not grow", w.pending.len == 0);
+    pthread_mutex_unlock(&w.lock);
+
+    check("close reports the failure", !result_writer_close(&w));
+    check("close keeps the error", w.error == ENOSPC);
+}
+
+// ========== MAIN ==========
+int main(void) {
+    test_write_error();
+    printf("%s\n", failures ? "result_writer: FAILED" : "result_writer: ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,16 @@
+#!/bin/sh
+# tests/run.sh - Build and run the checks; exits non-zero on the first failure
+# Usage: tests/run.sh
+set -e
+cd "$(dirname "$0")/.."
+
+OUT=tests/out
+CFLAGS="-O2 -Wall -Wextra -I."
+LIB=$(ls *.c | grep -v '^shadowscan.c$')
+mkdir -p "$OUT"
+
+for t in tests/*.c; do
+    name=$(basename "$t" .c)
+    gcc $CFLAGS "$t" $LIB -o "$OUT/$name" -lcurl -lpthread -lz
+    "$OUT/$name"
+done
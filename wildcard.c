@@ -0,0 +1,100 @@
+/*
+ * wildcard.c - Wildcard DNS and catch-all HTTP detection
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/random.h>
+#include "wildcard.h"
+
+// ========== HELPERS ==========
+static int has_addr(const WildcardProfile *p, const char *addr) {
+    for(int i = 0; i < p->addr_count; i++) {
+        if(strcmp(p->addrs[i], addr) == 0) return 1;
+    }
+    return 0;
+}
+
+static void add_addr(WildcardProfile *p, const char *addr) {
+    if(!addr[0] || has_addr(p, addr) || p->addr_count == WILDCARD_MAX_ADDRS) return;
+    snprintf(p->addrs[p->addr_count++], sizeof(p->addrs[0]), "%s", addr);
+}
+
+// Replaces every occurrence of `host` in a redirect target with "*"
+static void mask_host(char *dst, size_t cap, const char *url, const char *host) {
+    size_t host_len = strlen(host), out = 0;
+    while(*url && out + 1 < cap) {
+        if(host_len && strncasecmp(url, host, host_len) == 0) {
+            dst[out++] = '*';
+            url += host_len;
+        } else {
+            dst[out++] = *url++;
+        }
+    }
+    dst[out] = '\0';
+}
+
+// ========== CALIBRATION ==========
+void wildcard_init(WildcardProfile *p) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    unsigned char random[WILDCARD_SAMPLES * WILDCARD_LABEL_LEN];
+
+    memset(p, 0, sizeof(*p));
+    if(getrandom(random, sizeof(random), 0) != (ssize_t)sizeof(random)) {
+        for(size_t i = 0; i < sizeof(random); i++) random[i] = (unsigned char)rand();
+    }
+    for(int s = 0; s < WILDCARD_SAMPLES; s++) {
+        for(int i = 0; i < WILDCARD_LABEL_LEN; i++) {
+            p->labels[s][i] = alphabet[random[s * WILDCARD_LABEL_LEN + i] % (sizeof(alphabet) - 1)];
+        }
+        p->labels[s][WILDCARD_LABEL_LEN] = '\0';
+    }
+}
+
+void wildcard_learn_dns(WildcardProfile *p, const ResolveResult *res) {
+    if(res->status != RESOLVE_OK) return;
+    p->dns_answered++;
+    add_addr(p, res->ipv4);
+    add_addr(p, res->ipv6);
+}
+
+void wildcard_learn_http(WildcardProfile *p, const char *host, const ProbeResult *res) {
+    if(res->code != CURLE_OK) return;
+
+    char redirect[sizeof(p->redirect)];
+    mask_host(redirect, sizeof(redirect), res->redirect, host);
+
+    if(p->http_answered++ == 0) {
+        p->http_status = res->http_status;
+        p->content_length = res->content_length;
+        memcpy(p->redirect, redirect, sizeof(redirect));
+    } else if(res->http_status != p->http_status || res->content_length != p->content_length ||
+              strcmp(redirect, p->redirect) != 0) {
+        p->http_mismatch = 1;
+    }
+}
+
+// A wildcard is only declared when every random label answered
+void wildcard_finish(WildcardProfile *p) {
+    p->dns = p->dns_answered == WILDCARD_SAMPLES && p->addr_count > 0;
+    p->http = p->http_answered == WILDCARD_SAMPLES && !p->http_mismatch;
+}
+
+// ========== MATCHING ==========
+int wildcard_match_dns(const WildcardProfile *p, const ResolveResult *res) {
+    if(!p->dns || res->status != RESOLVE_OK) return 0;
+    if(res->ipv4[0] && !has_addr(p, res->ipv4)) return 0;
+    if(res->ipv6[0] && !has_addr(p, res->ipv6)) return 0;
+    return 1;
+}
+
+int wildcard_match_http(const WildcardProfile *p, const char *host, const ProbeResult *res) {
+    if(!p->http || res->code != CURLE_OK) return 0;
+    if(res->http_status != p->http_status || res->content_length != p->content_length) return 0;
+
+    char redirect[sizeof(p->redirect)];
+    mask_host(redirect, sizeof(redirect), res->redirect, host);
+    return strcmp(redirect, p->redirect) == 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * wildcard.h - Wildcard DNS and catch-all HTTP detection
+ * A few random labels that cannot exist are resolved and probed before
+ * the wordlist scan; whatever they answer is the wildcard's fingerprint,
+ * and candidates answering the same way are not real subdomains.
+ */
+
+#ifndef WILDCARD_H
+#define WILDCARD_H
+
+#include <stddef.h>
+#include "resolver.h"
+#include "probe_engine.h"
+
+// ========== CONFIGURATION ==========
+#define WILDCARD_SAMPLES    3       // Random labels per calibration
+#define WILDCARD_LABEL_LEN  16
+#define WILDCARD_MAX_ADDRS  16      // Round-robin wildcards return several
+
+// ========== STRUCTURES ==========
+typedef struct {
+    char labels[WILDCARD_SAMPLES][WILDCARD_LABEL_LEN + 1];
+
+    // DNS: every sample resolved; the union of the answers
+    int dns;
+    int dns_answered;
+    char addrs[WILDCARD_MAX_ADDRS][46];
+    int addr_count;
+
+    // HTTP: every sample answered with the same fingerprint
+    int http;
+    int http_answered;
+    int http_mismatch;
+    long http_status;
+    curl_off_t content_length;
+    char redirect[512];     // Target with the probed host replaced by "*"
+
+    size_t dns_filtered;
+    size_t http_filtered;
+} WildcardProfile;
+
+// ========== FUNCTION PROTOTYPES ==========
+void wildcard_init(WildcardProfile *p);
+void wildcard_learn_dns(WildcardProfile *p, const ResolveResult *res);
+void wildcard_learn_http(WildcardProfile *p, const char *host, const ProbeResult *res);
+void wildcard_finish(WildcardProfile *p);
+int wildcard_match_dns(const WildcardProfile *p, const ResolveResult *res);
+int wildcard_match_http(const WildcardProfile *p, const char *host, const ProbeResult *res);
+
+#endif
@@ -0,0 +1,403 @@
+/*
+ * wordlist.c - Zero-copy wordlist loader
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "wordlist.h"
+#include "hash.h"
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t block_size;
+    uint64_t blocks_offset;
+    uint64_t order_offset;
+    uint64_t data_offset;
+    uint64_t data_size;
+} WordlistHeader;
+
+// ========== DEDUP SET ==========
+typedef struct {
+    uint32_t *slots;        // Word index + 1, 0 = empty
+    size_t mask;
+} WordSet;
+
+static int wordset_grow(WordSet *set, const Wordlist *wl, size_t count) {
+    size_t size = set->slots ? (set->mask + 1) * 2 : 4096;
+    uint32_t *slots = calloc(size, sizeof(uint32_t));
+    if(!slots) return 0;
+
+    for(size_t i = 0; i < count; i++) {
+        const WordView *w = &wl->words[i];
+        size_t pos = hash_bytes(wl->base + w->offset, w->len) & (size - 1);
+        while(slots[pos]) pos = (pos + 1) & (size - 1);
+        slots[pos] = (uint32_t)(i + 1);
+    }
+
+    free(set->slots);
+    set->slots = slots;
+    set->mask = size - 1;
+    return 1;
+}
+
+// Returns 1 if the word was inserted, 0 if it was already present
+static int wordset_insert(WordSet *set, const Wordlist *wl, const char *word, size_t len, size_t index) {
+    size_t pos = hash_bytes(word, len) & set->mask;
+    while(set->slots[pos]) {
+        const WordView *w = &wl->words[set->slots[pos] - 1];
+        if(w->len == len && memcmp(wl->base + w->offset, word, len) == 0) return 0;
+        pos = (pos + 1) & set->mask;
+    }
+    set->slots[pos] = (uint32_t)(index + 1);
+    return 1;
+}
+
+// ========== BINARY FORMAT ==========
+// Walks every front-coded entry once, so wordlist_word() never reads
+// outside the data section whatever the file holds
+static int check_data(const Wordlist *wl, size_t total, uint64_t data_size) {
+    const unsigned char *end = wl->data + data_size;
+    size_t blocks = (total + WORDLIST_BLOCK - 1) / WORDLIST_BLOCK;
+
+    for(size_t b = 0; b < blocks; b++) {
+        if(wl->block_offsets[b] >= data_size) return 0;
+        const unsigned char *p = wl->data + wl->block_offsets[b];
+        size_t entries = total - b * WORDLIST_BLOCK;
+        if(entries > WORDLIST_BLOCK) entries = WORDLIST_BLOCK;
+
+        size_t cur = 0;
+        for(size_t j = 0; j < entries; j++) {
+            if(end - p < 2) return 0;
+            size_t shared = p[0], suffix = p[1];
+            if(shared > cur || shared + suffix > WORDLIST_MAX_WORD_LEN) return 0;
+            if((size_t)(end - p - 2) < suffix) return 0;
+            cur = shared + suffix;
+            p += 2 + suffix;
+        }
+    }
+    return 1;
+}
+
+// Sections must lie inside the file and stay 4-byte aligned for the
+// uint32_t tables
+static int section_fits(uint64_t offset, uint64_t len, size_t size) {
+    return offset <= size && len <= size - offset && offset % sizeof(uint32_t) == 0;
+}
+
+static int load_binary(Wordlist *wl, size_t max_words) {
+    if(wl->size < sizeof(WordlistHeader)) {
+        wl->error = "truncated compiled wordlist";
+        return 0;
+    }
+
+    WordlistHeader h;
+    memcpy(&h, wl->base, sizeof(h));
+    size_t blocks = (h.count + (size_t)WORDLIST_BLOCK - 1) / WORDLIST_BLOCK;
+
+    if(h.version != WORDLIST_VERSION || h.block_size != WORDLIST_BLOCK) {
+        wl->error = "unsupported compiled wordlist version";
+        return 0;
+    }
+    if(!section_fits(h.blocks_offset, (uint64_t)blocks * sizeof(uint32_t), wl->size) ||
+       !section_fits(h.order_offset, (uint64_t)h.count * sizeof(uint32_t), wl->size) ||
+       h.data_offset > wl->size || h.data_size > wl->size - h.data_offset) {
+        wl->error = "corrupt compiled wordlist";
+        return 0;
+    }
+
+    wl->block_offsets = (const uint32_t *)(wl->base + h.blocks_offset);
+    wl->order = (const uint32_t *)(wl->base + h.order_offset);
+    wl->data = (const unsigned char *)(wl->base + h.data_offset);
+    if(!check_data(wl, h.count, h.data_size)) {
+        wl->error = "corrupt compiled wordlist";
+        return 0;
+    }
+
+    // The order table is in file order, so a limit keeps the same words text mode would
+    wl->count = h.count;
+    if(max_words && wl->count > max_words) {
+        wl->truncated = wl->count - max_words;
+        wl->count = max_words;
+    }
+    for(size_t i = 0; i < wl->count; i++) {
+        if(wl->order[i] >= h.count) {
+            wl->error = "corrupt compiled wordlist";
+            return 0;
+        }
+    }
+    wl->binary = 1;
+    return 1;
+}
+
+static _Thread_local const Wordlist *sort_wl;  // qsort() has no context argument
+
+static int compare_views(const void *a, const void *b) {
+    const WordView *x = &sort_wl->words[*(const uint32_t *)a];
+    const WordView *y = &sort_wl->words[*(const uint32_t *)b];
+    size_t n = x->len < y->len ? x->len : y->len;
+    int c = memcmp(sort_wl->base + x->offset, sort_wl->base + y->offset, n);
+    if(c) return c;
+    return (x->len > y->len) - (x->len < y->len);
+}
+
+int wordlist_compile(const Wordlist *wl, const char *filename) {
+    if(wl->binary) {
+        return 1;  // Already compiled, nothing to do
+    }
+
+    size_t count = wl->count;
+    size_t blocks = (count + WORDLIST_BLOCK - 1) / WORDLIST_BLOCK;
+    uint32_t *sorted = malloc(count * sizeof(uint32_t) + 1);
+    uint32_t *order = malloc(count * sizeof(uint32_t) + 1);
+    uint32_t *block_offsets = malloc(blocks * sizeof(uint32_t) + 1);
+    if(!sorted || !order || !block_offsets) {
+        free(sorted);
+        free(order);
+        free(block_offsets);
+        return 0;
+    }
+
+    for(size_t i = 0; i < count; i++) sorted[i] = (uint32_t)i;
+    sort_wl = wl;
+    qsort(sorted, count, sizeof(uint32_t), compare_views);
+    for(size_t k = 0; k < count; k++) order[sorted[k]] = (uint32_t)k;
+
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+    FILE *fp = fopen(tmp, "wb");
+    if(!fp) {
+        free(sorted);
+        free(order);
+        free(block_offsets);
+        return 0;
+    }
+
+    WordlistHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, WORDLIST_MAGIC, 4);
+    h.version = WORDLIST_VERSION;
+    h.count = (uint32_t)count;
+    h.block_size = WORDLIST_BLOCK;
+    h.blocks_offset = sizeof(h);
+    h.order_offset = h.blocks_offset + blocks * sizeof(uint32_t);
+    h.data_offset = h.order_offset + count * sizeof(uint32_t);
+
+    // Data first to a seek position so block offsets are known when we write them
+    int ok = fseek(fp, (long)h.data_offset, SEEK_SET) == 0;
+    const char *prev = NULL;
+    size_t prev_len = 0;
+    uint32_t data_size = 0;
+
+    for(size_t k = 0; k < count && ok; k++) {
+        const WordView *w = &wl->words[sorted[k]];
+        const char *word = wl->base + w->offset;
+        size_t shared = 0;
+
+        if(k % WORDLIST_BLOCK == 0) {
+            block_offsets[k / WORDLIST_BLOCK] = data_size;
+        } else {
+            size_t n = prev_len < w->len ? prev_len : w->len;
+            while(shared < n && prev[shared] == word[shared]) shared++;
+        }
+
+        unsigned char lens[2] = { (unsigned char)shared, (unsigned char)(w->len - shared) };
+        ok = fwrite(lens, 1, 2, fp) == 2 &&
+             fwrite(word + shared, 1, w->len - shared, fp) == w->len - shared;
+        data_size += 2 + (uint32_t)(w->len - shared);
+        prev = word;
+        prev_len = w->len;
+    }
+
+    h.data_size = data_size;
+    ok = ok && fseek(fp, 0, SEEK_SET) == 0 &&
+         fwrite(&h, sizeof(h), 1, fp) == 1 &&
+         fwrite(block_offsets, sizeof(uint32_t), blocks, fp) == blocks &&
+         fwrite(order, sizeof(uint32_t), count, fp) == count;
+    ok = (fclose(fp) == 0) && ok;
+    ok = ok && rename(tmp, filename) == 0;
+    if(!ok) unlink(tmp);
+
+    free(sorted);
+    free(order);
+    free(block_offsets);
+    return ok;
+}
+
+// ========== TEXT FORMAT ==========
+static int load_text(Wordlist *wl, size_t max_words) {
+    if(wl->size > UINT32_MAX) {
+        wl->error = "wordlist larger than 4 GB";
+        return 0;
+    }
+
+    // Private writable mapping: lowercasing in place only copies the pages it touches
+    char *text = (char *)wl->base;
+    char *end = text + wl->size;
+    size_t cap = 0;
+    WordSet set = { NULL, 0 };
+
+    madvise(text, wl->size, MADV_SEQUENTIAL);
+
+    for(char *line = text; line < end; ) {
+        char *nl = memchr(line, '\n', end - line);
+        char *stop = nl ? nl : end;
+        char *s = line;
+        char *e = stop;
+        line = stop + 1;
+        wl->lines++;
+
+        while(s < e && (*s == ' ' || *s == '\t')) s++;
+        while(e > s && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r')) e--;
+        if(e > s && e[-1] == '.') e--;
+        if(s == e || *s == '#') continue;
+
+        size_t len = e - s;
+        int valid = len <= WORDLIST_MAX_WORD_LEN;
+        int upper = 0;
+        for(char *c = s; c < e && valid; c++) {
+            if((unsigned char)*c <= ' ' || *c == 0x7f) valid = 0;
+            if(*c >= 'A' && *c <= 'Z') upper = 1;
+        }
+        if(!valid) {
+            wl->invalid++;
+            continue;
+        }
+        if(upper) {
+            for(char *c = s; c < e; c++) {
+                if(*c >= 'A' && *c <= 'Z') *c += 32;
+            }
+        }
+
+        if(max_words && wl->count == max_words) {
+            wl->truncated++;
+            continue;
+        }
+
+        if(wl->count == cap) {
+            cap = cap ? cap * 2 : 4096;
+            WordView *words = realloc(wl->words, cap * sizeof(WordView));
+            if(!words) {
+                free(set.slots);
+                wl->error = "out of memory";
+                return 0;
+            }
+            wl->words = words;
+        }
+        if(!set.slots || (wl->count + 1) * 2 > set.mask + 1) {
+            if(!wordset_grow(&set, wl, wl->count)) {
+                free(set.slots);
+                wl->error = "out of memory";
+                return 0;
+            }
+        }
+
+        if(!wordset_insert(&set, wl, s, len, wl->count)) {
+            wl->duplicates++;
+            continue;
+        }
+        wl->words[wl->count].offset = (uint32_t)(s - text);
+        wl->words[wl->count].len = (uint32_t)len;
+        wl->count++;
+    }
+
+    free(set.slots);
+    return 1;
+}
+
+// ========== LOAD ==========
+int wordlist_load(Wordlist *wl, const char *filename, size_t max_words) {
+    memset(wl, 0, sizeof(*wl));
+
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0) {
+        wl->error = "cannot open file";
+        return 0;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        wl->error = "wordlist is empty";
+        return 0;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        wl->error = "mmap failed";
+        return 0;
+    }
+    wl->base = map;
+    wl->size = st.st_size;
+
+    int ok;
+    if(wl->size >= 4 && memcmp(wl->base, WORDLIST_MAGIC, 4) == 0) {
+        ok = load_binary(wl, max_words);
+    } else {
+        ok = load_text(wl, max_words);
+    }
+
+    if(ok && wl->count == 0) {
+        wl->error = "wordlist is empty";
+        ok = 0;
+    }
+    if(!ok) {
+        const char *error = wl->error;
+        wordlist_free(wl);
+        wl->error = error;
+    }
+    return ok;
+}
+
+// ========== ACCESS ==========
+// Returns word `i` (file order). Text mode points into the mapping and is
+// not NUL-terminated; binary mode decodes into `buf`, which must hold at
+// least WORDLIST_MAX_WORD_LEN + 1 bytes.
+const char *wordlist_word(const Wordlist *wl, size_t i, char *buf, size_t *len) {
+    if(!wl->binary) {
+        *len = wl->words[i].len;
+        return wl->base + wl->words[i].offset;
+    }
+
+    uint32_t k = wl->order[i];
+    const unsigned char *p = wl->data + wl->block_offsets[k / WORDLIST_BLOCK];
+    size_t cur = 0;
+
+    for(uint32_t j = 0; j <= k % WORDLIST_BLOCK; j++) {
+        size_t shared = p[0];
+        size_t suffix = p[1];
+        if(shared > cur) shared = cur;
+        if(shared + suffix > WORDLIST_MAX_WORD_LEN) suffix = WORDLIST_MAX_WORD_LEN - shared;
+        memcpy(buf + shared, p + 2, suffix);
+        cur = shared + suffix;
+        p += 2 + p[1];
+    }
+    buf[cur] = '\0';
+    *len = cur;
+    return buf;
+}
+
+// Identifies the word sequence regardless of text or compiled form
+uint64_t wordlist_fingerprint(const Wordlist *wl) {
+    uint64_t h = hash_bytes("", 0);
+    char buf[WORDLIST_MAX_WORD_LEN + 1];
+    for(size_t i = 0; i < wl->count; i++) {
+        size_t len;
+        const char *word = wordlist_word(wl, i, buf, &len);
+        h = (h ^ hash_bytes(word, len)) * 0x100000001b3ULL;
+    }
+    return h ^ wl->count;
+}
+
+void wordlist_free(Wordlist *wl) {
+    if(wl->base) munmap((void *)wl->base, wl->size);
+    free(wl->words);
+    memset(wl, 0, sizeof(*wl));
+}
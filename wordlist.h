@@ -0,0 +1,56 @@
+/*
+ * wordlist.h - Zero-copy wordlist loader
+ * Text wordlists are mmap'd and kept as offset/length views into the
+ * mapping. A wordlist can also be compiled into a front-coded binary
+ * file that later runs map and use without any parsing.
+ */
+
+#ifndef WORDLIST_H
+#define WORDLIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ========== CONFIGURATION ==========
+#define WORDLIST_MAX_WORD_LEN  200    // Longer entries cannot form a valid name
+#define WORDLIST_MAGIC         "SSWL"
+#define WORDLIST_VERSION       1
+#define WORDLIST_BLOCK         16     // Words per front-coding block
+
+// ========== STRUCTURES ==========
+typedef struct {
+    uint32_t offset;        // Into Wordlist.base
+    uint32_t len;
+} WordView;
+
+typedef struct {
+    const char *base;       // Mapped file
+    size_t size;
+
+    // Text mode: one view per unique word, in file order
+    WordView *words;
+
+    // Binary mode: front-coded sorted words plus file-order permutation
+    int binary;
+    const uint32_t *block_offsets;
+    const unsigned char *data;
+    const uint32_t *order;
+
+    size_t count;
+
+    // Load statistics
+    size_t lines;
+    size_t duplicates;
+    size_t invalid;         // Too long or containing whitespace/control bytes
+    size_t truncated;       // Dropped because of the word limit
+    const char *error;
+} Wordlist;
+
+// ========== FUNCTION PROTOTYPES ==========
+int wordlist_load(Wordlist *wl, const char *filename, size_t max_words);
+int wordlist_compile(const Wordlist *wl, const char *filename);
+const char *wordlist_word(const Wordlist *wl, size_t i, char *buf, size_t *len);
+uint64_t wordlist_fingerprint(const Wordlist *wl);
+void wordlist_free(Wordlist *wl);
+
+#endif
@@ -0,0 +1,482 @@
+/*
+ * zone.c - Offline name extraction from RFC 1035 master (zone) files
+ * Owner names are taken from every record, targets from CNAME and NS
+ * records. Names with backslash escapes cannot form valid hostnames and
+ * are skipped; $INCLUDE and $GENERATE are counted but not followed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "zone.h"
+
+#define ZONE_TOKENS  5              // Owner, TTL, class, type, first RDATA field
+#define ZONE_PENDING 64             // Names held until a chunk's first parenthesis
+
+// ========== STRUCTURES ==========
+typedef struct {
+    const char *start;
+    const char *end;
+
+    // First pass: what the chunk's $ORIGIN lines do to the incoming origin,
+    // which becomes `prefix` (absolute) or `prefix` + "." + incoming
+    int absolute;
+    char prefix[MAX_NAME_LEN + 1];
+
+    char origin[MAX_NAME_LEN + 1];  // In effect at `start`, "" = root
+} ZoneChunk;
+
+typedef struct {
+    ZoneChunk *chunks;
+    size_t count;
+    _Atomic size_t next;
+    const char *file_end;
+    const DomainMatcher *matcher;
+} ZoneJob;
+
+typedef struct {
+    pthread_t thread;
+    ZoneJob *job;
+    ResultStore local;
+    size_t records;
+    size_t directives;
+    size_t hits;
+
+    // Parenthesis state at the chunk start is unknown until the first one
+    // is seen: a ')' means the chunk began inside a record started earlier
+    int settled;
+    int garbage;                    // Current "record" is the tail of an earlier one
+    char pending[ZONE_PENDING][MAX_NAME_LEN + 1];
+    size_t pending_count;
+} ZoneWorker;
+
+typedef struct {
+    const char *p;
+    const char *limit;
+    int paren;
+    int quoted;                     // The last token was a "quoted string"
+} ZoneCursor;
+
+// ========== NAMES ==========
+// Writes `a` + "." + `b` (either may be empty); returns 0 if it does not fit
+static int join_labels(char *dst, const char *a, size_t a_len, const char *b) {
+    size_t b_len = strlen(b);
+    size_t len = a_len + (a_len && b_len ? 1 : 0) + b_len;
+    if(len > MAX_NAME_LEN) return 0;
+
+    memmove(dst + len - b_len, b, b_len + 1);
+    memcpy(dst, a, a_len);
+    if(a_len && b_len) dst[a_len] = '.';
+    return 1;
+}
+
+// Applies one $ORIGIN argument to `origin` in place
+static void apply_origin(char *origin, const char *token, size_t len) {
+    if(len == 1 && token[0] == '@') return;
+    if(len > 0 && token[len - 1] == '.') {
+        if(len - 1 <= MAX_NAME_LEN) {
+            memcpy(origin, token, len - 1);
+            origin[len - 1] = '\0';
+        }
+        return;
+    }
+    char joined[MAX_NAME_LEN + 1];
+    if(join_labels(joined, token, len, origin)) strcpy(origin, joined);
+}
+
+// Resolves an owner or target against the origin; 0 if it cannot be a hostname
+static int resolve_name(char *dst, const char *token, size_t len, const char *origin) {
+    if(len == 0 || memchr(token, '\\', len)) return 0;
+    if(len == 1 && token[0] == '@') {
+        snprintf(dst, MAX_NAME_LEN + 1, "%s", origin);
+        return dst[0] != '\0';
+    }
+    if(token[len - 1] == '.') {
+        if(len - 1 > MAX_NAME_LEN) return 0;
+        memcpy(dst, token, len - 1);
+        dst[len - 1] = '\0';
+        return len > 1;
+    }
+    dst[0] = '\0';
+    return join_labels(dst, token, len, origin);
+}
+
+// ========== FIRST PASS ==========
+// Reads the argument of a directive at `p` (just past the keyword)
+static size_t directive_argument(const char *p, const char *limit, const char **arg) {
+    while(p < limit && (*p == ' ' || *p == '\t')) p++;
+    const char *s = p;
+    while(p < limit && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' && *p != ';') p++;
+    *arg = s;
+    return (size_t)(p - s);
+}
+
+static int is_directive(const char *p, const char *limit, const char *keyword) {
+    size_t len = strlen(keyword);
+    return (size_t)(limit - p) > len && strncasecmp(p, keyword, len) == 0 &&
+           (p[len] == ' ' || p[len] == '\t');
+}
+
+// '$' only starts lines in directives, so this is little more than a memchr
+static void scan_origins(ZoneChunk *c, const char *file_start) {
+    c->absolute = 0;
+    c->prefix[0] = '\0';
+
+    for(const char *p = c->start; p < c->end; p++) {
+        p = memchr(p, '$', c->end - p);
+        if(!p) break;
+        if(p > file_start && p[-1] != '\n') continue;
+        if(!is_directive(p, c->end, "$ORIGIN")) continue;
+
+        const char *arg;
+        size_t len = directive_argument(p + 7, c->end, &arg);
+        if(len == 0) continue;
+        if(arg[len - 1] == '.') c->absolute = 1;
+        apply_origin(c->prefix, arg, len);
+    }
+}
+
+// ========== TOKENIZER ==========
+static void commit_pending(ZoneWorker *w) {
+    for(size_t i = 0; i < w->pending_count; i++) {
+        result_store_add(&w->local, w->pending[i], 1, NULL, 0, 0, NULL);
+    }
+    w->pending_count = 0;
+}
+
+static void on_paren(ZoneWorker *w, ZoneCursor *cur, int open) {
+    if(!w->settled) {
+        w->settled = 1;
+        if(!open && !cur->paren) {
+            // Everything so far continued a record the previous chunk owns
+            w->pending_count = 0;
+            w->garbage = 1;
+        } else {
+            commit_pending(w);
+        }
+    }
+    cur->paren = open;
+}
+
+// Next token of the current record; returns 0 once the record ends
+static int next_token(ZoneWorker *w, ZoneCursor *cur, const char **tok, size_t *len) {
+    const char *p = cur->p;
+
+    for(;;) {
+        if(p >= cur->limit) {
+            cur->p = p;
+            return 0;
+        }
+        char c = *p;
+        if(c == ' ' || c == '\t' || c == '\r') {
+            p++;
+        } else if(c == ';') {
+            const char *nl = memchr(p, '\n', cur->limit - p);
+            p = nl ? nl : cur->limit;
+        } else if(c == '\n') {
+            p++;
+            if(!cur->paren) {
+                cur->p = p;
+                return 0;
+            }
+        } else if(c == '(' || c == ')') {
+            on_paren(w, cur, c == '(');
+            p++;
+        } else if(c == '"') {
+            const char *s = ++p;
+            while(p < cur->limit && *p != '"' && *p != '\n') p += (*p == '\\' && p + 1 < cur->limit) ? 2 : 1;
+            *tok = s;
+            *len = (size_t)(p - s);
+            if(p < cur->limit && *p == '"') p++;
+            cur->p = p;
+            cur->quoted = 1;
+            return 1;
+        } else {
+            const char *s = p;
+            while(p < cur->limit && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' &&
+                  *p != ';' && *p != '(' && *p != ')' && *p != '"') {
+                p += (*p == '\\' && p + 1 < cur->limit) ? 2 : 1;
+            }
+            *tok = s;
+            *len = (size_t)(p - s);
+            cur->p = p;
+            cur->quoted = 0;
+            return 1;
+        }
+    }
+}
+
+// ========== RECORDS ==========
+static int token_is(const char *tok, size_t len, const char *word) {
+    return strlen(word) == len && strncasecmp(tok, word, len) == 0;
+}
+
+// TTLs are numbers, optionally with BIND units (1h30m)
+static int is_ttl(const char *tok, size_t len) {
+    if(len == 0 || tok[0] < '0' || tok[0] > '9') return 0;
+    for(size_t i = 0; i < len; i++) {
+        char c = tok[i] | 0x20;
+        if(!((c >= '0' && c <= '9') || c == 's' || c == 'm' || c == 'h' || c == 'd' || c == 'w')) return 0;
+    }
+    return 1;
+}
+
+static int is_class(const char *tok, size_t len) {
+    return token_is(tok, len, "IN") || token_is(tok, len, "CH") || token_is(tok, len, "HS") ||
+           token_is(tok, len, "CS") || (len > 5 && strncasecmp(tok, "CLASS", 5) == 0);
+}
+
+static void emit_name(ZoneWorker *w, const char *tok, size_t len, const char *origin) {
+    char name[MAX_NAME_LEN + 1], normalized[MAX_NAME_LEN + 1];
+    if(w->garbage || !resolve_name(name, tok, len, origin)) return;
+    size_t n = normalize_name(normalized, sizeof(normalized), name, strlen(name));
+    if(!n || !domain_match(w->job->matcher, normalized, n)) return;
+
+    w->hits++;
+    if(w->settled) {
+        result_store_add(&w->local, normalized, 1, NULL, 0, 0, NULL);
+        return;
+    }
+    if(w->pending_count == ZONE_PENDING) {
+        // No record runs on for this many names: the chunk started between records
+        w->settled = 1;
+        commit_pending(w);
+        result_store_add(&w->local, normalized, 1, NULL, 0, 0, NULL);
+        return;
+    }
+    memcpy(w->pending[w->pending_count++], normalized, n + 1);
+}
+
+// Parses one record (or directive) starting at cur->p, continuation lines included
+static void parse_record(ZoneWorker *w, ZoneCursor *cur, char *origin) {
+    const char *tok[ZONE_TOKENS];
+    size_t len[ZONE_TOKENS];
+    int quoted[ZONE_TOKENS];
+    int count = 0;
+    int inherit = *cur->p == ' ' || *cur->p == '\t';  // Blank owner: same as the previous record
+    const char *t;
+    size_t n;
+
+    while(next_token(w, cur, &t, &n)) {
+        if(count < ZONE_TOKENS) {
+            tok[count] = t;
+            len[count] = n;
+            quoted[count++] = cur->quoted;
+        }
+    }
+    if(count == 0) {
+        w->garbage = 0;
+        return;
+    }
+
+    int i = 0;
+    if(!inherit) {
+        if(tok[0][0] == '$' && !quoted[0]) {
+            w->directives++;
+            if(!w->garbage && token_is(tok[0], len[0], "$ORIGIN") && count > 1) {
+                apply_origin(origin, tok[1], len[1]);
+            }
+            w->garbage = 0;
+            return;
+        }
+        if(!quoted[0]) emit_name(w, tok[0], len[0], origin);
+        i = 1;
+    }
+    while(i < count && !quoted[i] && (is_ttl(tok[i], len[i]) || is_class(tok[i], len[i]))) i++;
+
+    if(i < count && !w->garbage) {
+        w->records++;
+        if(i + 1 < count && !quoted[i + 1] &&
+           (token_is(tok[i], len[i], "CNAME") || token_is(tok[i], len[i], "NS"))) {
+            emit_name(w, tok[i + 1], len[i + 1], origin);
+        }
+    }
+    w->garbage = 0;
+}
+
+static void parse_chunk(ZoneWorker *w, const ZoneChunk *c, int first) {
+    char origin[MAX_NAME_LEN + 1];
+    memcpy(origin, c->origin, sizeof(origin));
+
+    ZoneCursor cur = { c->start, w->job->file_end, 0, 0 };
+    w->settled = first;
+    w->garbage = 0;
+    w->pending_count = 0;
+
+    // Records starting in the chunk are ours, wherever they end
+    while(cur.p < c->end) {
+        if(*cur.p == '\n') {
+            cur.p++;
+            continue;
+        }
+        parse_record(w, &cur, origin);
+    }
+    commit_pending(w);  // Never saw a parenthesis: the chunk started between records
+}
+
+// ========== WORKERS ==========
+static void *origin_main(void *arg) {
+    ZoneWorker *w = (ZoneWorker *)arg;
+    ZoneJob *job = w->job;
+    const char *file_start = job->chunks[0].start;
+    size_t i;
+    while((i = atomic_fetch_add(&job->next, 1)) < job->count) scan_origins(&job->chunks[i], file_start);
+    return NULL;
+}
+
+static void *parse_main(void *arg) {
+    ZoneWorker *w = (ZoneWorker *)arg;
+    ZoneJob *job = w->job;
+    size_t i;
+    while((i = atomic_fetch_add(&job->next, 1)) < job->count) parse_chunk(w, &job->chunks[i], i == 0);
+    return NULL;
+}
+
+// Runs `fn` on every worker; returns how many threads could be started
+static int run_workers(ZoneWorker *workers, int threads, void *(*fn)(void *)) {
+    int started = 0;
+    atomic_store(&workers[0].job->next, 0);
+    for(int i = 0; i < threads; i++) {
+        if(pthread_create(&workers[i].thread, NULL, fn, &workers[i]) != 0) break;
+        started++;
+    }
+    for(int i = 0; i < started; i++) pthread_join(workers[i].thread, NULL);
+    return started;
+}
+
+// ========== ZONE FILE ==========
+// Cuts the mapping after a newline roughly every ZONE_CHUNK_SIZE bytes
+static ZoneChunk *split_chunks(const char *map, size_t size, size_t *count) {
+    size_t cap = size / ZONE_CHUNK_SIZE + 1;
+    ZoneChunk *chunks = calloc(cap, sizeof(ZoneChunk));
+    if(!chunks) return NULL;
+
+    size_t n = 0, pos = 0;
+    while(pos < size && n < cap) {
+        size_t end = pos + ZONE_CHUNK_SIZE;
+        if(end >= size || n == cap - 1) {
+            end = size;
+        } else {
+            const char *nl = memchr(map + end, '\n', size - end);
+            end = nl ? (size_t)(nl - map) + 1 : size;
+        }
+        chunks[n].start = map + pos;
+        chunks[n].end = map + end;
+        n++;
+        pos = end;
+    }
+    *count = n;
+    return chunks;
+}
+
+int zone_file(const char *path, const DomainMatcher *m, const char *origin, int threads,
+              ResultStore *out, unsigned int source, ZoneStats *stats, const char **error) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    memset(stats, 0, sizeof(*stats));
+    *error = NULL;
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        *error = "cannot open file";
+        return 0;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        *error = "cannot stat file";
+        return 0;
+    }
+    if(st.st_size == 0) {
+        close(fd);
+        return 1;
+    }
+
+    // Chunks are parsed out of order, which needs the whole file addressable
+    unsigned char magic[2] = { 0, 0 };
+    if(pread(fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        close(fd);
+        *error = "gzip zone files must be decompressed first";
+        return 0;
+    }
+
+    char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        *error = "mmap failed";
+        return 0;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    if(threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads <= 0) threads = 1;
+    if(threads > ZONE_MAX_THREADS) threads = ZONE_MAX_THREADS;
+
+    ZoneJob job;
+    memset(&job, 0, sizeof(job));
+    job.chunks = split_chunks(map, (size_t)st.st_size, &job.count);
+    job.file_end = map + st.st_size;
+    job.matcher = m;
+    if((size_t)threads > job.count) threads = (int)job.count;
+
+    ZoneWorker *workers = job.chunks ? calloc(threads, sizeof(ZoneWorker)) : NULL;
+    if(!workers) {
+        free(job.chunks);
+        munmap(map, st.st_size);
+        *error = "out of memory";
+        return 0;
+    }
+    for(int i = 0; i < threads; i++) {
+        workers[i].job = &job;
+        result_store_init(&workers[i].local);
+    }
+
+    int ok = run_workers(workers, threads, origin_main) > 0;
+
+    // Each chunk starts with the origin the chunks before it left behind
+    if(ok) {
+        snprintf(job.chunks[0].origin, sizeof(job.chunks[0].origin), "%s", origin ? origin : "");
+        for(size_t i = 1; i < job.count; i++) {
+            const ZoneChunk *prev = &job.chunks[i - 1];
+            ZoneChunk *c = &job.chunks[i];
+            if(prev->absolute) {
+                memcpy(c->origin, prev->prefix, sizeof(c->origin));
+            } else if(!join_labels(c->origin, prev->prefix, strlen(prev->prefix), prev->origin)) {
+                memcpy(c->origin, prev->origin, sizeof(c->origin));
+            }
+        }
+        ok = run_workers(workers, threads, parse_main) > 0;
+    }
+    if(!ok) *error = "could not start worker threads";
+
+    // Merge the per-thread stores into the caller's
+    for(int i = 0; i < threads; i++) {
+        ZoneWorker *w = &workers[i];
+        for(size_t j = 0; ok && j < w->local.count; j++) {
+            int is_new = 0;
+            result_store_add(out, w->local.records[j].subdomain, 1, NULL, 0, source, &is_new);
+            stats->names += is_new;
+        }
+        stats->records += w->records;
+        stats->directives += w->directives;
+        stats->hits += w->hits;
+        result_store_free(&w->local);
+    }
+    stats->bytes = (size_t)st.st_size;
+    stats->chunks = job.count;
+    free(workers);
+    free(job.chunks);
+    munmap(map, st.st_size);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    stats->seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    return ok;
+}
@@ -0,0 +1,36 @@
+/*
+ * zone.h - Offline name extraction from RFC 1035 master (zone) files
+ * The file is mapped and cut into newline-aligned chunks that a pool of
+ * threads parses at once. A quick first pass over every chunk collects
+ * its $ORIGIN lines, so each chunk starts with the origin in effect at
+ * its first byte; a record left open by a parenthesis at the end of a
+ * chunk is finished by the thread that started it and skipped by the next.
+ */
+
+#ifndef ZONE_H
+#define ZONE_H
+
+#include <stddef.h>
+#include "domain_match.h"
+#include "result_store.h"
+
+// ========== CONFIGURATION ==========
+#define ZONE_CHUNK_SIZE  (8 * 1024 * 1024)  // Bytes per work item
+#define ZONE_MAX_THREADS 64
+
+// ========== STRUCTURES ==========
+typedef struct {
+    size_t bytes;
+    size_t chunks;
+    size_t records;         // Resource records parsed
+    size_t directives;      // $ORIGIN, $TTL, $INCLUDE, ...
+    size_t hits;            // In-scope owners and CNAME/NS targets, before dedup
+    size_t names;           // New names added to the store
+    double seconds;
+} ZoneStats;
+
+// ========== FUNCTION PROTOTYPES ==========
+int zone_file(const char *path, const DomainMatcher *m, const char *origin, int threads,
+              ResultStore *out, unsigned int source, ZoneStats *stats, const char **error);
+
+#endif